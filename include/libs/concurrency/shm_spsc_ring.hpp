@@ -0,0 +1,261 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <type_traits>
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace concurrency {
+
+inline constexpr std::uint64_t shm_ring_magic = 0x474E495258504353ULL; // "SCPXRING"
+inline constexpr std::uint32_t shm_ring_version = 1;
+
+/**
+ * @brief concurrency::shm_ring_header_t is the fixed header at the start of a shared-memory ring segment. The creator fills in the layout fields and sets ready last (release), so an attaching process that sees ready also sees a complete header. head and tail are the only fields written afterwards, each on its own cache line.
+ *
+ */
+struct shm_ring_header_t {
+    std::uint64_t magic; ///< shm_ring_magic
+    std::uint32_t version; ///< shm_ring_version of the creator
+    std::uint32_t element_size; ///< sizeof(T) of the creator
+    std::uint32_t element_align; ///< alignof(T) of the creator
+    std::uint32_t data_offset; ///< bytes from the segment start to slot 0
+    std::uint64_t capacity; ///< slots, a power of 2
+    std::atomic<std::uint32_t> ready; ///< 1 once the header is complete
+
+    alignas(64) std::atomic<std::uint64_t> head; ///< next slot to read, written by the consumer
+    alignas(64) std::atomic<std::uint64_t> tail; ///< next slot to write, written by the producer
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "ring indices must be lock-free to be shared between processes");
+
+enum class ShmMode : uint8_t { CREATE, ATTACH }; // make a new segment (fails if the name exists), or map an existing one
+
+// ------------- Single Producer Single Consumer Ring Buffer in shared memory -------------
+/**
+ * @brief concurrency::ShmSpscRing is the SpscRing algorithm on a named POSIX shared-memory segment (shm_open + mmap), so the producer and the consumer can be different processes. One side constructs it with ShmMode::CREATE and owns the name (unlinked on destruction); the other attaches by name, and the header is checked for magic, version and element layout before use. Elements are copied byte by byte, so T must be trivially copyable and must not hold pointers. The index caches stay in each process, only head and tail are shared. A failed open leaves is_open() false with the reason in error().
+ *
+ */
+template <typename T>
+class ShmSpscRing {
+    static_assert(std::is_trivially_copyable_v<T>, "elements cross the process boundary as bytes");
+
+public:
+    // capacity_pow2 is used by CREATE only; ATTACH reads it from the header
+    ShmSpscRing(const std::string& name, ShmMode mode, std::size_t capacity_pow2 = 0)
+        : name_(name.empty() || name.front() != '/' ? "/" + name : name)
+    {
+#if defined(__unix__)
+        if (mode == ShmMode::CREATE) {
+            create(capacity_pow2);
+        } else {
+            attach();
+        }
+#else
+        (void)mode;
+        (void)capacity_pow2;
+        error_ = "shared-memory rings need POSIX shm_open";
+#endif
+    }
+
+    ~ShmSpscRing()
+    {
+#if defined(__unix__)
+        if (header_ != nullptr) {munmap(header_, map_bytes_);}
+        if (owner_) {shm_unlink(name_.c_str());}
+#endif
+    }
+
+    ShmSpscRing(const ShmSpscRing&) = delete; // forbid to copy
+    ShmSpscRing& operator=(const ShmSpscRing&) = delete; // forbid to copy
+
+    bool is_open() const noexcept { return header_ != nullptr; }
+    const std::string& error() const noexcept { return error_; } ///< why the open failed
+    const std::string& name() const noexcept { return name_; }
+
+    /// remove a segment left behind by a process that died before unlinking it
+    static bool remove(const std::string& name)
+    {
+#if defined(__unix__)
+        const std::string shm_name = name.empty() || name.front() != '/' ? "/" + name : name;
+        return shm_unlink(shm_name.c_str()) == 0;
+#else
+        (void)name;
+        return false;
+#endif
+    }
+
+    // -- Producer --
+    bool push(const T& val) noexcept
+    {
+        const std::uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+        if (tail - head_cached_for_producer_ >= capacity_) {
+            // looks full: refresh the consumer index
+            head_cached_for_producer_ = header_->head.load(std::memory_order_acquire);
+            if (tail - head_cached_for_producer_ >= capacity_) {return false;}
+        }
+        std::memcpy(static_cast<void*>(addr(tail)), &val, sizeof(T));
+        header_->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // -- Consumer --
+    bool pop(T& out) noexcept
+    {
+        return try_pop_n(&out, 1) == 1;
+    }
+
+    std::size_t try_pop_n(T* out, std::size_t max_n) noexcept
+    {
+        std::uint64_t head = header_->head.load(std::memory_order_relaxed);
+        if (head == tail_cached_for_consumer_) {
+            // looks empty: refresh the producer index
+            tail_cached_for_consumer_ = header_->tail.load(std::memory_order_acquire);
+            if (head == tail_cached_for_consumer_) {return 0;}
+        }
+        std::size_t num = 0;
+        while (num < max_n && head != tail_cached_for_consumer_) {
+            std::memcpy(static_cast<void*>(out + num), addr(head), sizeof(T));
+            ++num;
+            ++head;
+        }
+        header_->head.store(head, std::memory_order_release);
+        return num;
+    }
+
+    std::size_t approx_size() const noexcept
+    {
+        const std::uint64_t head = header_->head.load(std::memory_order_acquire);
+        const std::uint64_t tail = header_->tail.load(std::memory_order_acquire);
+        return static_cast<std::size_t>(tail - head);
+    }
+
+    std::size_t capacity() const noexcept { return capacity_; }
+
+private:
+    std::string name_;
+    std::string error_;
+    shm_ring_header_t* header_{nullptr};
+    T* buffer_{nullptr};
+    std::size_t capacity_{0};
+    std::size_t mask_{0};
+    std::size_t map_bytes_{0};
+    bool owner_{false};
+
+    // process-local caches of the other side's index
+    alignas(64) std::uint64_t head_cached_for_producer_{0};
+    alignas(64) std::uint64_t tail_cached_for_consumer_{0};
+
+    static constexpr std::size_t data_offset()
+    {
+        constexpr std::size_t align = alignof(T) > 64 ? alignof(T) : 64;
+        return (sizeof(shm_ring_header_t) + align - 1) / align * align;
+    }
+
+    T* addr(std::uint64_t index) noexcept { return buffer_ + (index & mask_); }
+
+#if defined(__unix__)
+    void fail(const char* what)
+    {
+        error_ = std::string(what) + " '" + name_ + "': " + std::strerror(errno);
+    }
+
+    bool map(int fd, std::size_t bytes)
+    {
+        void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (ptr == MAP_FAILED) {
+            fail("mmap");
+            return false;
+        }
+        header_ = static_cast<shm_ring_header_t*>(ptr);
+        map_bytes_ = bytes;
+        buffer_ = reinterpret_cast<T*>(static_cast<unsigned char*>(ptr) + data_offset());
+        return true;
+    }
+
+    void create(std::size_t capacity_pow2)
+    {
+        if (capacity_pow2 == 0 || (capacity_pow2 & (capacity_pow2 - 1)) != 0) {
+            error_ = "capacity must be a power of 2";
+            return;
+        }
+        const int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            fail("shm_open(create)");
+            return;
+        }
+        owner_ = true;
+        const std::size_t bytes = data_offset() + sizeof(T) * capacity_pow2;
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            fail("ftruncate");
+        } else if (map(fd, bytes)) {
+            // the new segment is zero-filled; the header is built in place and published by ready
+            auto* header = ::new (static_cast<void*>(header_)) shm_ring_header_t{
+                .magic = shm_ring_magic, .version = shm_ring_version,
+                .element_size = static_cast<std::uint32_t>(sizeof(T)), .element_align = static_cast<std::uint32_t>(alignof(T)),
+                .data_offset = static_cast<std::uint32_t>(data_offset()), .capacity = capacity_pow2,
+                .ready = 0, .head = 0, .tail = 0};
+            capacity_ = capacity_pow2;
+            mask_ = capacity_pow2 - 1;
+            header->ready.store(1, std::memory_order_release);
+        }
+        close(fd);
+    }
+
+    void attach()
+    {
+        const int fd = shm_open(name_.c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            fail("shm_open(attach)");
+            return;
+        }
+        struct stat info{};
+        if (fstat(fd, &info) != 0) {
+            fail("fstat");
+        } else if (static_cast<std::size_t>(info.st_size) < data_offset()) {
+            error_ = "segment '" + name_ + "' is smaller than a ring header (creator not done yet?)";
+        } else {
+            map(fd, static_cast<std::size_t>(info.st_size));
+        }
+        close(fd);
+        if (header_ == nullptr) {return;}
+
+        const shm_ring_header_t& header = *header_;
+        if (header.ready.load(std::memory_order_acquire) != 1) {
+            error_ = "segment '" + name_ + "' is not initialized yet";
+        } else if (header.magic != shm_ring_magic) {
+            error_ = "segment '" + name_ + "' is not a ring";
+        } else if (header.version != shm_ring_version) {
+            error_ = "segment '" + name_ + "' has ring version " + std::to_string(header.version) + ", expected " + std::to_string(shm_ring_version);
+        } else if (header.element_size != sizeof(T) || header.element_align != alignof(T) || header.data_offset != data_offset()) {
+            error_ = "segment '" + name_ + "' holds elements of size " + std::to_string(header.element_size) + ", expected " + std::to_string(sizeof(T));
+        } else if (header.capacity == 0 || (header.capacity & (header.capacity - 1)) != 0 ||
+                   data_offset() + sizeof(T) * header.capacity > map_bytes_) {
+            error_ = "segment '" + name_ + "' has an invalid capacity";
+        } else {
+            capacity_ = static_cast<std::size_t>(header.capacity);
+            mask_ = capacity_ - 1;
+            // resume from the shared indices, the other side may already be running
+            head_cached_for_producer_ = header.head.load(std::memory_order_acquire);
+            tail_cached_for_consumer_ = header.tail.load(std::memory_order_acquire);
+            return;
+        }
+        munmap(header_, map_bytes_);
+        header_ = nullptr;
+        buffer_ = nullptr;
+    }
+#endif
+};
+
+} //namespace concurrency
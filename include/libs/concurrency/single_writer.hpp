@@ -0,0 +1,14 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace concurrency {
+
+// single writer per counter: a plain load and store, no read-modify-write; readers on any thread see whole values.
+// Pass std::memory_order_release when a reader acquires the counter to see what was written before it.
+inline void bump(std::atomic<std::uint64_t>& counter, std::uint64_t by = 1, std::memory_order order = std::memory_order_relaxed) noexcept
+{
+    counter.store(counter.load(std::memory_order_relaxed) + by, order);
+}
+
+} // namespace concurrency
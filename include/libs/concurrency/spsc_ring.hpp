@@ -1,4 +1,6 @@
 #pragma once
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -6,13 +8,41 @@
 #include <new>
 #include <type_traits>
 #include <atomic>
+#include <libs/concurrency/single_writer.hpp>
 
 namespace concurrency {
 
+inline constexpr std::size_t ring_occupancy_buckets = 8;
+
+/**
+ * @brief concurrency::ring_stats_t is a point-in-time view of the telemetry of a SpscRing<T, true>, readable from any thread. Occupancy is sampled by the producer every sample_period pushes (one extra load of the consumer index). A refused push only counts in push_full and lifts high_water to capacity, so retries under backpressure do not skew the occupancy histogram.
+ *
+ */
+struct ring_stats_t {
+    std::uint64_t pushes{0}; ///< elements pushed
+    std::uint64_t push_full{0}; ///< pushes refused because the ring was full
+    std::uint64_t pops{0}; ///< elements popped
+    std::uint64_t pop_empty{0}; ///< pop / try_pop_n calls that found the ring empty
+    std::size_t high_water{0}; ///< largest occupancy seen
+    std::size_t capacity{0}; ///< ring capacity
+    std::array<std::uint64_t, ring_occupancy_buckets> occupancy{}; ///< samples per eighth of capacity: bucket i holds occupancy in [i/8, (i+1)/8), a full ring counts in the last
+
+    std::uint64_t samples() const noexcept
+    {
+        std::uint64_t total = 0;
+        for (const auto count : occupancy) {total += count;}
+        return total;
+    }
+};
+
 // ------------- Single Producer Single Consumer Ring Buffer -------------
-template <typename T>
+// Telemetry adds the counters of ring_stats_t: producer counters share the producer's cache lines and
+// consumer counters the consumer's, each written by its own side only, so they add no false sharing.
+template <typename T, bool Telemetry = false>
 class SpscRing {
 public:
+    static constexpr std::size_t sample_period = 64; ///< pushes between two occupancy samples (Telemetry)
+
     explicit SpscRing(std::size_t capacity_pow2) : capacity_(capacity_pow2),
         mask_(capacity_pow2 - 1),
         buffer_(static_cast<T*>(::operator new[](sizeof(T) * capacity_pow2, std::align_val_t{alignof(T)})))
@@ -48,10 +78,14 @@ public:
 
         // update head from consumer if it is necessary
         const std::size_t head = head_cache_for_producer();
-        if ((tail - head) == capacity_) {return false;}
+        if ((tail - head) == capacity_) {
+            on_full();
+            return false;
+        }
 
         ::new(static_cast<void*>(addr(tail))) T(std::forward<args_t>(args)...);
         tail_.store(next_index(tail),  std::memory_order_release);
+        on_push(tail);
         return true;
     }
 
@@ -64,13 +98,17 @@ public:
         const std::size_t tail = tail_cache_for_consumer();
 
         // empty if head == tail
-        if(head == tail) {return false;}
+        if(head == tail) {
+            on_empty();
+            return false;
+        }
 
         T* pointer = addr(head);
         out = std::move(*pointer);
 
         pointer->~T();
         head_.store(next_index(head), std::memory_order_release);
+        on_pop(1);
         return true;
     }
 
@@ -88,7 +126,12 @@ public:
             head = next_index(head);
         }
 
-        if(num != 0) {head_.store(head, std::memory_order_release);}
+        if(num != 0) {
+            head_.store(head, std::memory_order_release);
+            on_pop(num);
+        } else {
+            on_empty();
+        }
         return num;
     }
 
@@ -96,12 +139,54 @@ public:
     {
         std::size_t head = head_.load(std::memory_order_acquire);
         std::size_t tail = tail_.load(std::memory_order_acquire);
-        return (tail + capacity_ - head) & mask_;
+        // indices grow monotonically, so a full ring reads capacity_ (masking would read 0); the two loads
+        // are not taken together, and pops and pushes in between can make the difference exceed capacity_
+        return std::min(tail - head, capacity_);
     }
 
     std::size_t capacity() const noexcept { return capacity_;}
 
+    /// telemetry snapshot; any thread. Counters are read one by one, so they can be a few operations apart
+    ring_stats_t stats() const noexcept requires Telemetry
+    {
+        ring_stats_t result{
+            .pushes = producer_counters_.pushes.load(std::memory_order_relaxed),
+            .push_full = producer_counters_.full.load(std::memory_order_relaxed),
+            .pops = consumer_counters_.pops.load(std::memory_order_relaxed),
+            .pop_empty = consumer_counters_.empty.load(std::memory_order_relaxed),
+            .high_water = static_cast<std::size_t>(producer_counters_.high_water.load(std::memory_order_relaxed)),
+            .capacity = capacity_,
+        };
+        for (std::size_t i = 0; i < ring_occupancy_buckets; ++i) {
+            result.occupancy[i] = producer_counters_.occupancy[i].load(std::memory_order_relaxed);
+        }
+        return result;
+    }
+
 private:
+    /**
+     * @brief Producer-side telemetry, written only by the producer.
+     *
+     */
+    struct producer_counters_t {
+        std::atomic<std::uint64_t> pushes{0};
+        std::atomic<std::uint64_t> full{0};
+        std::atomic<std::uint64_t> high_water{0};
+        std::array<std::atomic<std::uint64_t>, ring_occupancy_buckets> occupancy{};
+        std::size_t until_sample{sample_period};
+    };
+
+    /**
+     * @brief Consumer-side telemetry, written only by the consumer.
+     *
+     */
+    struct consumer_counters_t {
+        std::atomic<std::uint64_t> pops{0};
+        std::atomic<std::uint64_t> empty{0};
+    };
+
+    struct no_counters_t {};
+
     T* const buffer_;
     const std::size_t capacity_;
     const std::size_t mask_;
@@ -111,7 +196,57 @@ private:
 
     // cache: buffer for producer/consumer to reduce frequency of atomic load
     alignas(64) std::size_t head_cached_for_producer_{0};
+    [[no_unique_address]] std::conditional_t<Telemetry, producer_counters_t, no_counters_t> producer_counters_;
     alignas(64) std::size_t tail_cached_for_consumer_{0};
+    [[no_unique_address]] std::conditional_t<Telemetry, consumer_counters_t, no_counters_t> consumer_counters_;
+
+    void record_occupancy(std::size_t occupancy) noexcept
+    {
+        auto& counters = producer_counters_;
+        const std::size_t bucket = std::min(occupancy * ring_occupancy_buckets / capacity_, ring_occupancy_buckets - 1);
+        bump(counters.occupancy[bucket]);
+        raise_high_water(occupancy);
+    }
+
+    void raise_high_water(std::size_t occupancy) noexcept
+    {
+        auto& counters = producer_counters_;
+        if (occupancy > counters.high_water.load(std::memory_order_relaxed)) {
+            counters.high_water.store(occupancy, std::memory_order_relaxed);
+        }
+    }
+
+    // tail is the index just written
+    void on_push(std::size_t tail) noexcept
+    {
+        if constexpr (Telemetry) {
+            bump(producer_counters_.pushes);
+            if (--producer_counters_.until_sample == 0) {
+                producer_counters_.until_sample = sample_period;
+                record_occupancy(tail + 1 - head_.load(std::memory_order_acquire));
+            }
+        } else {
+            (void)tail;
+        }
+    }
+
+    void on_full() noexcept
+    {
+        if constexpr (Telemetry) {
+            bump(producer_counters_.full);
+            raise_high_water(capacity_);
+        }
+    }
+
+    void on_pop(std::size_t num) noexcept
+    {
+        if constexpr (Telemetry) {bump(consumer_counters_.pops, num);}
+    }
+
+    void on_empty() noexcept
+    {
+        if constexpr (Telemetry) {bump(consumer_counters_.empty);}
+    }
 
     template<class U>
     bool emplace_impl(U&& val)
@@ -119,11 +254,15 @@ private:
         const std::size_t tail = tail_.load(std::memory_order_relaxed);
         // make sure head is the latest one (it could be already consumed)
         const std::size_t head = head_cache_for_producer();
-        if ((tail - head) == capacity_) {return false;}// full
+        if ((tail - head) == capacity_) {
+            on_full();
+            return false;
+        }// full
 
         // adding new data at tail.
         ::new(static_cast<void*>(addr(tail))) T(std::forward<U>(val));
         tail_.store(next_index(tail), std::memory_order_release);
+        on_push(tail);
         return true;
     }
 
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <libs/engine/engine.hpp>
+#include <libs/concurrency/spsc_ring.hpp>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <thread>
+
+namespace engine {
+
+/**
+ * @brief engine::submit_op_t is one in-flight submission. It lives inside the awaiting coroutine's frame, so only its address travels through the rings.
+ *
+ */
+struct submit_op_t {
+    order_cmd_t cmd{}; ///< command to match
+    add_result_t result{}; ///< written by the matching thread
+    std::coroutine_handle<> handle{}; ///< coroutine to resume on completion
+};
+
+class AsyncEngine;
+
+/**
+ * @brief engine::SubmitAwaitable is returned by AsyncEngine::submit(); co_await on it yields the add_result_t of the command.
+ *
+ */
+class SubmitAwaitable {
+public:
+    SubmitAwaitable(AsyncEngine& engine, const order_cmd_t& cmd) : engine_(engine) { op_.cmd = cmd; }
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle);
+    add_result_t await_resume() noexcept { return std::move(op_.result); }
+
+private:
+    AsyncEngine& engine_;
+    submit_op_t op_;
+};
+
+/**
+ * @brief engine::detached_task_t is a fire-and-forget coroutine type for callers that co_await submit() without awaiting the caller itself: it starts at once, and its frame frees itself when the body returns.
+ *
+ */
+struct detached_task_t {
+    struct promise_type {
+        detached_task_t get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+/**
+ * @brief engine::AsyncEngine is a pipelined engine: a matching thread owns an IEngine and serves commands from a concurrency::SpscRing, and completions come back over a second ring. One submitter thread awaits submit() from its coroutines and runs poll() from its event loop; poll() drains completions in batches and resumes the awaiting coroutines there, on the submitter's thread. Commands submitted while the command ring is full wait in a submitter-side queue and are forwarded by the next poll(), so submit() never blocks.
+ *
+ */
+class AsyncEngine {
+public:
+    static constexpr std::size_t default_capacity = 1U << 12;
+    static constexpr std::size_t batch_size = 64;
+
+    explicit AsyncEngine(const engine_config_t& config = {}, std::size_t capacity_pow2 = default_capacity);
+    ~AsyncEngine() { stop(); }
+
+    AsyncEngine(const AsyncEngine&) = delete;
+    AsyncEngine& operator=(const AsyncEngine&) = delete;
+
+    void start();
+    /// finish the commands already in the ring and join the matching thread; call drain() first so every awaiter resumes
+    void stop();
+
+    /// co_await submit(cmd) -> add_result_t; submitter thread only
+    SubmitAwaitable submit(const order_cmd_t& cmd) { return SubmitAwaitable(*this, cmd); }
+
+    /// forward queued commands and resume the coroutines of finished ones; returns the number resumed. Submitter thread only
+    std::size_t poll();
+    /// poll until nothing is in flight
+    void drain();
+
+    std::size_t in_flight() const noexcept { return in_flight_; } ///< submitted and not yet resumed
+
+    /// the underlying engine; only while the matching thread is stopped
+    IEngine& engine() noexcept { return *engine_; }
+
+private:
+    friend class SubmitAwaitable;
+
+    std::unique_ptr<IEngine> engine_;
+    concurrency::SpscRing<submit_op_t*> commands_;
+    concurrency::SpscRing<submit_op_t*> completions_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    // submitter-side state
+    std::deque<submit_op_t*> pending_; // commands waiting for room in the ring
+    std::size_t in_flight_{0};
+
+    void enqueue(submit_op_t* op);
+    void flush_pending();
+    bool push_command(submit_op_t* op);
+    void run();
+};
+
+inline void SubmitAwaitable::await_suspend(std::coroutine_handle<> handle)
+{
+    op_.handle = handle;
+    engine_.enqueue(&op_);
+}
+
+} // namespace engine
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+namespace engine {
+
+/// where the initial block of a BookArena lives
+enum class PageBacking : uint8_t { HEAP, MAPPED, HUGE_TRANSPARENT, HUGE_TLB };
+
+/**
+ * @brief engine::book_arena_options_t sizes a BookArena. The defaults fit a book with tens of thousands of resting orders in the initial block.
+ *
+ */
+struct book_arena_options_t {
+    std::size_t initial_bytes = 4U << 20; ///< block reserved up front; pools carve their chunks from it first
+    std::size_t max_pooled_block = 64U << 10; ///< larger requests (very deep level queues) bypass the pools
+    std::size_t max_blocks_per_chunk = 4096; ///< upper bound on how many blocks a pool refills at once
+    bool huge_pages = false; ///< back the initial block with 2 MiB pages: MAP_HUGETLB, else madvise(MADV_HUGEPAGE), else normal pages
+    bool prefault = false; ///< touch every page of the initial block at construction so no order pays the page fault
+};
+
+/**
+ * @brief engine::BookArena is a memory resource for the containers of one order book, set through engine_config_t::memory_resource. Small blocks (level map nodes, index nodes and buckets, level queues) come from size-class pools that recycle freed blocks, and the pools take their chunks from one contiguous monotonic region reserved at construction, so a book's nodes stay close together and insert/cancel never reach the global heap once warm. Blocks above max_pooled_block go straight to the upstream resource so a deep level that regrows does not strand memory. Not thread-safe: one arena per engine, used by the thread driving it.
+ *
+ */
+class BookArena final : public std::pmr::memory_resource {
+public:
+    explicit BookArena(const book_arena_options_t& options = {}, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+
+    BookArena(const BookArena&) = delete;
+    BookArena& operator=(const BookArena&) = delete;
+
+    /// return every block at once; only when no book allocates from the arena any more
+    void release();
+
+    std::size_t pooled_bytes() const noexcept { return pooled_bytes_; } ///< bytes currently handed out by the pools
+    std::size_t large_bytes() const noexcept { return large_bytes_; } ///< bytes currently handed out by upstream
+    std::size_t reserved_bytes() const noexcept { return region_.bytes(); } ///< size of the initial block
+    PageBacking page_backing() const noexcept { return region_.backing(); } ///< what the initial block ended up on
+
+private:
+    /**
+     * @brief The initial block: taken from upstream, or mapped (optionally on huge pages) when asked for, and pre-faulted on request.
+     *
+     */
+    class Region {
+    public:
+        Region(const book_arena_options_t& options, std::pmr::memory_resource* upstream);
+        ~Region();
+        Region(const Region&) = delete;
+        Region& operator=(const Region&) = delete;
+
+        void* data() const noexcept { return data_; }
+        std::size_t bytes() const noexcept { return bytes_; }
+        PageBacking backing() const noexcept { return backing_; }
+
+    private:
+        std::pmr::memory_resource* upstream_;
+        void* data_{nullptr};
+        std::size_t bytes_{0};
+        PageBacking backing_{PageBacking::HEAP};
+    };
+
+    std::pmr::memory_resource* upstream_;
+    std::size_t max_pooled_block_;
+    Region region_;
+    std::pmr::monotonic_buffer_resource chunks_;
+    std::pmr::unsynchronized_pool_resource pools_;
+    std::size_t pooled_bytes_{0};
+    std::size_t large_bytes_{0};
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+} // namespace engine
@@ -0,0 +1,306 @@
+#pragma once
+
+#include <libs/concurrency/single_writer.hpp>
+#include <libs/concurrency/spsc_ring.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace engine {
+
+/**
+ * @brief engine::scheduler_worker_stats_t is the load one BookScheduler worker carried.
+ *
+ */
+struct scheduler_worker_stats_t {
+    std::uint64_t commands{0}; ///< commands applied
+    std::uint64_t runs{0}; ///< books taken from a run queue and drained up to the quantum
+    std::uint64_t steals{0}; ///< runs of books taken from another worker's run queue
+    std::uint64_t idle_polls{0}; ///< scans of all run queues that found nothing to run
+};
+
+/**
+ * @brief engine::scheduler_book_stats_t is the load of one book in a BookScheduler.
+ *
+ */
+struct scheduler_book_stats_t {
+    std::uint64_t commands{0}; ///< commands applied
+    std::uint64_t runs{0}; ///< times a worker took the book and drained it
+    std::uint64_t migrations{0}; ///< runs on another worker than the run before
+    std::size_t backlog{0}; ///< commands waiting in its queue (approximate)
+};
+
+/**
+ * @brief engine::scheduler_stats_t is a point-in-time view of how load spread over the workers and books of a BookScheduler, readable from any thread.
+ *
+ */
+struct scheduler_stats_t {
+    std::vector<scheduler_worker_stats_t> workers; ///< per worker
+    std::vector<scheduler_book_stats_t> books; ///< per book, indexed by book
+    std::uint64_t full_waits{0}; ///< submits that found a book's queue full and waited
+
+    std::uint64_t commands() const noexcept
+    {
+        std::uint64_t total = 0;
+        for (const auto& worker : workers) {total += worker.commands;}
+        return total;
+    }
+    /// commands of the busiest worker over the mean per worker: 1.0 is an even spread, workers().size() one worker doing everything
+    double imbalance() const noexcept
+    {
+        const std::uint64_t total = commands();
+        if (total == 0) {return 1.0;}
+        std::uint64_t busiest = 0;
+        for (const auto& worker : workers) {busiest = std::max(busiest, worker.commands);}
+        return static_cast<double>(busiest) * static_cast<double>(workers.size()) / static_cast<double>(total);
+    }
+};
+
+/**
+ * @brief engine::BookScheduler runs many books on a pool of workers with work stealing. A book is the unit of work: it has its own SPSC command queue, and whichever worker takes it applies its queued commands in order through the handler, so matching stays single-writer per book. A book with queued commands sits in exactly one worker's run queue (or is being run), which keeps a book off two workers at once without locking the book itself. A worker takes books from the front of its own run queue, drains at most quantum commands and puts a book that still has work back at the end, so a hot book cannot starve the others behind it. An idle worker steals from the worker with the longest run queue, and takes the book with the largest backlog there: moving the hot book relieves a saturated worker most, cold books keep their worker and its caches. Orders are never split from their book. A book becoming runnable again is queued on the worker that ran it last. Commands come from one submitting thread; submit() waits when a book's queue is full. The handler runs on the worker threads as handler(worker, book, cmd); book state it touches needs no lock, since a book is only ever run by one worker at a time and hand-offs between workers are ordered.
+ *
+ */
+template <class Cmd>
+class BookScheduler {
+public:
+    using handler_t = std::function<void(std::size_t worker, std::size_t book, Cmd& cmd)>;
+
+    static constexpr std::size_t npos = ~std::size_t{0};
+    static constexpr std::size_t default_queue_capacity = 1U << 12;
+    static constexpr std::size_t default_quantum = 256;
+
+    /// max_books bounds add_book(); queue_capacity_pow2 is per book
+    BookScheduler(std::size_t workers, std::size_t max_books, handler_t handler,
+                  std::size_t queue_capacity_pow2 = default_queue_capacity, std::size_t quantum = default_quantum)
+        : handler_(std::move(handler)), max_books_(max_books), queue_capacity_(queue_capacity_pow2), quantum_(std::max<std::size_t>(quantum, 1)),
+          books_(std::make_unique<std::unique_ptr<book_t>[]>(max_books))
+    {
+        workers_.reserve(std::max<std::size_t>(workers, 1));
+        for (std::size_t i = 0; i < std::max<std::size_t>(workers, 1); ++i) {workers_.push_back(std::make_unique<worker_t>());}
+    }
+    ~BookScheduler() { stop(); }
+
+    BookScheduler(const BookScheduler&) = delete;
+    BookScheduler& operator=(const BookScheduler&) = delete;
+
+    /// submitting thread, before or after start(); returns the new book index, npos once max_books are in use
+    std::size_t add_book()
+    {
+        const std::size_t book = book_count_.load(std::memory_order_relaxed);
+        if (book == max_books_) {return npos;}
+        books_[book] = std::make_unique<book_t>(queue_capacity_, book % workers_.size());
+        book_count_.store(book + 1, std::memory_order_release);
+        return book;
+    }
+
+    void start()
+    {
+        if (running_) {return;} // already running
+        running_ = true;
+        stopping_.store(false, std::memory_order_release);
+        for (std::size_t i = 0; i < workers_.size(); ++i) {
+            workers_[i]->thread = std::thread([this, i] { run(i); });
+        }
+    }
+
+    /// apply everything submitted so far and join the workers
+    void stop()
+    {
+        if (!running_) {return;}
+        stopping_.store(true, std::memory_order_seq_cst);
+        for (auto& worker : workers_) {worker->thread.join();}
+        running_ = false;
+    }
+
+    /// submitting thread only
+    void submit(std::size_t book, const Cmd& cmd)
+    {
+        book_t& target = *books_[book];
+        if (!target.queue.push(cmd)) {
+            full_waits_.fetch_add(1, std::memory_order_relaxed);
+            while (!target.queue.push(cmd)) {
+                std::this_thread::yield(); // the book is behind
+            }
+        }
+        // pairs with the fence in run_book(): either the worker sees this command or we see the book idle
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (target.queued.load(std::memory_order_relaxed)) {return;}
+        if (!target.queued.exchange(true, std::memory_order_acq_rel)) {
+            enqueue(target.home.load(std::memory_order_relaxed), book);
+        }
+    }
+
+    std::size_t books() const noexcept { return book_count_.load(std::memory_order_acquire); }
+    std::size_t workers() const noexcept { return workers_.size(); }
+
+    /// any thread
+    scheduler_stats_t stats() const
+    {
+        scheduler_stats_t result{.workers = {}, .books = {}, .full_waits = full_waits_.load(std::memory_order_relaxed)};
+        for (const auto& worker : workers_) {
+            result.workers.push_back(scheduler_worker_stats_t{
+                .commands = worker->commands.load(std::memory_order_relaxed),
+                .runs = worker->runs.load(std::memory_order_relaxed),
+                .steals = worker->steals.load(std::memory_order_relaxed),
+                .idle_polls = worker->idle_polls.load(std::memory_order_relaxed),
+            });
+        }
+        const std::size_t count = books();
+        for (std::size_t i = 0; i < count; ++i) {
+            const book_t& book = *books_[i];
+            result.books.push_back(scheduler_book_stats_t{
+                .commands = book.commands.load(std::memory_order_relaxed),
+                .runs = book.runs.load(std::memory_order_relaxed),
+                .migrations = book.migrations.load(std::memory_order_relaxed),
+                .backlog = book.queue.approx_size(),
+            });
+        }
+        return result;
+    }
+
+private:
+    struct book_t {
+        book_t(std::size_t capacity_pow2, std::size_t first_home) : queue(capacity_pow2), home(first_home) {}
+
+        concurrency::SpscRing<Cmd> queue;
+        alignas(64) std::atomic<bool> queued{false}; // in a run queue or being run
+        std::atomic<std::size_t> home; // worker that ran it last, where it is queued when it becomes runnable
+        // written by the worker running the book
+        std::atomic<std::uint64_t> commands{0};
+        std::atomic<std::uint64_t> runs{0};
+        std::atomic<std::uint64_t> migrations{0};
+    };
+
+    struct alignas(64) worker_t {
+        std::mutex mutex;
+        std::deque<std::size_t> run_queue; // runnable books, guarded by mutex
+        std::atomic<std::size_t> queued{0}; // run_queue size, read by thieves without the lock
+        // written by the worker only
+        std::atomic<std::uint64_t> commands{0};
+        std::atomic<std::uint64_t> runs{0};
+        std::atomic<std::uint64_t> steals{0};
+        std::atomic<std::uint64_t> idle_polls{0};
+        std::thread thread;
+    };
+
+    handler_t handler_;
+    const std::size_t max_books_;
+    const std::size_t queue_capacity_;
+    const std::size_t quantum_;
+    std::unique_ptr<std::unique_ptr<book_t>[]> books_; // fixed table, books never move
+    std::atomic<std::size_t> book_count_{0};
+    std::vector<std::unique_ptr<worker_t>> workers_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<std::uint64_t> full_waits_{0};
+    bool running_{false};
+
+    void enqueue(std::size_t worker, std::size_t book)
+    {
+        worker_t& target = *workers_[worker];
+        std::lock_guard lock(target.mutex);
+        target.run_queue.push_back(book);
+        target.queued.store(target.run_queue.size(), std::memory_order_relaxed);
+    }
+
+    bool pop_own(worker_t& self, std::size_t& book)
+    {
+        if (self.queued.load(std::memory_order_relaxed) == 0) {return false;}
+        std::lock_guard lock(self.mutex);
+        if (self.run_queue.empty()) {return false;}
+        book = self.run_queue.front();
+        self.run_queue.pop_front();
+        self.queued.store(self.run_queue.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    // the busiest worker's book with the largest backlog
+    bool steal(std::size_t thief, std::size_t& book)
+    {
+        std::size_t victim = thief;
+        std::size_t longest = 0;
+        for (std::size_t i = 0; i < workers_.size(); ++i) {
+            const std::size_t queued = workers_[i]->queued.load(std::memory_order_relaxed);
+            if (i != thief && queued > longest) {
+                victim = i;
+                longest = queued;
+            }
+        }
+        if (victim == thief) {return false;}
+
+        worker_t& target = *workers_[victim];
+        std::lock_guard lock(target.mutex);
+        if (target.run_queue.empty()) {return false;}
+        auto hottest = target.run_queue.begin();
+        std::size_t largest = 0;
+        for (auto it = target.run_queue.begin(); it != target.run_queue.end(); ++it) {
+            const std::size_t backlog = books_[*it]->queue.approx_size();
+            if (backlog > largest) {
+                hottest = it;
+                largest = backlog;
+            }
+        }
+        book = *hottest;
+        target.run_queue.erase(hottest);
+        target.queued.store(target.run_queue.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    void run(std::size_t index)
+    {
+        worker_t& self = *workers_[index];
+        std::vector<Cmd> batch(quantum_);
+        while (true) {
+            // read before the scan: a worker leaves only after a scan that started once nothing more could be submitted
+            const bool stopping = stopping_.load(std::memory_order_seq_cst);
+            std::size_t book = 0;
+            if (pop_own(self, book)) {
+                run_book(index, book, batch);
+            } else if (steal(index, book)) {
+                concurrency::bump(self.steals);
+                run_book(index, book, batch);
+            } else if (stopping) {
+                break;
+            } else {
+                concurrency::bump(self.idle_polls);
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void run_book(std::size_t index, std::size_t book, std::vector<Cmd>& batch)
+    {
+        worker_t& self = *workers_[index];
+        book_t& target = *books_[book];
+        if (target.home.load(std::memory_order_relaxed) != index) {
+            concurrency::bump(target.migrations);
+            target.home.store(index, std::memory_order_relaxed);
+        }
+        const std::size_t num = target.queue.try_pop_n(batch.data(), batch.size());
+        for (std::size_t i = 0; i < num; ++i) {handler_(index, book, batch[i]);}
+        concurrency::bump(target.commands, num);
+        concurrency::bump(target.runs);
+        concurrency::bump(self.commands, num);
+        concurrency::bump(self.runs);
+
+        if (target.queue.approx_size() > 0) {
+            enqueue(index, book); // more work: behind the other runnable books
+            return;
+        }
+        target.queued.store(false, std::memory_order_release); // the next worker sees this run through the submitter
+        // pairs with the fence in submit(): a command pushed meanwhile is seen here or by the submitter
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (target.queue.approx_size() > 0 && !target.queued.exchange(true, std::memory_order_acq_rel)) {
+            enqueue(index, book);
+        }
+    }
+};
+
+} // namespace engine
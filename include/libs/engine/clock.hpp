@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace engine {
+
+/**
+ * @brief engine::TscClock turns the CPU time-stamp counter into nanoseconds on the std::chrono::steady_clock time line, so a reading is one rdtsc and one multiply instead of a clock_gettime call. The tick rate is calibrated once per process against steady_clock on first use of instance(). Values taken on different cores are comparable only with an invariant TSC (see invariant()); where no TSC is available the ticks are steady_clock nanoseconds.
+ *
+ */
+class TscClock {
+public:
+    static constexpr auto calibration_time = std::chrono::milliseconds(10);
+
+    /// the process-wide clock; the first call blocks for calibration_time
+    static const TscClock& instance();
+
+    /// raw counter value
+    static std::uint64_t ticks() noexcept
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    /// nanoseconds since the steady_clock epoch
+    std::uint64_t now_ns() const noexcept { return to_ns(ticks()); }
+    /// a tick before the calibration base (read earlier, or on a core slightly behind) maps before base_ns_, never below 0
+    std::uint64_t to_ns(std::uint64_t tsc) const noexcept
+    {
+        const double offset_ns = static_cast<double>(static_cast<std::int64_t>(tsc - base_ticks_)) * ns_per_tick_;
+        if (offset_ns >= 0.0) {return base_ns_ + static_cast<std::uint64_t>(offset_ns);}
+        const auto back_ns = static_cast<std::uint64_t>(-offset_ns);
+        return back_ns < base_ns_ ? base_ns_ - back_ns : 0;
+    }
+
+    double ns_per_tick() const noexcept { return ns_per_tick_; }
+    bool invariant() const noexcept { return invariant_; } ///< the counter ticks at a constant rate across cores and power states
+
+private:
+    TscClock();
+
+    std::uint64_t base_ticks_{0};
+    std::uint64_t base_ns_{0};
+    double ns_per_tick_{1.0};
+    bool invariant_{false};
+};
+
+} // namespace engine
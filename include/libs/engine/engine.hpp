@@ -8,13 +8,15 @@
  */
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
 #include <limits>
+#include <memory_resource>
 #include <optional>
+#include <span>
 #include <vector>
 #include <memory>
-#include <map>
-#include <deque>
 
 namespace engine {
 
@@ -23,16 +25,27 @@ namespace engine {
 using price_t = int64_t; // ticks price -> e.g., price=12345 means 123.45 if tick size is 0.01
 using qty_t = int64_t;  // quantity
 using id_t = uint64_t; // unique identifier
+using owner_t = uint32_t; // client/owner tag
+
+inline constexpr owner_t NO_OWNER = 0; // order carries no owner tag; reserved, add_order rejects it as a tag (BAD_INPUT) and OWNER mass cancel never selects it
 
 enum class Side : uint8_t { BUY, SELL };
 enum class OrderType : uint8_t { LIMIT, MARKET };
-enum class TimeInForce : uint8_t { GTC, IOC, FOK }; // Good-Til-Canceled, Immediate-Or-Cancel, Fill-Or-Kill
+enum class TimeInForce : uint8_t { GTC, IOC, FOK, GTD }; // Good-Til-Canceled, Immediate-Or-Cancel, Fill-Or-Kill, Good-Til-Date (rests until order_cmd_t::expire_at)
 enum class OrderStatus : uint8_t { OK, PARTIAL, FILLED, REJECT, FOK_FAIL, EMPTY_BOOK, BAD_INPUT };
+enum class LevelLayout : uint8_t { AOS, SOA }; // resting orders per level: array of {id, qty} records, or separate id/qty arrays
+enum class MassCancelScope : uint8_t { SIDE, PRICE, OWNER }; // whole side, levels past a price, orders of one owner
+enum class MatchingMode : uint8_t { CONTINUOUS, AUCTION }; // match every order on arrival, or collect orders and uncross them in one batch
+enum class CancelMode : uint8_t { ERASE, TOMBSTONE }; // remove a cancelled order from its level queue, or mark it dead in O(1) and compact the level later
+enum class ClockSource : uint8_t { SEQUENCE, TSC, CALLER }; // engine timestamps: the command sequence number, TscClock nanoseconds, or order_cmd_t::timestamp
+enum class FillReport : uint8_t { TRADES, LEVELS, BOTH }; // add_order reports one trade_t per maker, one level_fill_t per price level crossed, or both
 
 // --------- Data Structures ---------
 
+struct trace_t; // see trace.hpp
+
 /**
- * @brief engine::OrderCmd is a structure representing a command to create new orders, with fields for optional order ID, side (defaulting to BUY), order type (defaulting to LIMIT), time-in-force (defaulting to GTC), price (for LIMIT orders), quantity, and an optional user-provided timestamp. This structure is used to encapsulate all necessary details for defining and submitting an order.
+ * @brief engine::OrderCmd is a structure representing a command to create new orders, with fields for optional order ID, side (defaulting to BUY), order type (defaulting to LIMIT), time-in-force (defaulting to GTC), price (for LIMIT orders), quantity, and an optional user-provided timestamp. This structure is used to encapsulate all necessary details for defining and submitting an order. A GTD order needs an expire_at after the engine time of its command: it is rejected with BAD_INPUT without one and with REJECT once that time has passed.
  * 
  */
 struct order_cmd_t {
@@ -42,11 +55,14 @@ struct order_cmd_t {
     TimeInForce time_in_force{TimeInForce::GTC}; ///< time in force (default: GTC)
     price_t price{0}; ///< price for LIMIT orders
     qty_t qty{0}; ///< quantity
-    uint64_t timestamp{0}; ///< optional user timestamp
+    uint64_t timestamp{0}; ///< optional user timestamp, the engine time of the command with ClockSource::CALLER
+    uint64_t expire_at{0}; ///< GTD: engine time at which the resting remainder is removed (same clock as engine_config_t::clock)
+    std::optional<owner_t> owner = std::nullopt; ///< optional client/owner tag, used by mass cancel (NO_OWNER is rejected)
+    trace_t* trace{nullptr}; ///< optional: per-stage stamps of this command (not owned), written by every stage it passes
 };
 
 /**
- * @brief engine::order_t is a structure representing an order in a trading system, containing fields for a unique order ID, side (BUY or SELL), price, quantity, and an internal sequence number for ordering. This structure encapsulates all necessary details of an order for processing within the order book.
+ * @brief engine::order_t is a structure representing an incoming order handed to the order book, containing fields for a unique order ID, side (BUY or SELL), price, quantity and owner tag. Once an order rests in the book only its id and open quantity are kept; side and price are implied by its level, and time priority by its queue position.
  * 
  */
 struct order_t {
@@ -54,11 +70,11 @@ struct order_t {
     Side side{}; ///< side of the order (BUY or SELL)
     price_t price{}; ///< price of the order
     qty_t qty{}; ///< quantity of the order
-    uint64_t seq_num{}; ///< internal sequence number for ordering - now timestamp is used
+    owner_t owner{NO_OWNER}; ///< client/owner tag (NO_OWNER if untagged)
 };
 
 /**
- * @brief engine::trade_t is a structure representing a trade execution in a trading system, containing fields for the taker order ID, maker order ID, trade price, trade quantity, and a timestamp indicating when the trade occurred. This structure encapsulates all necessary details of a trade for record-keeping and processing.
+ * @brief engine::trade_t is a structure representing a trade execution in a trading system, containing fields for the taker order ID, maker order ID, trade price, trade quantity, a timestamp indicating when the trade occurred, and the engine sequence number of the command that produced it. The timestamp comes from the clock chosen by engine_config_t::clock; the sequence number always counts commands, so trades stay ordered whatever the clock.
  * 
  */
 struct trade_t {
@@ -66,7 +82,22 @@ struct trade_t {
     id_t maker{}; ///< order id of the maker: from ask list
     price_t price{}; ///< price of the trade
     qty_t qty{}; ///< quantity of the trade
-    uint64_t timestamp{}; ///< trade execution time
+    uint64_t timestamp{}; ///< trade execution time from the engine clock
+    uint64_t seq{}; ///< engine sequence number of the command that produced the trade
+
+    bool operator==(const trade_t&) const = default;
+};
+
+/**
+ * @brief engine::level_fill_t is the taker's side of one price level it executed against: the level price, the total quantity filled there and the number of maker orders it came from. With FillReport::LEVELS a sweep through many small makers is reported as one record per level instead of one trade_t per maker; the maker fills themselves are handed to engine_config_t::fill_sink.
+ * 
+ */
+struct level_fill_t {
+    price_t price{}; ///< price of the level
+    qty_t qty{}; ///< total quantity filled at this level
+    uint32_t makers{}; ///< maker orders filled at this level
+
+    bool operator==(const level_fill_t&) const = default;
 };
 
 /**
@@ -76,6 +107,8 @@ struct trade_t {
 struct snapshot_level_t {
     price_t price{}; ///< price level of snapshot
     qty_t qty{}; ///< quantity at this price level
+
+    bool operator==(const snapshot_level_t&) const = default;
 };
 
 /**
@@ -87,6 +120,17 @@ struct snapshot_t {
     std::vector<snapshot_level_t> asks; ///< sorted ascending by price
 };
 
+/**
+ * @brief engine::snapshot_counts_t is returned by the caller-buffer snapshot APIs. It reports how many bid and ask levels are valid in the caller's buffers, how many of them were written by this call, and the book version they reflect, which can be handed back to fetch only the levels changed since.
+ * 
+ */
+struct snapshot_counts_t {
+    std::size_t bids{0}; ///< number of valid bid levels
+    std::size_t asks{0}; ///< number of valid ask levels
+    std::size_t updated{0}; ///< number of levels written by this call
+    std::uint64_t version{0}; ///< book version reflected by the buffers
+};
+
 /**
  * @brief engine::add_result_t represents the result of adding an order to the order book, containing the status of the operation and the ID of the newly created order (if successful).
  * 
@@ -94,30 +138,58 @@ struct snapshot_t {
 struct add_result_t {
     OrderStatus status{OrderStatus::OK}; ///< status of the add order operation
     id_t order_id{}; ///< id of the newly created order (if successful)
-    std::vector<trade_t> trades; ///< trades executed as a result of this order
+    std::vector<trade_t> trades; ///< trades executed as a result of this order, one per maker (FillReport::TRADES or BOTH)
+    std::vector<level_fill_t> level_fills; ///< the same executions aggregated per price level, in matching order (FillReport::LEVELS or BOTH)
     qty_t filled_qty{0}; ///< quantity filled immediately
     qty_t remaining_qty{0}; ///< quantity remaining in the book
+
+    bool operator==(const add_result_t&) const = default;
+};
+
+/**
+ * @brief engine::mass_cancel_cmd_t describes a bulk cancel request. SIDE cancels every resting order on the selected side(s), PRICE cancels every level at or past the given price (bids priced at or below it, asks priced at or above it), and OWNER cancels every order tagged with the given owner. An empty side applies the request to both sides of the book.
+ * 
+ */
+struct mass_cancel_cmd_t {
+    MassCancelScope scope{MassCancelScope::SIDE}; ///< which orders are selected
+    std::optional<Side> side = std::nullopt; ///< side to cancel on (nullopt: both sides)
+    price_t price{0}; ///< boundary price for PRICE scope (inclusive)
+    owner_t owner{NO_OWNER}; ///< owner tag for OWNER scope
 };
 
 /**
- * @brief engine::locate_t is a structure used to locate an order within the order book, containing fields for the side of the order (BUY or SELL), iterators pointing to the price level in the bid or ask book, and an iterator pointing to the specific order within the price level's queue. This structure facilitates efficient access and management of orders in the order book.
+ * @brief engine::mass_cancel_result_t reports how many resting orders a mass cancel removed and their total remaining quantity.
  * 
  */
-struct locate_t {
-    Side side; ///< side of the order (BUY or SELL)
-    std::map<price_t, std::deque<order_t>, std::greater<>>::iterator bid_it; ///< point to price node (iterator) in order book map
-    std::map<price_t, std::deque<order_t>, std::less<>>::iterator ask_it; ///< point to price node (iterator) in order book map
-    std::deque<order_t>::iterator q_it;     ///< point to order in the price level queue
+struct mass_cancel_result_t {
+    std::uint64_t cancelled{0}; ///< number of orders cancelled
+    qty_t cancelled_qty{0}; ///< total open quantity cancelled
+
+    bool operator==(const mass_cancel_result_t&) const = default;
 };
 
 /**
- * @brief engine::engine_metrics_t is a structure for tracking various performance and state metrics of the trading engine, including counts of added and canceled orders, trade statistics, order book state hints, and latency statistics for order additions.
+ * @brief engine::uncross_result_t is the outcome of a batch auction uncross. Every execution happens at the single clearing price that maximizes executed volume; an auction has no aggressor, so each trade carries the buy order as taker and the sell order as maker. The imbalance is the bid quantity minus the ask quantity willing to trade at the clearing price, i.e. what is left unfilled on the surplus side.
+ * 
+ */
+struct uncross_result_t {
+    price_t price{0}; ///< clearing price (0 when the book was not crossed)
+    qty_t volume{0}; ///< quantity executed at the clearing price
+    qty_t imbalance{0}; ///< bid minus ask quantity at the clearing price
+    std::vector<trade_t> trades; ///< executions in price-time priority of both sides
+
+    bool operator==(const uncross_result_t&) const = default;
+};
+
+/**
+ * @brief engine::engine_metrics_t is a structure for tracking various performance and state metrics of the trading engine, including counts of added and canceled orders, trade statistics, order book state hints, and latency statistics for order additions. IEngine::metrics() returns a copy that is safe to take from any thread: the engine keeps the counters as single-writer relaxed atomics and the best bid/ask under a seqlock, so the four book fields always come from the same update.
  * 
  */
 struct engine_metrics_t {
     // volume & counts
     std::uint64_t add_orders = 0; ///< number of orders added
     std::uint64_t cancel_orders = 0; ///< number of orders canceled
+    std::uint64_t expired_orders = 0; ///< number of GTD orders removed at their expiry
     std::uint64_t trades = 0; ///< number of trades executed
     std::uint64_t traded_qty = 0; ///< total quantity traded
 
@@ -134,12 +206,87 @@ struct engine_metrics_t {
     std::uint64_t add_total_ns = 0; ///< total nanoseconds
 };
 
+inline constexpr std::size_t latency_buckets = 32;
+
+/**
+ * @brief engine::latency_histogram_t is a copy of a log2 latency histogram: bucket i counts samples in (2^(i-1), 2^i] ns (bucket 0 holds 0 and 1 ns), and the last bucket also takes everything above its bound. Like engine_metrics_t it can be read from any thread.
+ * 
+ */
+struct latency_histogram_t {
+    std::array<std::uint64_t, latency_buckets> counts{}; ///< samples per bucket
+    std::uint64_t sum_ns = 0; ///< sum of all samples
+
+    std::uint64_t count() const noexcept
+    {
+        std::uint64_t total = 0;
+        for (const auto bucket : counts) { total += bucket; }
+        return total;
+    }
+    /// inclusive upper bound of bucket i in ns; the last bucket is unbounded
+    static constexpr std::uint64_t upper_bound_ns(std::size_t bucket) noexcept { return std::uint64_t{1} << bucket; }
+};
+
+/**
+ * @brief engine::memory_usage_t is what the counting allocator hook saw for one engine structure: the bytes currently held, the high-water mark, and the number of allocate and deallocate calls. A steadily growing bytes_in_use with a flat order count points at a leak; a widening gap between allocations and deallocations at churn.
+ * 
+ */
+struct memory_usage_t {
+    std::uint64_t bytes_in_use = 0; ///< bytes currently allocated
+    std::uint64_t peak_bytes = 0; ///< highest bytes_in_use seen
+    std::uint64_t allocations = 0; ///< number of allocate calls
+    std::uint64_t deallocations = 0; ///< number of deallocate calls
+};
+
+/**
+ * @brief engine::memory_stats_t is the memory footprint of an engine: live counts of levels, resting orders and index entries, and the bytes held by each structure. levels covers the price level map nodes, queues the per-level order storage (ids, quantities, owners), and index the id index nodes and bucket array. queue_slots above resting_orders is storage kept by levels for consumed or cancelled orders.
+ * 
+ */
+struct memory_stats_t {
+    std::uint64_t bid_levels = 0; ///< number of bid price levels
+    std::uint64_t ask_levels = 0; ///< number of ask price levels
+    std::uint64_t resting_orders = 0; ///< orders resting in the levels
+    std::uint64_t queue_slots = 0; ///< order slots allocated by the levels (capacity)
+    std::uint64_t tombstones = 0; ///< cancelled orders still holding a slot in their level queue (CancelMode::TOMBSTONE)
+    std::uint64_t index_entries = 0; ///< entries in the id index
+    std::uint64_t index_buckets = 0; ///< buckets of the id index
+
+    memory_usage_t levels{}; ///< price level map nodes
+    memory_usage_t queues{}; ///< per-level order storage
+    memory_usage_t index{}; ///< id index nodes and buckets
+
+    std::uint64_t total_bytes() const noexcept { return levels.bytes_in_use + queues.bytes_in_use + index.bytes_in_use; }
+    double bytes_per_order() const noexcept { return resting_orders == 0 ? 0.0 : static_cast<double>(total_bytes()) / static_cast<double>(resting_orders); }
+};
+
 // --------- Engine Interface ---------
 
+class EventPublisher; // see event_publisher.hpp
+
+/**
+ * @brief engine::IFillSink receives every maker fill of continuous matching as it happens, on the thread that drives the engine and before add_order returns, whatever engine_config_t::fill_report is. It keeps the maker side available when add_order reports level aggregates only. on_fill runs inside the matching loop, so it should only record the fill.
+ * 
+ */
+class IFillSink {
+    public:
+    virtual ~IFillSink() = default;
+    virtual void on_fill(const trade_t& fill) = 0;
+};
+
 /// @brief Engine configuration options
 struct engine_config_t {
     bool market_gtc_as_ioc{true}; ///< MARKET + GTC : true -> IOC by default, false -> REJECT
     uint64_t market_max_levels{0}; ///< optional: Max levels in market depth snapshot
+    LevelLayout level_layout{LevelLayout::AOS}; ///< storage layout of resting orders in a price level
+    EventPublisher* publisher{nullptr}; ///< optional: orders, trades, cancels and top-of-book changes are published here (not owned, must outlive the engine)
+    std::pmr::memory_resource* memory_resource{nullptr}; ///< optional: upstream for all book containers, e.g. a BookArena (not owned, must outlive the engine); nullptr uses the default resource
+    std::size_t reserve_orders{0}; ///< optional: pre-size the id index for this many resting orders, so it never rehashes below that
+    std::uint32_t warmup_orders{0}; ///< optional: synthetic orders run through the engine by make_engine to warm caches, pools and the index; the book, ids, timestamps and metrics are reset afterwards and nothing is published
+    MatchingMode matching_mode{MatchingMode::CONTINUOUS}; ///< AUCTION starts in order collection, e.g. for an opening auction
+    CancelMode cancel_mode{CancelMode::ERASE}; ///< TOMBSTONE makes cancel O(1) whatever the queue position; dead slots are skipped by matching and reclaimed by compaction
+    double compact_dead_ratio{0.5}; ///< TOMBSTONE: a level is compacted by the cancel that makes this share of its slots dead
+    ClockSource clock{ClockSource::SEQUENCE}; ///< source of trade and event timestamps; TSC calibrates TscClock on first use, CALLER suits deterministic replay
+    FillReport fill_report{FillReport::TRADES}; ///< how add_order (and the publisher) report executions: per maker, per price level, or both
+    IFillSink* fill_sink{nullptr}; ///< optional: every maker fill of continuous matching, as it happens (not owned, must outlive the engine); uncross() results keep their trades
 };
 
 class IEngine {
@@ -147,8 +294,46 @@ class IEngine {
     virtual ~IEngine() = default;
     virtual add_result_t add_order(const order_cmd_t& cmd) = 0;
     virtual bool cancel_order(id_t order_id) = 0;
+    virtual mass_cancel_result_t mass_cancel(const mass_cancel_cmd_t& cmd) = 0;
+    /// remove GTD orders expiring at or before now (engine time); add_order and uncross do this at the time of their command, so callers only need it while no commands arrive
+    virtual mass_cancel_result_t expire_orders(std::uint64_t now) = 0;
+    /// engine time of the last command, from the clock chosen by engine_config_t::clock
+    virtual std::uint64_t engine_time() const = 0;
+    /// execute every crossing order at the price that maximizes executed volume; the mode is unchanged
+    virtual uncross_result_t uncross() = 0;
+    /// in AUCTION mode GTC limit orders rest without matching (other orders are rejected); switching to CONTINUOUS uncrosses first and returns that result
+    virtual uncross_result_t set_matching_mode(MatchingMode mode) = 0;
+    virtual MatchingMode matching_mode() const = 0;
     virtual snapshot_t snapshot(int depth) const = 0;
+    /// fill caller-owned buffers with the top levels (depth = buffer size), no allocation; unused slots are cleared to price 0
+    virtual snapshot_counts_t snapshot_into(std::span<snapshot_level_t> bids, std::span<snapshot_level_t> asks) const = 0;
+    /// like snapshot_into, but the buffers must hold the result at since_version; only levels changed since are rewritten
+    virtual snapshot_counts_t snapshot_changed_into(std::span<snapshot_level_t> bids, std::span<snapshot_level_t> asks, std::uint64_t since_version) const = 0;
+    /// counters and latency summary; any thread
     virtual engine_metrics_t metrics() const = 0;
+    /// add_order matching latency; any thread
+    virtual latency_histogram_t add_latency() const = 0;
+    /// live structure counts and bytes held per structure; read on the thread that drives the engine
+    virtual memory_stats_t memory_stats() const = 0;
+    /// idle-time work: compact up to max_levels levels holding tombstones, best prices first with bids and asks taking turns (0 = all); returns the slots reclaimed
+    virtual std::size_t compact(std::size_t max_levels) = 0;
+};
+
+/**
+ * @brief engine::fixed_snapshot_t is a fixed-capacity, caller-owned depth snapshot. refresh() keeps it current by rewriting only the levels changed since its last refresh, so high-frequency depth polling neither allocates nor copies unchanged levels.
+ * 
+ */
+template <std::size_t Depth>
+struct fixed_snapshot_t {
+    std::array<snapshot_level_t, Depth> bids{}; ///< sorted descending by price, first counts.bids valid
+    std::array<snapshot_level_t, Depth> asks{}; ///< sorted ascending by price, first counts.asks valid
+    snapshot_counts_t counts{}; ///< valid levels and the book version of the buffers
+
+    snapshot_counts_t refresh(const IEngine& engine)
+    {
+        counts = engine.snapshot_changed_into(bids, asks, counts.version);
+        return counts;
+    }
 };
 
 // Factory function to create an engine instance
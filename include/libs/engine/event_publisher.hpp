@@ -0,0 +1,156 @@
+#pragma once
+
+#include <libs/engine/engine.hpp>
+#include <libs/concurrency/spsc_ring.hpp>
+#include <libs/concurrency/single_writer.hpp>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace engine {
+
+enum class EventType : uint8_t { ORDER, TRADE, CANCEL, MASS_CANCEL, TOP_OF_BOOK, EXPIRE, LEVEL_FILL };
+
+/**
+ * @brief engine::event_t is the fixed-size record the matching thread hands to the publisher. It is one cache line and trivially copyable, so publishing is a single ring write. Field use per type: ORDER (order_id, code=OrderStatus, qty=filled, remaining_qty), TRADE (order_id=taker, aux=maker, price, qty), CANCEL (order_id, code=1 if found), MASS_CANCEL (aux=orders cancelled, qty=quantity cancelled), TOP_OF_BOOK (code=Side, price, qty; 0/0 when the side is empty), EXPIRE (order_id, qty=open quantity removed at its GTD expiry), LEVEL_FILL (order_id=taker, price, qty=filled at the level, aux=makers; sent instead of or besides TRADE as engine_config_t::fill_report selects).
+ *
+ */
+struct event_t {
+    EventType type{EventType::ORDER}; ///< kind of event
+    uint8_t code{0}; ///< status, side or found flag depending on type
+    uint16_t reserved{0}; ///< padding
+    uint32_t source{0}; ///< caller-defined source tag (e.g. symbol index)
+    id_t order_id{0}; ///< order id (taker for TRADE)
+    uint64_t aux{0}; ///< maker id for TRADE, maker count for LEVEL_FILL, cancelled count for MASS_CANCEL
+    price_t price{0}; ///< trade or level price
+    qty_t qty{0}; ///< trade, filled, level or cancelled quantity
+    qty_t remaining_qty{0}; ///< remaining quantity for ORDER
+    uint64_t timestamp{0}; ///< engine timestamp of the command
+    uint64_t seq{0}; ///< publish sequence number, gaps reveal drops
+};
+
+static_assert(sizeof(event_t) == 64, "event_t should stay one cache line");
+
+/**
+ * @brief engine::publisher_stats_t is a point-in-time view of an EventPublisher, readable from any thread.
+ *
+ */
+struct publisher_stats_t {
+    std::uint64_t published{0}; ///< events accepted into the ring
+    std::uint64_t dropped{0}; ///< events dropped because the ring was full
+    std::uint64_t delivered{0}; ///< events handed to the sinks
+    std::uint64_t batches{0}; ///< sink deliveries
+    std::size_t occupancy{0}; ///< events currently waiting in the ring (approximate)
+    std::size_t capacity{0}; ///< ring capacity
+    concurrency::ring_stats_t ring{}; ///< ring telemetry: high-water mark, occupancy histogram, empty polls
+};
+
+/**
+ * @brief engine::IEventSink receives batches of events on the publisher thread.
+ *
+ */
+class IEventSink {
+public:
+    virtual ~IEventSink() = default;
+    virtual void on_events(std::span<const event_t> events) = 0;
+    virtual void flush() {}
+};
+
+/**
+ * @brief engine::CallbackEventSink forwards every batch to an in-process callback.
+ *
+ */
+class CallbackEventSink final : public IEventSink {
+public:
+    using callback_t = std::function<void(std::span<const event_t>)>;
+
+    explicit CallbackEventSink(callback_t callback) : callback_(std::move(callback)) {}
+    void on_events(std::span<const event_t> events) override { callback_(events); }
+
+private:
+    callback_t callback_;
+};
+
+/**
+ * @brief engine::FileEventSink appends the raw 64-byte event records to a file through a large stdio buffer.
+ *
+ */
+class FileEventSink final : public IEventSink {
+public:
+    explicit FileEventSink(const std::string& path, std::size_t buffer_bytes = 1U << 20);
+    ~FileEventSink() override;
+
+    FileEventSink(const FileEventSink&) = delete;
+    FileEventSink& operator=(const FileEventSink&) = delete;
+
+    bool is_open() const noexcept { return file_ != nullptr; }
+    void on_events(std::span<const event_t> events) override;
+    void flush() override;
+
+private:
+    std::FILE* file_;
+    std::vector<char> buffer_;
+};
+
+/**
+ * @brief engine::EventPublisher moves event delivery off the matching path. The matching thread (single producer) calls publish(), which writes into a concurrency::SpscRing and never blocks: when the ring is full the event is dropped and counted. A publisher thread drains the ring in batches and hands them to the registered sinks.
+ *
+ */
+class EventPublisher {
+public:
+    static constexpr std::size_t default_capacity = 1U << 16;
+    static constexpr std::size_t batch_size = 512;
+
+    explicit EventPublisher(std::size_t capacity_pow2 = default_capacity) : ring_(capacity_pow2) {}
+    ~EventPublisher() { stop(); }
+
+    EventPublisher(const EventPublisher&) = delete;
+    EventPublisher& operator=(const EventPublisher&) = delete;
+
+    /// register a sink; only before start()
+    void add_sink(std::shared_ptr<IEventSink> sink) { sinks_.push_back(std::move(sink)); }
+
+    void start();
+    /// drain what is left in the ring, flush the sinks and join the publisher thread
+    void stop();
+
+    /// matching thread only; false if the ring was full and the event was dropped
+    bool publish(event_t event) noexcept
+    {
+        event.seq = next_seq_++;
+        if (!ring_.push(event)) {
+            concurrency::bump(dropped_);
+            return false;
+        }
+        concurrency::bump(published_);
+        return true;
+    }
+
+    publisher_stats_t stats() const noexcept;
+
+private:
+    concurrency::SpscRing<event_t, true> ring_;
+    std::vector<std::shared_ptr<IEventSink>> sinks_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    // producer-side counters, written only by the matching thread
+    alignas(64) std::atomic<std::uint64_t> published_{0};
+    std::atomic<std::uint64_t> dropped_{0};
+    std::uint64_t next_seq_{0};
+
+    // consumer-side counters, written only by the publisher thread
+    alignas(64) std::atomic<std::uint64_t> delivered_{0};
+    std::atomic<std::uint64_t> batches_{0};
+
+    void run();
+    std::size_t drain(std::vector<event_t>& batch);
+};
+
+}  // namespace engine
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <libs/engine/engine.hpp>
+#include <libs/concurrency/single_writer.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace engine {
+
+/**
+ * @brief engine::LatencyHistogram is the live form of latency_histogram_t: written by one thread, copied by load() from any thread. A record is one bit_width and two relaxed stores.
+ *
+ */
+class LatencyHistogram {
+public:
+    void record(std::uint64_t ns) noexcept
+    {
+        // (2^(i-1), 2^i] -> i
+        const auto bucket = std::min<std::size_t>(std::bit_width(ns - (ns != 0)), latency_buckets - 1);
+        concurrency::bump(counts_[bucket]);
+        concurrency::bump(sum_ns_, ns);
+    }
+
+    latency_histogram_t load() const noexcept
+    {
+        latency_histogram_t result{};
+        for (std::size_t i = 0; i < latency_buckets; ++i) {
+            result.counts[i] = counts_[i].load(std::memory_order_relaxed);
+        }
+        result.sum_ns = sum_ns_.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    /// writer thread only
+    void reset() noexcept
+    {
+        for (auto& count : counts_) {count.store(0, std::memory_order_relaxed);}
+        sum_ns_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::array<std::atomic<std::uint64_t>, latency_buckets> counts_{};
+    std::atomic<std::uint64_t> sum_ns_{0};
+};
+
+} // namespace engine
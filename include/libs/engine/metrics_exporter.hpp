@@ -0,0 +1,68 @@
+#pragma once
+
+#include <libs/engine/engine.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace engine {
+
+class EventPublisher; // see event_publisher.hpp
+
+/**
+ * @brief engine::MetricsExporter periodically writes the metrics of registered engines and event publishers to a file in the Prometheus text exposition format (counters, gauges and the add latency histogram, one label per source), e.g. for the node_exporter textfile collector. It runs on its own thread and only reads what the sources already keep in relaxed atomics, so the matching threads pay nothing for it beyond their counter updates. Each dump is written to a temporary file and renamed over the target, so a scraper never sees half a file. A failed write is counted and its reason kept in error().
+ *
+ */
+class MetricsExporter {
+public:
+    explicit MetricsExporter(std::string path, std::chrono::milliseconds period = std::chrono::milliseconds(1000));
+    ~MetricsExporter() { stop(); }
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    /// register a source under a label value; only before start(), the source must outlive the exporter
+    void add_engine(std::string name, const IEngine& engine) { engines_.push_back({std::move(name), &engine}); }
+    void add_publisher(std::string name, const EventPublisher& publisher) { publishers_.push_back({std::move(name), &publisher}); }
+
+    void start();
+    /// join the exporter thread after a final dump
+    void stop();
+
+    /// one dump now, on the calling thread; false if the file could not be written
+    bool write_now();
+    /// the text of one dump
+    std::string format() const;
+
+    std::uint64_t dumps() const noexcept { return dumps_.load(std::memory_order_relaxed); } ///< files written
+    std::uint64_t failures() const noexcept { return failures_.load(std::memory_order_relaxed); } ///< writes that failed
+    std::string error() const; ///< reason of the last failed write
+
+private:
+    template <class Source>
+    struct named_t {
+        std::string name;
+        const Source* source;
+    };
+
+    std::string path_;
+    std::chrono::milliseconds period_;
+    std::vector<named_t<IEngine>> engines_;
+    std::vector<named_t<EventPublisher>> publishers_;
+    std::thread thread_;
+    bool running_{false}; // guarded by mutex_
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::atomic<std::uint64_t> dumps_{0};
+    std::atomic<std::uint64_t> failures_{0};
+    std::string error_; // guarded by mutex_
+
+    void run();
+};
+
+} // namespace engine
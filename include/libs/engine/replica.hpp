@@ -0,0 +1,134 @@
+#pragma once
+
+#include <libs/engine/engine.hpp>
+#include <libs/concurrency/spsc_ring.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace engine {
+
+enum class ReplicaOp : uint8_t { ADD, CANCEL, MASS_CANCEL, UNCROSS, SET_MODE, EXPIRE };
+
+/**
+ * @brief engine::replica_cmd_t is one accepted command forwarded to the replica. Adds carry the order id the primary assigned, so the replica book holds the same ids, and every command carries the primary's engine time, so GTD orders expire on the replica at the same point of the command stream.
+ *
+ */
+struct replica_cmd_t {
+    ReplicaOp op{ReplicaOp::ADD}; ///< which IEngine call to replay
+    MatchingMode mode{MatchingMode::CONTINUOUS}; ///< SET_MODE target
+    id_t cancel_id{0}; ///< CANCEL order id
+    order_cmd_t order{}; ///< ADD command, order_id always set
+    mass_cancel_cmd_t mass{}; ///< MASS_CANCEL command
+    std::uint64_t engine_time{0}; ///< primary engine time after the command; the replica expires GTD orders up to it first
+    std::uint64_t sent_ticks{0}; ///< TscClock::ticks() when forwarded
+};
+
+/**
+ * @brief engine::replica_stats_t is a point-in-time view of the replica, readable from any thread. lag_commands() is how far the replica book is behind the primary, spilled commands included.
+ *
+ */
+struct replica_stats_t {
+    std::uint64_t forwarded{0}; ///< commands forwarded by the matching thread
+    std::uint64_t applied{0}; ///< commands applied to the replica book
+    std::uint64_t last_lag_ns{0}; ///< forward-to-apply delay of the oldest command in the last applied batch
+    std::uint64_t max_lag_ns{0}; ///< largest last_lag_ns so far
+    std::uint64_t spilled{0}; ///< forwards that found the ring full (or commands already queued ahead) and went to the spill queue
+    std::uint64_t backlog{0}; ///< commands waiting in the spill queue now
+
+    std::uint64_t lag_commands() const noexcept { return forwarded - applied; }
+};
+
+/**
+ * @brief engine::ReplicatedEngine is an IEngine that keeps a read replica of its book on a second thread. The matching thread drives the primary engine as usual and forwards every command that changed the book over a concurrency::SpscRing; the replica thread replays them on its own engine, which is deterministic and therefore ends up with the same book. Readers on any thread query the replica through read(), under a shared lock that only the replica thread contends with. A long read holds the replica back, not matching: forwarding never waits, and when the ring is full the command goes to a spill queue owned by the matching thread (counted in spilled), which later forwards hand to the ring in order. The replica is behind while a backlog stands, never wrong. The IEngine methods themselves, snapshots included, read the primary and belong to the matching thread.
+ *
+ */
+class ReplicatedEngine final : public IEngine {
+public:
+    static constexpr std::size_t default_capacity = 1U << 14;
+    static constexpr std::size_t batch_size = 256;
+
+    /// the replica uses the same layout and modes; publisher, memory resource and warm-up stay with the primary
+    explicit ReplicatedEngine(const engine_config_t& config = {}, std::size_t capacity_pow2 = default_capacity);
+    ~ReplicatedEngine() override { stop(); }
+
+    ReplicatedEngine(const ReplicatedEngine&) = delete;
+    ReplicatedEngine& operator=(const ReplicatedEngine&) = delete;
+
+    /// start the replica thread; call it from the matching thread. Until then (and after stop()) forwarded commands wait in the ring and the spill queue
+    void start();
+    /// join the replica thread and apply what is still forwarded, spill queue included; matching thread
+    void stop();
+
+    add_result_t add_order(const order_cmd_t& cmd) override;
+    bool cancel_order(id_t order_id) override;
+    mass_cancel_result_t mass_cancel(const mass_cancel_cmd_t& cmd) override;
+    mass_cancel_result_t expire_orders(std::uint64_t now) override;
+    std::uint64_t engine_time() const override { return primary_->engine_time(); }
+    uncross_result_t uncross() override;
+    uncross_result_t set_matching_mode(MatchingMode mode) override;
+    MatchingMode matching_mode() const override { return primary_->matching_mode(); }
+    snapshot_t snapshot(int depth) const override { return primary_->snapshot(depth); }
+    snapshot_counts_t snapshot_into(std::span<snapshot_level_t> bids, std::span<snapshot_level_t> asks) const override
+    {
+        return primary_->snapshot_into(bids, asks);
+    }
+    snapshot_counts_t snapshot_changed_into(std::span<snapshot_level_t> bids, std::span<snapshot_level_t> asks, std::uint64_t since_version) const override
+    {
+        return primary_->snapshot_changed_into(bids, asks, since_version);
+    }
+    engine_metrics_t metrics() const override { return primary_->metrics(); }
+    latency_histogram_t add_latency() const override { return primary_->add_latency(); }
+    memory_stats_t memory_stats() const override { return primary_->memory_stats(); }
+    std::size_t compact(std::size_t max_levels) override { return primary_->compact(max_levels); }
+
+    /// run fn(const IEngine&) on the replica under a shared lock; any thread
+    template <class Fn>
+    decltype(auto) read(Fn&& fn) const
+    {
+        std::shared_lock lock(replica_mutex_);
+        return std::forward<Fn>(fn)(static_cast<const IEngine&>(*replica_));
+    }
+    snapshot_t replica_snapshot(int depth) const
+    {
+        return read([depth](const IEngine& replica) { return replica.snapshot(depth); });
+    }
+
+    replica_stats_t replica_stats() const;
+    /// hand the spill queue over and wait until the replica has applied everything forwarded so far; matching thread
+    void sync();
+
+private:
+    std::unique_ptr<IEngine> primary_;
+    std::unique_ptr<IEngine> replica_;
+    mutable std::shared_mutex replica_mutex_;
+    concurrency::SpscRing<replica_cmd_t> commands_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    // matching thread
+    std::vector<replica_cmd_t> spill_; // forwarded while the ring was full, oldest from spill_head_
+    std::size_t spill_head_{0};
+    std::atomic<std::uint64_t> forwarded_{0};
+    std::atomic<std::uint64_t> spilled_{0};
+    std::atomic<std::uint64_t> backlog_{0};
+    // replica thread
+    std::atomic<std::uint64_t> applied_{0};
+    std::atomic<std::uint64_t> last_lag_ticks_{0};
+    std::atomic<std::uint64_t> max_lag_ticks_{0};
+
+    void forward(replica_cmd_t cmd);
+    void drain_spill();
+    void apply_pending();
+    void apply(const replica_cmd_t& cmd);
+    void apply_batch(const replica_cmd_t* batch, std::size_t num);
+    void run();
+};
+
+} // namespace engine
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <libs/engine/engine.hpp>
+#include <libs/engine/clock.hpp>
+#include <libs/engine/latency_histogram.hpp>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace engine {
+
+/// points a command passes on its way through the system, in order
+enum class TraceStage : uint8_t { INGRESS, ENQUEUE, DEQUEUE, MATCH_START, MATCH_END, PUBLISH };
+inline constexpr std::size_t trace_stages = 6;
+
+/**
+ * @brief engine::trace_t is the per-stage stamps of one command, attached through order_cmd_t::trace. Each stage that sees a traced command writes TscClock::ticks() into its slot: the caller INGRESS (decoded or submitted), a ring ENQUEUE and DEQUEUE, the engine MATCH_START, MATCH_END and PUBLISH (its events handed to the publisher ring). Stages a command skips stay 0. The stamps travel with the command; whoever completes it hands them to a TraceRecorder.
+ *
+ */
+struct trace_t {
+    std::array<std::uint64_t, trace_stages> ticks{}; ///< TscClock ticks per TraceStage, 0 if not reached
+
+    void stamp(TraceStage stage) noexcept { ticks[static_cast<std::size_t>(stage)] = TscClock::ticks(); }
+    bool reached(TraceStage stage) const noexcept { return ticks[static_cast<std::size_t>(stage)] != 0; }
+};
+
+/**
+ * @brief engine::trace_record_t is one command in a raw trace dump: stage times in ns on the steady_clock time line (0 for stages not reached). Records are fixed 64 bytes after a trace_file_header_t.
+ *
+ */
+struct trace_record_t {
+    id_t order_id{0}; ///< order id the engine assigned
+    std::array<std::uint64_t, trace_stages> stage_ns{}; ///< per TraceStage
+    uint32_t source{0}; ///< caller-defined tag (e.g. symbol index)
+    uint8_t status{0}; ///< OrderStatus of the add
+    uint8_t reserved[3]{}; ///< padding
+};
+
+static_assert(sizeof(trace_record_t) == 64, "raw trace records are one cache line");
+
+/**
+ * @brief engine::trace_file_header_t starts a raw trace dump.
+ *
+ */
+struct trace_file_header_t {
+    char magic[4] = {'S', 'X', 'T', 'R'}; ///< file magic
+    uint16_t version = 1; ///< format version
+    uint16_t record_size = sizeof(trace_record_t); ///< size of every following record
+    uint32_t stages = trace_stages; ///< stage_ns entries per record
+    uint32_t sample_every = 0; ///< one record per this many traced commands
+};
+
+/**
+ * @brief engine::trace_stats_t aggregates traced commands: stage[s] holds the time from the previous reached stage to stage s (stage[INGRESS] stays empty), total the time from the first to the last reached stage. Readable from any thread.
+ *
+ */
+struct trace_stats_t {
+    std::uint64_t traced{0}; ///< commands recorded
+    std::uint64_t dumped{0}; ///< raw records written
+    std::array<latency_histogram_t, trace_stages> stage{}; ///< per-stage time, indexed by TraceStage
+    latency_histogram_t total{}; ///< first to last stamp
+
+    trace_stats_t& operator+=(const trace_stats_t& other) noexcept;
+};
+
+/**
+ * @brief engine::TraceRecorder turns completed traces into per-stage histograms and, optionally, writes every sample_every-th one to a raw dump for offline analysis. Recording has a single writer, the thread that completes the commands; stats() can be read from any thread. A dump that cannot be opened leaves is_open() false and the histograms still work.
+ *
+ */
+class TraceRecorder {
+public:
+    /// no dump_path: histograms only
+    explicit TraceRecorder(const std::string& dump_path = {}, std::uint32_t sample_every = 1024);
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    bool is_open() const noexcept { return dump_ != nullptr; } ///< a dump file is being written
+    void record(const trace_t& trace, id_t order_id, OrderStatus status, uint32_t source = 0) noexcept;
+    trace_stats_t stats() const noexcept;
+    void flush() noexcept;
+
+    static const char* stage_name(TraceStage stage) noexcept;
+
+private:
+    const TscClock& clock_;
+    std::FILE* dump_{nullptr};
+    std::uint32_t sample_every_;
+    std::uint32_t until_sample_;
+
+    std::atomic<std::uint64_t> traced_{0};
+    std::atomic<std::uint64_t> dumped_{0};
+    std::array<LatencyHistogram, trace_stages> stages_{};
+    LatencyHistogram total_;
+};
+
+} // namespace engine
@@ -0,0 +1,330 @@
+#pragma once
+#include "perf_counters.hpp"
+#include <libs/engine/engine.hpp>
+#include <libs/engine/book_arena.hpp>
+#include <fmt/format.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Result aggregation, JSON output and baseline comparison for scopeX_bench
+namespace cli_bench {
+
+/**
+ * @brief Wall time and hardware counters of one workload phase.
+ *
+ */
+struct phase_result_t {
+    const char* name = "";      /**< warmup, steady or sweep */
+    std::size_t orders = 0;     /**< orders submitted in the phase */
+    std::uint64_t total_ns = 0; /**< wall time of the phase */
+    perf_sample_t counters{};   /**< counters around the phase's matching loop */
+};
+
+/**
+ * @brief Latency distribution of the steady phase, in nanoseconds.
+ *
+ */
+struct latency_summary_t {
+    std::uint64_t p50 = 0;   /**< median */
+    std::uint64_t p90 = 0;   /**< 90th percentile */
+    std::uint64_t p99 = 0;   /**< 99th percentile */
+    std::uint64_t p999 = 0;  /**< 99.9th percentile */
+    std::uint64_t p9999 = 0; /**< 99.99th percentile */
+    std::uint64_t min = 0;   /**< fastest order */
+    std::uint64_t max = 0;   /**< slowest order */
+    double mean = 0.0;       /**< average */
+};
+
+// sorts latencies in place
+inline auto summarize_latencies(std::vector<std::uint64_t>& latencies_ns) -> latency_summary_t
+{
+    if(latencies_ns.empty()) { return {}; }
+    std::sort(latencies_ns.begin(), latencies_ns.end());
+    auto percentile = [&](double percent) {
+        const auto idx = static_cast<std::size_t>((percent / 100.0) * static_cast<double>(latencies_ns.size() - 1));
+        return latencies_ns[idx];
+    };
+    double total = 0.0;
+    for(auto latency : latencies_ns) { total += static_cast<double>(latency); }
+    return latency_summary_t{.p50=percentile(50.0), .p90=percentile(90.0), .p99=percentile(99.0), .p999=percentile(99.9),
+        .p9999=percentile(99.99), .min=latencies_ns.front(), .max=latencies_ns.back(),
+        .mean=total / static_cast<double>(latencies_ns.size())};
+}
+
+/**
+ * @brief Result of one bench iteration on a fresh engine.
+ *
+ */
+struct run_result_t {
+    double startup_ms = 0.0;               /**< arena reservation, pre-faulting and engine construction with its warm-up */
+    std::size_t first_n = 0;               /**< number of first orders in first_latency */
+    latency_summary_t first_latency{};     /**< latency of the first orders a fresh engine sees */
+    double total_ms = 0.0;                 /**< wall time of the steady phase */
+    double throughput_mops = 0.0;          /**< steady phase, million orders per second */
+    latency_summary_t latency{};           /**< steady phase latency distribution; open loop: from the intended send time */
+    latency_summary_t service_latency{};   /**< open loop: steady phase latency from the actual send, without queueing */
+    std::uint64_t max_behind_ns = 0;       /**< open loop: largest delay of a send behind its schedule */
+    latency_summary_t cancel_latency{};    /**< cancels of orders on one crowded level, in random queue positions */
+    std::vector<phase_result_t> phases;    /**< warmup, steady, sweep, cancel */
+    engine::engine_metrics_t metrics{};    /**< engine metrics after the run */
+    engine::memory_stats_t memory{};       /**< engine memory footprint after the steady phase */
+};
+
+/**
+ * @brief Median of repeated samples with a distribution-free 95% confidence interval (order statistics around the median rank).
+ *
+ */
+struct sample_summary_t {
+    double median = 0.0;  /**< median sample */
+    double ci_low = 0.0;  /**< lower bound of the 95% CI of the median */
+    double ci_high = 0.0; /**< upper bound of the 95% CI of the median */
+    std::size_t count = 0; /**< number of samples */
+};
+
+inline auto summarize(std::vector<double> samples) -> sample_summary_t
+{
+    if(samples.empty()) { return {}; }
+    std::sort(samples.begin(), samples.end());
+    const std::size_t count = samples.size();
+    const double median = (count % 2 == 1) ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2.0;
+    // ranks n/2 -+ 1.96 * sqrt(n) / 2 bound the median with ~95% confidence
+    const double half_width = 1.96 * std::sqrt(static_cast<double>(count)) / 2.0;
+    const auto low_rank = static_cast<long>(std::floor(static_cast<double>(count) / 2.0 - half_width));
+    const auto high_rank = static_cast<long>(std::ceil(static_cast<double>(count) / 2.0 + half_width));
+    const auto last = static_cast<long>(count) - 1;
+    return sample_summary_t{.median=median, .ci_low=samples[static_cast<std::size_t>(std::clamp(low_rank, 0L, last))],
+        .ci_high=samples[static_cast<std::size_t>(std::clamp(high_rank, 0L, last))], .count=count};
+}
+
+/**
+ * @brief A tracked bench metric: how to read it from a run and which direction is better.
+ *
+ */
+struct tracked_metric_t {
+    const char* name;                      /**< key in the JSON "metrics" object */
+    bool higher_is_better;                 /**< throughput: true, latency: false */
+    double (*value)(const run_result_t&);  /**< extracts the sample from one run */
+};
+
+inline constexpr tracked_metric_t tracked_metrics[] = {
+    {"throughput_mops", true, [](const run_result_t& run) { return run.throughput_mops; }},
+    {"p50_ns", false, [](const run_result_t& run) { return static_cast<double>(run.latency.p50); }},
+    {"p90_ns", false, [](const run_result_t& run) { return static_cast<double>(run.latency.p90); }},
+    {"p99_ns", false, [](const run_result_t& run) { return static_cast<double>(run.latency.p99); }},
+    {"p999_ns", false, [](const run_result_t& run) { return static_cast<double>(run.latency.p999); }},
+    {"mean_ns", false, [](const run_result_t& run) { return run.latency.mean; }},
+    {"first_p99_ns", false, [](const run_result_t& run) { return static_cast<double>(run.first_latency.p99); }},
+    {"cancel_p99_ns", false, [](const run_result_t& run) { return static_cast<double>(run.cancel_latency.p99); }},
+};
+
+inline const char* page_backing_name(engine::PageBacking backing)
+{
+    switch(backing)
+    {
+    case engine::PageBacking::HEAP: return "heap";
+    case engine::PageBacking::MAPPED: return "mapped";
+    case engine::PageBacking::HUGE_TRANSPARENT: return "thp";
+    case engine::PageBacking::HUGE_TLB: return "hugetlb";
+    }
+    return "heap";
+}
+
+inline auto metric_samples(const std::vector<run_result_t>& runs, const tracked_metric_t& metric) -> std::vector<double>
+{
+    std::vector<double> samples;
+    samples.reserve(runs.size());
+    for(const auto& run : runs) { samples.push_back(metric.value(run)); }
+    return samples;
+}
+
+// ------------Baseline comparison---------
+
+// fewer samples on either side and the CI is too wide (one sample: a single point), so the comparison is inconclusive
+inline constexpr std::size_t min_compare_samples = 5;
+
+/**
+ * @brief Verdict for one tracked metric against the baseline. A regression needs at least min_compare_samples on both sides, a change beyond the threshold in the worse direction and non-overlapping confidence intervals, so single noisy runs do not fail the gate.
+ *
+ */
+struct comparison_t {
+    const char* name = "";         /**< tracked metric */
+    sample_summary_t baseline{};   /**< baseline median and CI */
+    sample_summary_t current{};    /**< current median and CI */
+    double change_pct = 0.0;       /**< relative change of the median, positive = worse */
+    bool conclusive = false;       /**< both sides have min_compare_samples or more */
+    bool significant = false;      /**< conclusive and the confidence intervals do not overlap */
+    bool regression = false;       /**< significant and worse than the threshold */
+};
+
+inline auto compare(const tracked_metric_t& metric, const sample_summary_t& baseline, const sample_summary_t& current, double threshold_pct) -> comparison_t
+{
+    comparison_t result{.name=metric.name, .baseline=baseline, .current=current};
+    if(baseline.median > 0.0) // tracked metrics are never negative
+    {
+        const double delta = (current.median - baseline.median) / baseline.median * 100.0;
+        result.change_pct = metric.higher_is_better ? -delta : delta;
+    }
+    result.conclusive = baseline.count >= min_compare_samples && current.count >= min_compare_samples;
+    if(!result.conclusive) { return result; }
+    result.significant = current.ci_high < baseline.ci_low || current.ci_low > baseline.ci_high;
+    result.regression = result.significant && result.change_pct > threshold_pct;
+    return result;
+}
+
+/**
+ * @brief Reads the "samples" arrays of a JSON document written by scopeX_bench --json. Only the layout this bench produces is understood; it is not a general JSON parser.
+ *
+ */
+class baseline_reader_t {
+public:
+    explicit baseline_reader_t(std::string text) : text_(std::move(text)) {}
+
+    // samples of one tracked metric, nullopt when the metric or its samples are missing
+    auto samples(std::string_view metric) const -> std::optional<std::vector<double>>
+    {
+        const auto metrics_pos = text_.find("\"metrics\"");
+        if(metrics_pos == std::string::npos) { return std::nullopt; }
+        const auto key_pos = text_.find(fmt::format("\"{}\"", metric), metrics_pos);
+        if(key_pos == std::string::npos) { return std::nullopt; }
+        const auto samples_pos = text_.find("\"samples\"", key_pos);
+        const auto open_pos = text_.find('[', samples_pos);
+        const auto close_pos = text_.find(']', open_pos);
+        if(samples_pos == std::string::npos || open_pos == std::string::npos || close_pos == std::string::npos) { return std::nullopt; }
+
+        std::vector<double> values;
+        const char* cursor = text_.c_str() + open_pos + 1;
+        const char* end = text_.c_str() + close_pos;
+        while(cursor < end)
+        {
+            char* next = nullptr;
+            const double value = std::strtod(cursor, &next);
+            if(next == cursor) { ++cursor; continue; } // separator
+            values.push_back(value);
+            cursor = next;
+        }
+        if(values.empty()) { return std::nullopt; }
+        return values;
+    }
+
+private:
+    std::string text_;
+};
+
+// ------------JSON output---------
+
+inline void write_phase_json(fmt::memory_buffer& out, const phase_result_t& phase)
+{
+    const double orders = phase.orders == 0 ? 1.0 : static_cast<double>(phase.orders);
+    fmt::format_to(std::back_inserter(out), "{{\"name\":\"{}\",\"orders\":{},\"total_ns\":{},\"ns_per_order\":{:.3f},\"counters_per_order\":{{",
+        phase.name, phase.orders, phase.total_ns, static_cast<double>(phase.total_ns) / orders);
+    bool first = true;
+    for(std::size_t i = 0; i < perf_counter_names.size(); i++)
+    {
+        if(!phase.counters.valid[i]) { continue; }
+        fmt::format_to(std::back_inserter(out), "{}\"{}\":{:.4f}", first ? "" : ",", perf_counter_names[i], static_cast<double>(phase.counters.values[i]) / orders);
+        first = false;
+    }
+    fmt::format_to(std::back_inserter(out), "}}}}");
+}
+
+inline void write_run_json(fmt::memory_buffer& out, const run_result_t& run)
+{
+    const auto& first = run.first_latency;
+    fmt::format_to(std::back_inserter(out), "{{\"startup_ms\":{:.3f},\"first_n\":{},\"first_latency_ns\":{{\"p50\":{},\"p90\":{},\"p99\":{},\"max\":{},\"mean\":{:.1f}}},",
+        run.startup_ms, run.first_n, first.p50, first.p90, first.p99, first.max, first.mean);
+    const auto& lat = run.latency;
+    fmt::format_to(std::back_inserter(out), "\"total_ms\":{:.3f},\"throughput_mops\":{:.4f},"
+        "\"latency_ns\":{{\"p50\":{},\"p90\":{},\"p99\":{},\"p99_9\":{},\"p99_99\":{},\"min\":{},\"max\":{},\"mean\":{:.1f}}},",
+        run.total_ms, run.throughput_mops, lat.p50, lat.p90, lat.p99, lat.p999, lat.p9999, lat.min, lat.max, lat.mean);
+    const auto& service = run.service_latency;
+    fmt::format_to(std::back_inserter(out), "\"service_latency_ns\":{{\"p50\":{},\"p90\":{},\"p99\":{},\"p99_9\":{},\"max\":{},\"mean\":{:.1f}}},\"max_behind_ns\":{},",
+        service.p50, service.p90, service.p99, service.p999, service.max, service.mean, run.max_behind_ns);
+    const auto& cancel = run.cancel_latency;
+    fmt::format_to(std::back_inserter(out), "\"cancel_latency_ns\":{{\"p50\":{},\"p90\":{},\"p99\":{},\"max\":{},\"mean\":{:.1f}}},",
+        cancel.p50, cancel.p90, cancel.p99, cancel.max, cancel.mean);
+    fmt::format_to(std::back_inserter(out), "\"phases\":[");
+    for(std::size_t i = 0; i < run.phases.size(); i++)
+    {
+        if(i != 0) { fmt::format_to(std::back_inserter(out), ","); }
+        write_phase_json(out, run.phases[i]);
+    }
+    fmt::format_to(std::back_inserter(out), "]}}");
+}
+
+inline void write_summary_json(fmt::memory_buffer& out, const sample_summary_t& summary)
+{
+    fmt::format_to(std::back_inserter(out), "\"median\":{:.4f},\"ci_low\":{:.4f},\"ci_high\":{:.4f},\"count\":{}", summary.median, summary.ci_low, summary.ci_high, summary.count);
+}
+
+inline void write_metrics_json(fmt::memory_buffer& out, const std::vector<run_result_t>& runs)
+{
+    fmt::format_to(std::back_inserter(out), "\"metrics\":{{");
+    bool first = true;
+    for(const auto& metric : tracked_metrics)
+    {
+        const auto samples = metric_samples(runs, metric);
+        fmt::format_to(std::back_inserter(out), "{}\"{}\":{{\"higher_is_better\":{},", first ? "" : ",", metric.name, metric.higher_is_better);
+        write_summary_json(out, summarize(samples));
+        fmt::format_to(std::back_inserter(out), ",\"samples\":[");
+        for(std::size_t i = 0; i < samples.size(); i++)
+        {
+            fmt::format_to(std::back_inserter(out), "{}{:.4f}", i == 0 ? "" : ",", samples[i]);
+        }
+        fmt::format_to(std::back_inserter(out), "]}}");
+        first = false;
+    }
+    fmt::format_to(std::back_inserter(out), "}}");
+}
+
+inline void write_engine_json(fmt::memory_buffer& out, const engine::engine_metrics_t& metric)
+{
+    fmt::format_to(std::back_inserter(out), "\"engine\":{{\"add_orders\":{},\"cancel_orders\":{},\"trades\":{},\"traded_qty\":{},"
+        "\"best_bid_px\":{},\"best_bid_qty\":{},\"best_ask_px\":{},\"best_ask_qty\":{},\"add_min_ns\":{},\"add_max_ns\":{},\"add_total_ns\":{}}}",
+        metric.add_orders, metric.cancel_orders, metric.trades, metric.traded_qty, metric.best_bid_px, metric.best_bid_qty,
+        metric.best_ask_px, metric.best_ask_qty, metric.add_min_ns, metric.add_max_ns, metric.add_total_ns);
+}
+
+inline void write_usage_json(fmt::memory_buffer& out, const char* name, const engine::memory_usage_t& usage)
+{
+    fmt::format_to(std::back_inserter(out), "\"{}\":{{\"bytes_in_use\":{},\"peak_bytes\":{},\"allocations\":{},\"deallocations\":{}}}",
+        name, usage.bytes_in_use, usage.peak_bytes, usage.allocations, usage.deallocations);
+}
+
+inline void write_memory_json(fmt::memory_buffer& out, const engine::memory_stats_t& memory)
+{
+    fmt::format_to(std::back_inserter(out), "\"memory\":{{\"bid_levels\":{},\"ask_levels\":{},\"resting_orders\":{},\"queue_slots\":{},\"tombstones\":{},"
+        "\"index_entries\":{},\"index_buckets\":{},\"total_bytes\":{},\"bytes_per_order\":{:.1f},",
+        memory.bid_levels, memory.ask_levels, memory.resting_orders, memory.queue_slots, memory.tombstones, memory.index_entries, memory.index_buckets,
+        memory.total_bytes(), memory.bytes_per_order());
+    write_usage_json(out, "levels", memory.levels);
+    fmt::format_to(std::back_inserter(out), ",");
+    write_usage_json(out, "queues", memory.queues);
+    fmt::format_to(std::back_inserter(out), ",");
+    write_usage_json(out, "index", memory.index);
+    fmt::format_to(std::back_inserter(out), "}}");
+}
+
+inline void write_comparison_json(fmt::memory_buffer& out, const std::vector<comparison_t>& comparisons, double threshold_pct)
+{
+    fmt::format_to(std::back_inserter(out), "\"comparison\":{{\"threshold_pct\":{:.2f},\"min_samples\":{},\"metrics\":[", threshold_pct, min_compare_samples);
+    for(std::size_t i = 0; i < comparisons.size(); i++)
+    {
+        const auto& cmp = comparisons[i];
+        fmt::format_to(std::back_inserter(out), "{}{{\"name\":\"{}\",\"baseline\":{{", i == 0 ? "" : ",", cmp.name);
+        write_summary_json(out, cmp.baseline);
+        fmt::format_to(std::back_inserter(out), "}},\"current\":{{");
+        write_summary_json(out, cmp.current);
+        fmt::format_to(std::back_inserter(out), "}},\"change_pct\":{:.2f},\"conclusive\":{},\"significant\":{},\"regression\":{}}}",
+            cmp.change_pct, cmp.conclusive, cmp.significant, cmp.regression);
+    }
+    fmt::format_to(std::back_inserter(out), "]}}");
+}
+
+} // namespace cli_bench
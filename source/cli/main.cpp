@@ -1,89 +1,51 @@
 #include <fmt/core.h>
 #include <libs/engine/engine.hpp>
+#include <libs/engine/book_scheduler.hpp>
+#include <libs/concurrency/spsc_ring.hpp>
 #include <fmt/format.h>
+#include "replay.hpp"
+#include "output_sink.hpp"
+#include "open_loop.hpp"
 #include <cstdint>
 #include <cstdio>
 #include <fstream>
-#include <sstream>
 #include <string>
 #include <vector>
 #include <optional>
-#include <cctype>
+#include <map>
+#include <memory>
+#include <thread>
+#include <unordered_map>
 
 using namespace engine;
 
 namespace cli{
-    /**
-     * @brief Enum class representing the columns in the CSV file for order book replay.
-     * 
-     */
-    enum class csv_columns: uint8_t {
-        TIMESTAMP = 0,   /**< Timestamp of the order */
-        CMD,             /**< Command type (e.g., NEW, CANCEL) */
-        SIDE,            /**< Side of the order (e.g., BUY, SELL) */
-        ORDER_TYPE,      /**< Type of the order (e.g., LIMIT, MARKET) */
-        TIME_IN_FORCE,   /**< Time in force for the order (e.g., GTC, IOC) */
-        PRICE,           /**< Price of the order */
-        QTY,             /**< Quantity of the order */
-        ORDER_ID,        /**< Unique identifier for the order */
-        // total columns count
-        COUNT            /**< Total number of columns */
-    }; 
-
     /**
      * @brief Structure representing the command line arguments.
      * 
      */
     struct args {
         std::string replay_file;    /**< Path to the replay file */
-        std::string out_file;       /**< Path to the output file */
+        std::string out_file;       /**< Path to the machine-readable output file (results, trades, final snapshots) */
+        out_format out_fmt = out_format::CSV; /**< Encoding of the output file */
         int depth = 5;              /**< Depth of the order book */
         bool print_trades = false;  /**< Flag to print trades */
         bool print_metrics = true;  /**< Flag to print metrics */
-        bool no_human = false;      /**< Flag to disable human-readable output */
+        bool no_human = false;      /**< Flag to disable human-readable per-order output */
+        unsigned threads = 0;       /**< Worker threads for multi-symbol replay (0: replay on the main thread) */
+        bool steal = false;         /**< --threads: books move between workers by work stealing instead of a fixed symbol -> worker mapping */
+        ClockSource clock = ClockSource::SEQUENCE; /**< Trade timestamps: seq (command counter), tsc (nanoseconds) or caller (the replay timestamp column) */
+        FillReport fill_report = FillReport::TRADES; /**< Executions per ADD: trades (one per maker), levels (one per price level) or both */
+        double pace = 0.0;          /**< Open-loop replay on the timestamp column at this speed multiplier (0: closed loop, as fast as possible) */
+        double ts_ns_per_unit = 1000.0; /**< Unit of the timestamp column for --pace: ns, us or ms */
+        double rate = 0.0;          /**< Open-loop replay at this many commands per second with Poisson arrivals (0: off) */
+        bool trace = false;         /**< Stamp every ADD at each stage and print per-stage latency */
+        std::string trace_file;     /**< Raw trace dump of sampled ADDs (implies --trace); worker i of --threads writes <file>.<i> */
+        uint32_t trace_every = 1024; /**< One raw trace record per this many traced ADDs */
+
+        bool open_loop() const { return pace > 0.0 || rate > 0.0; }
     }; 
 
-    /**
-     * @brief Case-insensitive string comparison.
-     * 
-     * @param str_a First string to compare.
-     * @param str_b Second string to compare.
-     * @return true If the strings are equal (case-insensitive).
-     * @return false If the strings are not equal.
-     */
-    auto inline ieq(const std::string& str_a, const std::string& str_b) -> bool
-    {
-        if(str_a.size() != str_b.size()) { return false; }
-        for(size_t i = 0; i < str_a.size(); i++)
-        {
-            if(std::tolower(static_cast<unsigned char>(str_a[i])) != std::tolower(static_cast<unsigned char>(str_b[i])))
-            { return false; }
-        }
-        return true;
-    };
-
-    // remove head and tail spaces
-    auto trim(std::string str) -> std::string
-    {
-        auto isspace2 = [](unsigned char chara){return std::isspace(chara);};
-        while(!str.empty() && (isspace2(str.front()) != 0)) {str.erase(str.begin());}
-        while(!str.empty() && (isspace2(str.back()) != 0)) {str.pop_back();}
-        return str;
-    }
-
-    auto split_csv_line(const std::string& line) -> std::vector<std::string>
-    {
-        // for simple CSV without quoted fields
-        std::vector<std::string> result;
-        std::stringstream s_stream(line);
-        std::string cell;
-        while(std::getline(s_stream, cell, ',')) {
-            // remove head/tail spaces for each cell
-            result.push_back(trim(cell));
-        }
-        return result; 
-    }
-
     auto parse_args(int argc, char** argv) -> std::optional<args>
     {
         args result;
@@ -110,13 +72,61 @@ namespace cli{
             {
                 result.no_human = true;
             }
+            else if (arg == "--threads" && ( i + 1 < argc ))
+            {
+                result.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+            }
+            else if (arg == "--steal")
+            {
+                result.steal = true;
+            }
+            else if (arg == "--clock" && ( i + 1 < argc ))
+            {
+                const std::string clock = argv[++i];
+                result.clock = ieq(clock, "tsc") ? ClockSource::TSC : (ieq(clock, "caller") ? ClockSource::CALLER : ClockSource::SEQUENCE);
+            }
+            else if (arg == "--fill-report" && ( i + 1 < argc ))
+            {
+                const std::string report = argv[++i];
+                result.fill_report = ieq(report, "levels") ? FillReport::LEVELS : (ieq(report, "both") ? FillReport::BOTH : FillReport::TRADES);
+            }
             else if (arg == "--out" && ( i + 1 < argc ))
             {
                 result.out_file = argv[++i]; // jump to the next argument
             }
+            else if (arg == "--out-format" && ( i + 1 < argc ))
+            {
+                result.out_fmt = ieq(argv[++i], "bin") ? out_format::BINARY : out_format::CSV;
+            }
+            else if (arg == "--pace" && ( i + 1 < argc ))
+            {
+                result.pace = std::stod(argv[++i]);
+            }
+            else if (arg == "--ts-unit" && ( i + 1 < argc ))
+            {
+                const std::string unit = argv[++i];
+                result.ts_ns_per_unit = ieq(unit, "ns") ? 1.0 : (ieq(unit, "ms") ? 1e6 : 1e3);
+            }
+            else if (arg == "--rate" && ( i + 1 < argc ))
+            {
+                result.rate = std::stod(argv[++i]);
+            }
+            else if (arg == "--trace")
+            {
+                result.trace = true;
+            }
+            else if (arg == "--trace-out" && ( i + 1 < argc ))
+            {
+                result.trace_file = argv[++i];
+                result.trace = true;
+            }
+            else if (arg == "--trace-every" && ( i + 1 < argc ))
+            {
+                result.trace_every = static_cast<uint32_t>(std::stoul(argv[++i]));
+            }
             else if(arg == "-h" || arg == "--help")
             {
-                fmt::print("Usage: scopex_cli --replay <replay_file> [--depth <n>] [--print-trades] [--no-metrics]\n", argv[0]);
+                fmt::print("Usage: scopex_cli --replay <replay_file> [--depth <n>] [--print-trades] [--no-metrics] [--no-human] [--threads <n> [--steal]] [--clock seq|tsc|caller] [--fill-report trades|levels|both] [--out <file> [--out-format csv|bin]] [--pace <speed> [--ts-unit ns|us|ms] | --rate <cmds_per_s>] [--trace] [--trace-out <file> [--trace-every <n>]]\n", argv[0]);
                 return std::nullopt;
             }
         }
@@ -126,6 +136,16 @@ namespace cli{
             fmt::print(stderr, "Error: --replay <replay_file> is required\n");
             return std::nullopt;
         }
+        if(result.steal && result.threads == 0)
+        {
+            fmt::print(stderr, "Error: --steal needs --threads <n>\n");
+            return std::nullopt;
+        }
+        if(result.pace > 0.0 && result.rate > 0.0)
+        {
+            fmt::print(stderr, "Error: --pace and --rate are exclusive\n");
+            return std::nullopt;
+        }
 
         return result;
     }
@@ -135,7 +155,276 @@ namespace cli{
         uint64_t orders_cancel = 0;
         uint64_t trades = 0;
         uint64_t traded_qty = 0;
+
+        metrics_t& operator+=(const metrics_t& other)
+        {
+            orders_add += other.orders_add;
+            orders_cancel += other.orders_cancel;
+            trades += other.trades;
+            traded_qty += other.traded_qty;
+            return *this;
+        }
+    };
+
+    /**
+     * @brief One instrument: its engine and the replay metrics collected for it.
+     * 
+     */
+    struct symbol_book_t {
+        std::unique_ptr<IEngine> engine; // created by the first command of the symbol
+        metrics_t metric{};
+        std::unique_ptr<result_writer_t> writer; // --steal with --out: own buffer, keeps the symbol's records in order while it moves between workers
+    };
+
+    // replay one command into its book; human output is only printed by the single-threaded replay, writer and recorder may be null
+    void apply(symbol_book_t& book, const replay_cmd_t& replay_cmd, const args& args_value, bool human, result_writer_t* writer, TraceRecorder* recorder)
+    {
+        if(!book.engine)
+        {
+            book.engine = make_engine({/*market_gtc_as_ioc*/.market_gtc_as_ioc=true, /*markets_max_levels*/.market_max_levels=0, .clock=args_value.clock,
+                .fill_report=args_value.fill_report});
+        }
+        metrics_t& metric = book.metric;
+        human = human && !args_value.no_human;
+        switch(replay_cmd.kind)
+        {
+        case replay_kind::ADD:
+        {
+            order_cmd_t order_cmd = replay_cmd.order;
+            trace_t trace = replay_cmd.trace;
+            if(recorder != nullptr) { order_cmd.trace = &trace; }
+            // status, order_id, trades, filled_qty, remaining_qty 
+            auto order_result = book.engine->add_order(order_cmd);
+            if(recorder != nullptr) { recorder->record(trace, order_result.order_id, order_result.status, replay_cmd.symbol); }
+            metric.orders_add++;
+            if(writer != nullptr) { writer->result(replay_cmd.symbol, order_result); }
+
+            if(human)
+            {
+                fmt::print("===============================\n");
+                fmt::print("ADD order: timestamp={} side={} order_type={} time_in_force={} price={} qty={}\n", 
+                    order_cmd.timestamp, side_name(order_cmd.side), order_type_name(order_cmd.order_type), tif_name(order_cmd.time_in_force), order_cmd.price, order_cmd.qty);
+                fmt::print("-------------------------------\n");
+                fmt::print("order_id={} status={}\n", order_result.order_id, std::to_string(static_cast<int>(order_result.status)));
+            }
+            // metrics are independent from status (bad status = no trades) and from the fill report
+            metric.traded_qty += static_cast<uint64_t>(order_result.filled_qty);
+            if(order_result.trades.empty())
+            {
+                for(const auto& level : order_result.level_fills) { metric.trades += level.makers; }
+            }
+            else
+            {
+                metric.trades += order_result.trades.size();
+            }
+            if (human && args_value.print_trades) 
+            {
+                for(const auto& trade : order_result.trades)
+                {
+                    fmt::print("TRADE taker={} maker={} price={:.2f} quantity={} timestamp={}\n", 
+                        trade.taker, trade.maker, static_cast<double>(trade.price)/100.0, trade.qty, trade.timestamp);
+                }
+                for(const auto& level : order_result.level_fills)
+                {
+                    fmt::print("LEVEL_FILL taker={} price={:.2f} quantity={} makers={}\n", 
+                        order_result.order_id, static_cast<double>(level.price)/100.0, level.qty, level.makers);
+                }
+            }
+            break;
+        }
+        case replay_kind::CANCEL:
+        {
+            bool is_ok = book.engine->cancel_order(replay_cmd.cancel_id);
+            if(writer != nullptr) { writer->cancel(replay_cmd.symbol, replay_cmd.cancel_id, is_ok); }
+            if(is_ok) { metric.orders_cancel++; }
+            else if(human)
+            {
+                fmt::print(stderr, "Warning: CANCEL failed (not found): order_id={}\n", replay_cmd.cancel_id);
+            }
+            break;
+        }
+        case replay_kind::MASS_CANCEL:
+        {
+            auto mass_result = book.engine->mass_cancel(replay_cmd.mass);
+            metric.orders_cancel += mass_result.cancelled;
+            if(writer != nullptr) { writer->mass_cancel(replay_cmd.symbol, mass_result); }
+            if(human)
+            {
+                fmt::print("MASS_CANCEL: cancelled={} cancelled_qty={}\n", mass_result.cancelled, mass_result.cancelled_qty);
+            }
+            break;
+        }
+        case replay_kind::UNCROSS:
+        case replay_kind::SET_MODE:
+        {
+            auto uncross_result = (replay_cmd.kind == replay_kind::UNCROSS) ? book.engine->uncross() : book.engine->set_matching_mode(replay_cmd.mode);
+            metric.trades += uncross_result.trades.size();
+            metric.traded_qty += static_cast<uint64_t>(uncross_result.volume);
+            if(writer != nullptr) { writer->uncross(replay_cmd.symbol, uncross_result); }
+            if(human)
+            {
+                if(replay_cmd.kind == replay_kind::SET_MODE)
+                {
+                    fmt::print("MODE: {}\n", replay_cmd.mode == MatchingMode::AUCTION ? "AUCTION" : "CONTINUOUS");
+                }
+                fmt::print("UNCROSS: price={} volume={} imbalance={} trades={}\n", 
+                    uncross_result.price, uncross_result.volume, uncross_result.imbalance, uncross_result.trades.size());
+                for(const auto& trade : uncross_result.trades)
+                {
+                    if(!args_value.print_trades) { break; }
+                    fmt::print("TRADE taker={} maker={} price={:.2f} quantity={} timestamp={}\n", 
+                        trade.taker, trade.maker, static_cast<double>(trade.price)/100.0, trade.qty, trade.timestamp);
+                }
+            }
+            break;
+        }
+        case replay_kind::STOP:
+            break;
+        }
+    }
+
+    /**
+     * @brief Replay worker for --threads mode: owns the books of the symbols routed to it and replays them in arrival order.
+     * 
+     */
+    struct replay_worker_t {
+        static constexpr std::size_t ring_capacity = 1U << 14;
+        static constexpr std::size_t pop_batch = 256;
+
+        concurrency::SpscRing<replay_cmd_t> ring{ring_capacity};
+        std::unordered_map<uint32_t, symbol_book_t> books; // symbol index -> book, touched only by the worker until joined
+        std::unique_ptr<result_writer_t> writer; // own buffer into the shared --out file, null without --out
+        const open_loop_pacer_t* pacer = nullptr; // open-loop replay: latency counts from each command's due time
+        open_loop_samples_t samples;
+        std::unique_ptr<TraceRecorder> recorder; // --trace, null otherwise
+        std::thread thread;
+
+        void run(const args& args_value)
+        {
+            std::vector<replay_cmd_t> batch(pop_batch);
+            for(;;)
+            {
+                const std::size_t num = ring.try_pop_n(batch.data(), batch.size());
+                if(num == 0) { std::this_thread::yield(); continue; }
+                for(std::size_t i = 0; i < num; i++)
+                {
+                    if(batch[i].kind == replay_kind::STOP) { return; }
+                    const auto released = load_clock::now();
+                    if(recorder) { batch[i].trace.stamp(TraceStage::DEQUEUE); }
+                    apply(books[batch[i].symbol], batch[i], args_value, false, writer.get(), recorder.get());
+                    if(pacer != nullptr) { samples.record(pacer->intended(batch[i].due_ns), released, load_clock::now()); }
+                }
+            }
+        }
+
+        void push(const replay_cmd_t& replay_cmd)
+        {
+            while(!ring.push(replay_cmd)) { std::this_thread::yield(); }
+        }
     };
+
+    /**
+     * @brief Per-thread state of a --steal worker; the books themselves belong to no worker.
+     * 
+     */
+    struct steal_worker_t {
+        open_loop_samples_t samples;
+        std::unique_ptr<TraceRecorder> recorder; // --trace, null otherwise
+    };
+
+    // books are indexed by symbol; the per-book queue is small since a symbol rarely runs far ahead of its worker
+    inline constexpr std::size_t steal_max_books = 1U << 14;
+    inline constexpr std::size_t steal_queue_capacity = 1U << 10;
+
+    void print_schedule(const scheduler_stats_t& stats, const symbol_table_t& symbols)
+    {
+        const uint64_t total = stats.commands();
+        fmt::print("===== Work stealing =====\n");
+        fmt::print("workers={} books={} commands={} imbalance={:.2f} full_waits={}\n", stats.workers.size(), stats.books.size(), total, stats.imbalance(), stats.full_waits);
+        for(std::size_t i = 0; i < stats.workers.size(); i++)
+        {
+            const auto& worker = stats.workers[i];
+            fmt::print("worker {}: commands={} ({:.1f}%) runs={} steals={} idle_polls={}\n", i, worker.commands,
+                total == 0 ? 0.0 : 100.0 * static_cast<double>(worker.commands) / static_cast<double>(total), worker.runs, worker.steals, worker.idle_polls);
+        }
+        // the hottest books, where skew shows
+        std::vector<std::size_t> order(stats.books.size());
+        for(std::size_t i = 0; i < order.size(); i++) { order[i] = i; }
+        std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) { return stats.books[lhs].commands > stats.books[rhs].commands; });
+        for(std::size_t i = 0; i < order.size() && i < 5; i++)
+        {
+            const auto& book = stats.books[order[i]];
+            fmt::print("book {}: commands={} ({:.1f}%) runs={} migrations={}\n", symbols.names[order[i]].empty() ? "-" : symbols.names[order[i]], book.commands,
+                total == 0 ? 0.0 : 100.0 * static_cast<double>(book.commands) / static_cast<double>(total), book.runs, book.migrations);
+        }
+        fmt::print("=============================\n");
+    }
+
+    void print_open_loop(const args& args_value, open_loop_samples_t& samples)
+    {
+        std::sort(samples.latency_ns.begin(), samples.latency_ns.end());
+        std::sort(samples.service_ns.begin(), samples.service_ns.end());
+        const auto& latency = samples.latency_ns;
+        const auto& service = samples.service_ns;
+        fmt::print("===== Open-loop latency =====\n");
+        if(args_value.rate > 0.0) { fmt::print("schedule: poisson rate={:.0f}/s\n", args_value.rate); }
+        else { fmt::print("schedule: timestamps speed={}x\n", args_value.pace); }
+        fmt::print("commands={} max_behind_ns={}\n", latency.size(), samples.max_behind_ns);
+        fmt::print("latency_ns (from intended send): p50={} p90={} p99={} p99.9={} max={}\n", percentile_of_sorted(latency, 50.0),
+            percentile_of_sorted(latency, 90.0), percentile_of_sorted(latency, 99.0), percentile_of_sorted(latency, 99.9), latency.empty() ? 0 : latency.back());
+        fmt::print("service_ns (from actual send): p50={} p90={} p99={} p99.9={} max={}\n", percentile_of_sorted(service, 50.0),
+            percentile_of_sorted(service, 90.0), percentile_of_sorted(service, 99.0), percentile_of_sorted(service, 99.9), service.empty() ? 0 : service.back());
+        fmt::print("=============================\n");
+    }
+
+    // upper bound of the bucket holding the percentile
+    auto histogram_percentile(const latency_histogram_t& histogram, double percent) -> uint64_t
+    {
+        const uint64_t count = histogram.count();
+        if(count == 0) { return 0; }
+        const auto rank = static_cast<uint64_t>(percent / 100.0 * static_cast<double>(count - 1));
+        uint64_t seen = 0;
+        for(std::size_t i = 0; i < latency_buckets; i++)
+        {
+            seen += histogram.counts[i];
+            if(seen > rank) { return latency_histogram_t::upper_bound_ns(i); }
+        }
+        return latency_histogram_t::upper_bound_ns(latency_buckets - 1);
+    }
+
+    void print_trace(const trace_stats_t& stats)
+    {
+        fmt::print("===== Trace (ns, time since the previous stage; percentiles are log2 bucket bounds) =====\n");
+        fmt::print("traced={} dumped={}\n", stats.traced, stats.dumped);
+        auto line = [](const char* name, const latency_histogram_t& histogram) {
+            const uint64_t count = histogram.count();
+            if(count == 0) { return; }
+            fmt::print("{:<12} count={} mean={:.0f} p50<={} p99<={} p99.9<={}\n", name, count, static_cast<double>(histogram.sum_ns) / static_cast<double>(count),
+                histogram_percentile(histogram, 50.0), histogram_percentile(histogram, 99.0), histogram_percentile(histogram, 99.9));
+        };
+        for(std::size_t s = 1; s < trace_stages; s++) { line(TraceRecorder::stage_name(static_cast<TraceStage>(s)), stats.stage[s]); }
+        line("total", stats.total);
+        fmt::print("=============================\n");
+    }
+
+    void print_snapshot(const std::string& symbol, const IEngine& engine, int depth)
+    {
+        auto snap = engine.snapshot(depth);
+
+        if(symbol.empty()) { fmt::print("===== Order Book snapshot_t (top {} levels) =====\n", depth); }
+        else { fmt::print("===== Order Book snapshot_t {} (top {} levels) =====\n", symbol, depth); }
+        fmt::print("BIDs: \n");
+        for(auto& level : snap.bids)
+        {
+            fmt::print("  price={:.2f} qty={}\n", static_cast<double>(level.price)/100.0, level.qty);
+        }
+        fmt::print("ASKs: \n");
+        for(auto& level : snap.asks)
+        {
+            fmt::print("  price={:.2f} qty={}\n", static_cast<double>(level.price)/100.0, level.qty);
+        }
+        fmt::print("=====================================\n");
+    }
 }; // anonymous namespace
 
 using namespace cli;
@@ -154,145 +443,212 @@ int main(int argc, char** argv)
         return 2;
     }
 
-    // create engine instance
-    auto engine = make_engine({/*market_gtc_as_ioc*/.market_gtc_as_ioc=true, /*markets_max_levels*/.market_max_levels=0});
+    // --out: buffered machine-readable records, one writer per replay thread
+    std::unique_ptr<out_file_t> out_file;
+    std::unique_ptr<result_writer_t> writer;
+    if(!args_value.out_file.empty())
+    {
+        out_file = std::make_unique<out_file_t>(args_value.out_file, args_value.out_fmt);
+        if(!out_file->is_open())
+        {
+            fmt::print(stderr, "Error: cannot open output file {}\n", args_value.out_file);
+            return 2;
+        }
+        writer = std::make_unique<result_writer_t>(*out_file);
+    }
 
-    metrics_t metric{};
-    std::string line;
-    bool first_line = true;
+    // symbol index -> book; with --threads the books live in the workers until they are joined
+    symbol_table_t symbols;
+    std::map<uint32_t, symbol_book_t> books;
 
-    while(std::getline(infile, line))
+    // --threads N: this thread decodes and routes by symbol, N workers replay their symbols independently
+    const bool threaded = args_value.threads > 0;
+    std::vector<std::unique_ptr<replay_worker_t>> workers;
+    for(unsigned i = 0; i < args_value.threads && !args_value.steal; i++)
+    {
+        workers.push_back(std::make_unique<replay_worker_t>());
+        if(out_file) { workers.back()->writer = std::make_unique<result_writer_t>(*out_file); }
+    }
+    // --pace / --rate: commands are released on a schedule instead of back to back
+    std::optional<open_loop_pacer_t> pacer;
+    open_loop_samples_t samples;
+    timestamp_schedule_t timestamps{.ns_per_unit=args_value.ts_ns_per_unit, .speed=args_value.pace};
+    poisson_arrivals_t arrivals(args_value.rate > 0.0 ? args_value.rate : 1.0, 1);
+    if(args_value.open_loop()) { pacer.emplace(); }
+
+    // --steal: every symbol is a unit of work with its own queue, an idle worker takes whole books from a busy one
+    std::vector<symbol_book_t> steal_books;
+    std::vector<steal_worker_t> steal_workers;
+    std::unique_ptr<BookScheduler<replay_cmd_t>> scheduler;
+    bool too_many_books = false;
+    if(args_value.steal)
     {
-        // do cleanup for the line in order to get # or spaces only
-        line = trim(line);
-        if(line.empty() || line[0] == '#') {continue;} // skip empty lines or comments
-        auto cells = split_csv_line(line);
+        steal_books.resize(steal_max_books);
+        steal_workers.resize(args_value.threads);
+        scheduler = std::make_unique<BookScheduler<replay_cmd_t>>(args_value.threads, steal_max_books,
+            [&](std::size_t worker, std::size_t book, replay_cmd_t& replay_cmd) {
+                steal_worker_t& state = steal_workers[worker];
+                symbol_book_t& symbol_book = steal_books[book]; // book index == symbol index
+                const auto released = load_clock::now();
+                if(state.recorder) { replay_cmd.trace.stamp(TraceStage::DEQUEUE); }
+                apply(symbol_book, replay_cmd, args_value, false, symbol_book.writer.get(), state.recorder.get());
+                if(pacer) { state.samples.record(pacer->intended(replay_cmd.due_ns), released, load_clock::now()); }
+            }, steal_queue_capacity);
+    }
 
-        // parsing header line or skip it
-        if(first_line) 
+    // --trace: one recorder per replaying thread, each with its own dump file
+    std::unique_ptr<TraceRecorder> recorder;
+    if(args_value.trace && !threaded) { recorder = std::make_unique<TraceRecorder>(args_value.trace_file, args_value.trace_every); }
+    for(std::size_t i = 0; i < args_value.threads && args_value.trace; i++)
+    {
+        const std::string dump = args_value.trace_file.empty() ? std::string{} : fmt::format("{}.{}", args_value.trace_file, i);
+        auto& worker_recorder = args_value.steal ? steal_workers[i].recorder : workers[i]->recorder;
+        worker_recorder = std::make_unique<TraceRecorder>(dump, args_value.trace_every);
+    }
+    auto dumps_open = [&] {
+        if(args_value.trace_file.empty()) { return true; }
+        if(recorder && !recorder->is_open()) { return false; }
+        return std::all_of(workers.begin(), workers.end(), [](const auto& worker) { return worker->recorder->is_open(); }) &&
+               std::all_of(steal_workers.begin(), steal_workers.end(), [](const auto& worker) { return worker.recorder->is_open(); });
+    };
+    if(!dumps_open())
+    {
+        fmt::print(stderr, "Error: cannot open trace file {}\n", args_value.trace_file);
+        return 2;
+    }
+
+    for(auto& worker : workers)
+    {
+        if(pacer) { worker->pacer = &*pacer; }
+        worker->thread = std::thread([replay_worker = worker.get(), &args_value] { replay_worker->run(args_value); });
+    }
+    if(scheduler) { scheduler->start(); }
+
+    // a symbol always goes to the same worker, or with --steal to its own book queue, so its commands stay in order
+    auto dispatch = [&](replay_cmd_t& replay_cmd) {
+        if(args_value.trace) { replay_cmd.trace.stamp(TraceStage::ENQUEUE); }
+        if(!scheduler)
+        {
+            workers[replay_cmd.symbol % workers.size()]->push(replay_cmd);
+            return;
+        }
+        // symbol indices are dense, a new symbol is the next book
+        while(scheduler->books() <= replay_cmd.symbol)
         {
-            if(!cells.empty() && ieq(cells[0], "timestamp"))
+            const std::size_t book = scheduler->add_book();
+            if(book == BookScheduler<replay_cmd_t>::npos)
             {
-                // get first line
-                first_line = false; 
-                continue;
+                too_many_books = true;
+                return;
             }
-            // error code 
-            fmt::print(stderr, "Error: invalid first line (not header): {}\n", line); 
-            return 3;
+            if(out_file) { steal_books[book].writer = std::make_unique<result_writer_t>(*out_file); }
         }
+        scheduler->submit(replay_cmd.symbol, replay_cmd);
+    };
 
-        if(cells.size() < 3)
+    const int exit_code = for_each_replay_cmd(infile, symbols, [&](replay_cmd_t replay_cmd) {
+        if(args_value.trace) { replay_cmd.trace.stamp(TraceStage::INGRESS); }
+        if(!pacer)
         {
-            fmt::print(stderr, "Warning: invalid line (too few columns): {}\n", line);
-            continue;
+            if(!threaded) { apply(books[replay_cmd.symbol], replay_cmd, args_value, true, writer.get(), recorder.get()); }
+            else { dispatch(replay_cmd); }
+            return;
         }
 
-        // cmd column
-        const std::string& cmd = cells[1];
-
-        if(ieq(cmd, "ADD"))
+        replay_cmd.due_ns = args_value.rate > 0.0 ? arrivals.due_ns() : timestamps.due_ns(replay_cmd.timestamp);
+        const auto intended = pacer->wait(replay_cmd.due_ns);
+        if(!threaded)
         {
-            // timestamp,cmd,side,order_type,time_in_force,price,qty[,order_id], at least 7 columns
-            if(cells.size() < static_cast<size_t>(csv_columns::ORDER_ID))
-            {
-                fmt::print(stderr, "Warning: invalid ADD line (too few columns): {}\n", line);
-                continue;
-            }
-
-            const std::string& side_str = cells[static_cast<size_t>(csv_columns::SIDE)];
-            const std::string& order_type_str = cells[static_cast<size_t>(csv_columns::ORDER_TYPE)];
-            const std::string& tif_str = cells[static_cast<size_t>(csv_columns::TIME_IN_FORCE)];
-            const std::string& price_str = cells[static_cast<size_t>(csv_columns::PRICE)];
-            const std::string& qty_str = cells[static_cast<size_t>(csv_columns::QTY)];
-            const std::string& order_id_str = (cells.size() >= static_cast<size_t>(csv_columns::ORDER_ID) + 1 ? cells[static_cast<size_t>(csv_columns::ORDER_ID)] : "");
-
-            order_cmd_t order_cmd{};
-            order_cmd.side = ieq(side_str, "BUY") ? Side::BUY : (Side::SELL);
-            order_cmd.order_type =  ieq(order_type_str, "LIMIT") ? OrderType::LIMIT : OrderType::MARKET;
-            order_cmd.time_in_force = ieq(tif_str, "IOC") ? TimeInForce::IOC : (ieq(tif_str, "FOK") ? TimeInForce::FOK : TimeInForce::GTC);
-
-            order_cmd.price = price_str.empty() ? 0 : static_cast<price_t>(std::stoll(price_str));
-            order_cmd.qty = static_cast<qty_t>(std::stoll(qty_str));
-
-            // optional order_id field - if empty, engine will assign with offset automatically
-            if(!order_id_str.empty())
-            {
-                order_cmd.order_id = static_cast<engine::id_t>(std::stoull(order_id_str));
-            }
-
-            // status, order_id, trades, filled_qty, remaining_qty 
-            auto order_result = engine->add_order(order_cmd);
-            metric.orders_add++;
-
-            fmt::print("===============================\n");
-            fmt::print("ADD order: timestamp={} side={} order_type={} time_in_force={} price={} qty={}\n", 
-                cells[0], side_str, order_type_str, tif_str, order_cmd.price, order_cmd.qty);
-            fmt::print("-------------------------------\n");
-            fmt::print("order_id={} status={}\n", order_result.order_id, std::to_string(static_cast<int>(order_result.status)));
-            // parsing all handled trades for metrics which is independent from status (bad status = no trades)
-            for(auto& trade: order_result.trades)
-            {
-                metric.trades++;
-                metric.traded_qty += trade.qty;
-                if (args_value.print_trades) 
-                {
-                    fmt::print("TRADE taker={} maker={} price={:.2f} quantity={} timestamp={}\n", 
-                        trade.taker, trade.maker, static_cast<double>(trade.price)/100.0, trade.qty, trade.timestamp);
-                }
-            }
-
-        } else if (ieq(cmd, "CANCEL"))
+            const auto released = load_clock::now();
+            apply(books[replay_cmd.symbol], replay_cmd, args_value, true, writer.get(), recorder.get());
+            samples.record(intended, released, load_clock::now());
+        }
+        else
         {
-            // timestamp,cmd,order_id
-            const std::string& order_id_str = cells.back();
-
-            // for cancel, order_id is required. Order_id is in the last column and able to be parsed to uint64_t
-            if(order_id_str.empty())
-            {
-                fmt::print(stderr, "Warning: invalid CANCEL line (missing order_id): {}\n", line);
-                continue;
-            }
-
-            bool is_ok = engine->cancel_order(static_cast<engine::id_t>(std::stoull(order_id_str)));
-            if(is_ok) { metric.orders_cancel++; }
-            else
-            {
-                fmt::print(stderr, "Warning: CANCEL failed (not found): {}\n", line);
-            }
+            // the worker measures from the due time, so time spent in its ring counts as latency
+            dispatch(replay_cmd);
+        }
+    });
 
-        } else
+    // stop the workers and merge their books
+    for(auto& worker : workers)
+    {
+        worker->push(replay_cmd_t{});
+        worker->thread.join();
+        if(worker->writer) { worker->writer->flush(); }
+        for(auto& [symbol, book] : worker->books) { books[symbol] = std::move(book); }
+        samples.merge(worker->samples);
+    }
+    std::optional<scheduler_stats_t> schedule;
+    if(scheduler)
+    {
+        scheduler->stop();
+        schedule = scheduler->stats();
+        for(std::size_t book = 0; book < scheduler->books(); book++)
         {
-            fmt::print(stderr, "Warning: unknown command (not ADD or CANCEL): {}\n", line);
-            continue;
+            if(!steal_books[book].engine) { continue; } // a symbol index no command used
+            if(steal_books[book].writer) { steal_books[book].writer->flush(); }
+            books[static_cast<uint32_t>(book)] = std::move(steal_books[book]);
         }
+        for(auto& worker : steal_workers) { samples.merge(worker.samples); }
+    }
+    trace_stats_t trace_stats{};
+    if(recorder) { trace_stats += recorder->stats(); }
+    for(auto& worker : workers)
+    {
+        if(worker->recorder) { trace_stats += worker->recorder->stats(); }
+    }
+    for(auto& worker : steal_workers)
+    {
+        if(worker.recorder) { trace_stats += worker.recorder->stats(); }
+    }
+    if(exit_code != 0) { return exit_code; }
+    if(too_many_books)
+    {
+        fmt::print(stderr, "Error: --steal replays at most {} symbols\n", steal_max_books);
+        return 2;
     }
 
-    // print final snapshot
-    auto snap = engine->snapshot(args_value.depth);
-    
-    fmt::print("===== Order Book snapshot_t (top {} levels) =====\n", args_value.depth);
-    fmt::print("BIDs: \n");
-    for(auto& level : snap.bids)
+    // print final snapshot per symbol
+    metrics_t metric{};
+    for(auto& [symbol, book] : books)
     {
-        fmt::print("  price={:.2f} qty={}\n", static_cast<double>(level.price)/100.0, level.qty);
+        print_snapshot(symbols.names[symbol], *book.engine, args_value.depth);
+        metric += book.metric;
     }
-    fmt::print("ASKs: \n");
-    for(auto& level : snap.asks)
+
+    if(writer)
     {
-        fmt::print("  price={:.2f} qty={}\n", static_cast<double>(level.price)/100.0, level.qty);
+        for(auto& [symbol, book] : books)
+        {
+            auto snap = book.engine->snapshot(args_value.depth);
+            for(std::size_t i = 0; i < snap.bids.size(); i++) { writer->level(symbol, Side::BUY, static_cast<uint16_t>(i), snap.bids[i]); }
+            for(std::size_t i = 0; i < snap.asks.size(); i++) { writer->level(symbol, Side::SELL, static_cast<uint16_t>(i), snap.asks[i]); }
+        }
+        for(uint32_t symbol = 0; symbol < symbols.names.size(); symbol++) { writer->symbol_name(symbol, symbols.names[symbol]); }
+        writer->flush();
     }
-    fmt::print("=====================================\n");
 
     if(args_value.print_metrics)
     {
         fmt::print("===== Metrics =====\n");
+        if(books.size() > 1)
+        {
+            for(auto& [symbol, book] : books)
+            {
+                fmt::print("{}: added={} canceled={} trades={} traded_qty={}\n", symbols.names[symbol], 
+                    book.metric.orders_add, book.metric.orders_cancel, book.metric.trades, book.metric.traded_qty);
+            }
+        }
         fmt::print("Orders added: {}\n", metric.orders_add);
         fmt::print("Orders canceled: {}\n", metric.orders_cancel);
         fmt::print("Trades executed: {}\n", metric.trades);
         fmt::print("Total traded quantity: {}\n", metric.traded_qty);
         fmt::print("===================\n");
     }
+    if(schedule && args_value.print_metrics) { print_schedule(*schedule, symbols); }
+    if(pacer) { print_open_loop(args_value, samples); }
+    if(args_value.trace) { print_trace(trace_stats); }
 
     return 0;
-}
\ No newline at end of file
+}
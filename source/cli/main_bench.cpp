@@ -1,11 +1,22 @@
 #include <libs/engine/engine.hpp>
+#include <libs/engine/book_arena.hpp>
+#include <libs/engine/async_engine.hpp>
+#include "bench_report.hpp"
+#include "perf_counters.hpp"
+#include "open_loop.hpp"
 #include <fmt/format.h>
 #include <atomic>
+#include <coroutine>
 #include <cstdint>
+#include <fstream>
 #include <random>
+#include <sstream>
 #include <vector>
 #include <algorithm>
 #include <chrono>
+#include <memory>
+#include <span>
+#include <string>
 
 using namespace engine;
 
@@ -18,7 +29,54 @@ struct args
     std::uint16_t max_qty = 100; /**< maximum quantity per order */
     price_t mid_price = 10000; /**< mid price in ticks */
     std::uint8_t depth = 5; /**< Depth of the order book snapshot */
+    LevelLayout layout = LevelLayout::AOS; /**< price level storage layout (aos|soa) */
+    bool arena = false; /**< book containers allocate from a BookArena instead of the heap (heap|arena) */
+    CancelMode cancel_mode = CancelMode::ERASE; /**< how a cancelled order leaves its level (erase|tombstone) */
+    std::uint32_t cancel_depth = 2000; /**< orders resting on one level for the cancel phase, cancelled in random queue order */
+    bool prewarm = false; /**< startup preparation: pre-faulted arena, pre-sized index and a synthetic engine warm-up */
+    bool huge_pages = false; /**< back the arena with huge pages (implies arena) */
+    std::uint32_t prewarm_orders = 20000; /**< synthetic orders of the engine warm-up */
+    std::uint32_t first_n = 1000; /**< the first orders of a fresh engine reported separately */
+    std::uint32_t warmup = 0; /**< warm-up orders before the steady phase (default n_orders / 10) */
+    std::uint32_t sweeps = 1000; /**< number of refill + multi-level sweep rounds after the steady phase */
+    bool perf = false; /**< measure hardware counters per phase */
+    std::uint32_t iterations = 1; /**< repeated runs on fresh engines, summarized by median and CI */
+    bool json = false; /**< print one JSON document instead of text */
+    std::string baseline; /**< JSON output of a previous run to compare against */
+    double threshold_pct = 5.0; /**< median change that counts as a regression when significant */
+    double rate = 0.0; /**< open-loop steady phase: orders per second with Poisson arrivals, latency from the intended send time (0: closed loop) */
+    bool pipeline = false; /**< steady phase through the AsyncEngine matching thread; with --rate orders are submitted on schedule without waiting for completions */
 };
+
+// resumed by AsyncEngine::poll() on the bench thread, so the samples need no synchronization
+inline detached_task_t timed_submit(AsyncEngine& async, order_cmd_t order_cmd, cli::load_clock::time_point intended,
+    cli::load_clock::time_point released, cli::open_loop_samples_t& samples)
+{
+    co_await async.submit(order_cmd);
+    samples.record(intended, released, cli::load_clock::now());
+}
+
+// one line per phase; counters as per-order averages, n/a when unavailable
+inline void print_phase(const phase_result_t& phase, bool with_counters)
+{
+    const double orders = phase.orders == 0 ? 1.0 : static_cast<double>(phase.orders);
+    fmt::print("phase={} orders={} ns_per_order={:.1f}", phase.name, phase.orders, static_cast<double>(phase.total_ns) / orders);
+    if(with_counters)
+    {
+        for(std::size_t i = 0; i < perf_counter_names.size(); i++)
+        {
+            if(phase.counters.valid[i]) { fmt::print(" {}={:.2f}", perf_counter_names[i], static_cast<double>(phase.counters.values[i]) / orders); }
+            else { fmt::print(" {}=n/a", perf_counter_names[i]); }
+        }
+        const auto cycles = static_cast<std::size_t>(perf_counter::CYCLES);
+        const auto instructions = static_cast<std::size_t>(perf_counter::INSTRUCTIONS);
+        if(phase.counters.valid[cycles] && phase.counters.valid[instructions] && phase.counters.values[cycles] != 0)
+        {
+            fmt::print(" ipc={:.2f}", static_cast<double>(phase.counters.values[instructions]) / static_cast<double>(phase.counters.values[cycles]));
+        }
+    }
+    fmt::print("\n");
+}
 }; //namespace cli_bench
 
 using namespace cli_bench;
@@ -55,9 +113,81 @@ int main(int argc, char** argv)
         {
             args_value.depth = static_cast<std::uint8_t>(std::stoul(argv[++i]));
         }
+        else if(arg == "--layout" && ( i + 1 < argc ))
+        {
+            args_value.layout = (std::string(argv[++i]) == "soa") ? LevelLayout::SOA : LevelLayout::AOS;
+        }
+        else if(arg == "--memory" && ( i + 1 < argc ))
+        {
+            args_value.arena = (std::string(argv[++i]) == "arena");
+        }
+        else if(arg == "--cancel" && ( i + 1 < argc ))
+        {
+            args_value.cancel_mode = (std::string(argv[++i]) == "tombstone") ? CancelMode::TOMBSTONE : CancelMode::ERASE;
+        }
+        else if(arg == "--cancel-depth" && ( i + 1 < argc ))
+        {
+            args_value.cancel_depth = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+        }
+        else if(arg == "--prewarm")
+        {
+            args_value.prewarm = true;
+        }
+        else if(arg == "--prewarm-orders" && ( i + 1 < argc ))
+        {
+            args_value.prewarm_orders = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+        }
+        else if(arg == "--huge-pages")
+        {
+            args_value.huge_pages = true;
+        }
+        else if(arg == "--first-n" && ( i + 1 < argc ))
+        {
+            args_value.first_n = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+        }
+        else if(arg == "--warmup" && ( i + 1 < argc ))
+        {
+            args_value.warmup = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+        }
+        else if(arg == "--sweeps" && ( i + 1 < argc ))
+        {
+            args_value.sweeps = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+        }
+        else if(arg == "--perf")
+        {
+            args_value.perf = true;
+        }
+        else if(arg == "--iterations" && ( i + 1 < argc ))
+        {
+            args_value.iterations = std::max<std::uint32_t>(1, static_cast<std::uint32_t>(std::stoul(argv[++i])));
+        }
+        else if(arg == "--json")
+        {
+            args_value.json = true;
+        }
+        else if(arg == "--baseline" && ( i + 1 < argc ))
+        {
+            args_value.baseline = argv[++i];
+        }
+        else if(arg == "--threshold" && ( i + 1 < argc ))
+        {
+            args_value.threshold_pct = std::stod(argv[++i]);
+        }
+        else if(arg == "--rate" && ( i + 1 < argc ))
+        {
+            args_value.rate = std::stod(argv[++i]);
+        }
+        else if(arg == "--pipeline")
+        {
+            args_value.pipeline = true;
+        }
+    }
+    if(args_value.warmup == 0) { args_value.warmup = args_value.n_orders / 10; }
+    args_value.arena = args_value.arena || args_value.prewarm || args_value.huge_pages;
+    if(!args_value.baseline.empty() && args_value.iterations < min_compare_samples)
+    {
+        fmt::print(stderr, "--baseline needs --iterations {} or more; with {} the comparison is reported inconclusive\n", min_compare_samples, args_value.iterations);
     }
-
-    auto eng = make_engine(engine_config_t{true, 0});
 
     // random generator
     std::mt19937 rng(args_value.seed);
@@ -67,11 +197,7 @@ int main(int argc, char** argv)
     std::uniform_int_distribution<int> qty_dist(1, args_value.max_qty); // quantity distribution
 
     // ----- create order flow (simple model) -----
-    std::vector<order_cmd_t> flow;
-    flow.reserve(args_value.n_orders);
-
-    for(std::uint32_t i = 0; i < args_value.n_orders; i++)
-    {
+    auto random_order = [&]() {
         order_cmd_t order_cmd{};
         order_cmd.side = (side_dist(rng) == 0) ? Side::BUY : Side::SELL;
         order_cmd.order_type = OrderType::LIMIT;
@@ -79,48 +205,317 @@ int main(int argc, char** argv)
                                    (time_in_force_dist(rng) == 1) ? TimeInForce::IOC : TimeInForce::FOK;
         order_cmd.price = args_value.mid_price + static_cast<price_t>(price_level_dist(rng));
         order_cmd.qty = static_cast<qty_t>(qty_dist(rng));
+        return order_cmd;
+    };
+
+    std::vector<order_cmd_t> warmup_flow;
+    warmup_flow.reserve(args_value.warmup);
+    for(std::uint32_t i = 0; i < args_value.warmup; i++) { warmup_flow.emplace_back(random_order()); }
+
+    std::vector<order_cmd_t> flow;
+    flow.reserve(args_value.n_orders);
+    for(std::uint32_t i = 0; i < args_value.n_orders; i++) { flow.emplace_back(random_order()); }
 
-        flow.emplace_back(order_cmd);
+    // sweep: rest one GTC order on every hot level of one side, then an IOC that takes all of them
+    std::vector<order_cmd_t> sweep_flow;
+    const auto levels = static_cast<std::size_t>(2 * args_value.hot_levels + 1);
+    sweep_flow.reserve(static_cast<std::size_t>(args_value.sweeps) * (levels + 1));
+    for(std::uint32_t i = 0; i < args_value.sweeps; i++)
+    {
+        const Side maker_side = (i % 2 == 0) ? Side::SELL : Side::BUY;
+        qty_t swept_qty = 0;
+        for(int level = -args_value.hot_levels; level <= args_value.hot_levels; level++)
+        {
+            const auto qty = static_cast<qty_t>(qty_dist(rng));
+            swept_qty += qty;
+            sweep_flow.emplace_back(order_cmd_t{.side=maker_side, .order_type=OrderType::LIMIT, .time_in_force=TimeInForce::GTC,
+                .price=args_value.mid_price + static_cast<price_t>(level), .qty=qty});
+        }
+        const price_t far_px = args_value.mid_price + static_cast<price_t>(maker_side == Side::SELL ? args_value.hot_levels : -args_value.hot_levels);
+        sweep_flow.emplace_back(order_cmd_t{.side=(maker_side == Side::SELL) ? Side::BUY : Side::SELL, .order_type=OrderType::LIMIT,
+            .time_in_force=TimeInForce::IOC, .price=far_px, .qty=swept_qty});
     }
 
+    // cancel: one crowded level below the book, then its orders cancelled in random queue positions
+    const price_t cancel_px = args_value.mid_price - static_cast<price_t>(args_value.hot_levels) - 1;
+    std::vector<std::size_t> cancel_order_pos(args_value.cancel_depth);
+    for(std::size_t i = 0; i < cancel_order_pos.size(); i++) { cancel_order_pos[i] = i; }
+    std::shuffle(cancel_order_pos.begin(), cancel_order_pos.end(), rng);
+
+    // open loop: the same arrival times for every iteration
+    const bool open_loop = args_value.rate > 0.0 || args_value.pipeline;
+    std::vector<std::uint64_t> schedule;
+    if(args_value.rate > 0.0) { schedule = cli::poisson_schedule(flow.size(), args_value.rate, args_value.seed); }
 
-    // ----- stress test main -----
+    perf_counter_group_t* counters = nullptr;
+    std::unique_ptr<perf_counter_group_t> counter_group;
+    if(args_value.perf)
+    {
+        counter_group = std::make_unique<perf_counter_group_t>();
+        if(counter_group->available()) { counters = counter_group.get(); }
+    }
+
+    // counters and wall time around the matching loop; per-order latencies only when asked for
+    auto run_phase = [&](IEngine& eng, const char* name, std::span<const order_cmd_t> phase_flow, std::vector<uint64_t>* latencies) {
+        phase_result_t phase{.name=name, .orders=phase_flow.size()};
+        if(counters != nullptr) { counters->start(); }
+        const auto t_start = std::chrono::high_resolution_clock::now();
+        for(const auto& order_cmd : phase_flow)
+        {
+            if(latencies == nullptr)
+            {
+                eng.add_order(order_cmd);
+                continue;
+            }
+            const auto t_oc_start = std::chrono::high_resolution_clock::now();
+            eng.add_order(order_cmd);
+            const auto t_oc_end = std::chrono::high_resolution_clock::now();
+            const auto duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t_oc_end - t_oc_start);
+            latencies->push_back(static_cast<std::uint64_t>(duration_ns.count()));
+        }
+        const auto t_end = std::chrono::high_resolution_clock::now();
+        if(counters != nullptr) { phase.counters = counters->stop(); }
+        phase.total_ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t_end - t_start).count());
+        return phase;
+    };
+
+    // open loop: each order is sent at its scheduled time whether or not the previous one finished, and its latency
+    // runs from that time, so a stall is charged to every order queued behind it; without --rate the send time is the schedule
+    auto run_open_loop = [&](IEngine& eng, AsyncEngine* async, std::span<const order_cmd_t> phase_flow, cli::open_loop_samples_t& samples) {
+        phase_result_t phase{.name="steady", .orders=phase_flow.size()};
+        samples.latency_ns.reserve(phase_flow.size());
+        samples.service_ns.reserve(phase_flow.size());
+        if(async != nullptr) { async->start(); }
+        if(counters != nullptr) { counters->start(); }
+        const cli::open_loop_pacer_t pacer;
+        for(std::size_t i = 0; i < phase_flow.size(); i++)
+        {
+            auto intended = pacer.start();
+            if(!schedule.empty())
+            {
+                intended = pacer.intended(schedule[i]);
+                // the pipelined submitter resumes finished orders while it waits
+                while(cli::load_clock::now() < intended)
+                {
+                    if(async == nullptr || async->poll() == 0) { std::this_thread::yield(); }
+                }
+            }
+            const auto released = cli::load_clock::now();
+            if(schedule.empty()) { intended = released; }
+            if(async != nullptr)
+            {
+                timed_submit(*async, phase_flow[i], intended, released, samples);
+                continue;
+            }
+            eng.add_order(phase_flow[i]);
+            samples.record(intended, released, cli::load_clock::now());
+        }
+        if(async != nullptr)
+        {
+            async->drain();
+            async->stop();
+        }
+        if(counters != nullptr) { phase.counters = counters->stop(); }
+        phase.total_ns = cli::open_loop_samples_t::elapsed_ns(pacer.start(), cli::load_clock::now());
+        return phase;
+    };
+
+    // ----- stress test main: every iteration replays the same flow on a fresh engine -----
+    engine_config_t config{.market_gtc_as_ioc=true, .market_max_levels=0, .level_layout=args_value.layout, .cancel_mode=args_value.cancel_mode};
+    if(args_value.prewarm)
+    {
+        config.reserve_orders = static_cast<std::size_t>(args_value.warmup) + args_value.n_orders;
+        config.warmup_orders = args_value.prewarm_orders;
+    }
+    const book_arena_options_t arena_options{.huge_pages=args_value.huge_pages, .prefault=args_value.prewarm};
+    std::vector<run_result_t> runs;
+    runs.reserve(args_value.iterations);
     std::vector<uint64_t> latencies_ns;
     latencies_ns.reserve(args_value.n_orders);
+    std::vector<uint64_t> first_latencies_ns;
+    first_latencies_ns.reserve(args_value.warmup);
+    std::vector<uint64_t> cancel_latencies_ns;
+    cancel_latencies_ns.reserve(args_value.cancel_depth);
+    std::vector<engine::id_t> cancel_ids(args_value.cancel_depth);
+    snapshot_t snap;
+    PageBacking page_backing = PageBacking::HEAP;
 
-    const auto t_start = std::chrono::high_resolution_clock::now();
-    for(const auto& order_cmd : flow)
+    for(std::uint32_t iteration = 0; iteration < args_value.iterations; iteration++)
     {
-        const auto t_oc_start = std::chrono::high_resolution_clock::now();
-        eng->add_order(order_cmd);
-        const auto t_oc_end = std::chrono::high_resolution_clock::now();
-        const auto duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t_oc_end - t_oc_start);
-        latencies_ns.push_back(duration_ns.count());
+        // a fresh arena per iteration, destroyed after the engine that uses it
+        // startup (arena reservation, pre-faulting, engine warm-up) is timed separately from the orders
+        const auto t_startup = std::chrono::high_resolution_clock::now();
+        std::unique_ptr<BookArena> arena;
+        if(args_value.arena) { arena = std::make_unique<BookArena>(arena_options); }
+        config.memory_resource = arena.get();
+        // --pipeline: the matching thread's engine is driven directly while the thread is stopped
+        std::unique_ptr<AsyncEngine> async;
+        std::unique_ptr<IEngine> owned;
+        if(args_value.pipeline) { async = std::make_unique<AsyncEngine>(config); }
+        else { owned = make_engine(config); }
+        IEngine* eng = async ? &async->engine() : owned.get();
+        const auto startup_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - t_startup).count();
+        if(arena) { page_backing = arena->page_backing(); }
+        latencies_ns.clear();
+        first_latencies_ns.clear();
+
+        run_result_t run;
+        run.startup_ms = static_cast<double>(startup_ns) / 1e6;
+        run.phases.push_back(run_phase(*eng, "warmup", warmup_flow, &first_latencies_ns));
+        if(open_loop)
+        {
+            cli::open_loop_samples_t samples;
+            run.phases.push_back(run_open_loop(*eng, async.get(), flow, samples));
+            latencies_ns = std::move(samples.latency_ns);
+            run.service_latency = summarize_latencies(samples.service_ns);
+            run.max_behind_ns = samples.max_behind_ns;
+        }
+        else
+        {
+            run.phases.push_back(run_phase(*eng, "steady", flow, &latencies_ns));
+        }
+        // the book at the end of the steady phase is what the snapshot shows
+        snap = eng->snapshot(args_value.depth);
+        run.metrics = eng->metrics();
+        run.memory = eng->memory_stats();
+        run.phases.push_back(run_phase(*eng, "sweep", sweep_flow, nullptr));
+
+        for(auto& order_id : cancel_ids)
+        {
+            order_id = eng->add_order(order_cmd_t{.side=Side::BUY, .order_type=OrderType::LIMIT, .time_in_force=TimeInForce::GTC, .price=cancel_px, .qty=1}).order_id;
+        }
+        cancel_latencies_ns.clear();
+        phase_result_t cancel_phase{.name="cancel", .orders=cancel_ids.size()};
+        if(counters != nullptr) { counters->start(); }
+        const auto t_cancel = std::chrono::high_resolution_clock::now();
+        for(const auto pos : cancel_order_pos)
+        {
+            const auto t_oc_start = std::chrono::high_resolution_clock::now();
+            eng->cancel_order(cancel_ids[pos]);
+            const auto t_oc_end = std::chrono::high_resolution_clock::now();
+            cancel_latencies_ns.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t_oc_end - t_oc_start).count()));
+        }
+        if(counters != nullptr) { cancel_phase.counters = counters->stop(); }
+        cancel_phase.total_ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - t_cancel).count());
+        run.phases.push_back(cancel_phase);
+        run.cancel_latency = summarize_latencies(cancel_latencies_ns);
+
+        const auto steady_ns = static_cast<double>(run.phases[1].total_ns);
+        run.total_ms = steady_ns / 1e6;
+        // throughput million per second
+        run.throughput_mops = steady_ns > 0.0 ? static_cast<double>(args_value.n_orders) / steady_ns * 1e3 : 0.0;
+        // the first orders a fresh engine sees: the warm-up phase, continued into the steady phase if shorter
+        first_latencies_ns.resize(std::min<std::size_t>(first_latencies_ns.size(), args_value.first_n));
+        for(std::size_t i = 0; i < latencies_ns.size() && first_latencies_ns.size() < args_value.first_n; i++)
+        {
+            first_latencies_ns.push_back(latencies_ns[i]);
+        }
+        run.first_n = first_latencies_ns.size();
+        run.first_latency = summarize_latencies(first_latencies_ns);
+        run.latency = summarize_latencies(latencies_ns);
+        runs.push_back(std::move(run));
     }
 
-    const auto t_end = std::chrono::high_resolution_clock::now();
-    
-    // get result
-    const auto total_duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t_end - t_start).count();
-    // throughtput million per second
-    const auto throughput_mops = static_cast<double>(args_value.n_orders) / (static_cast<double>(total_duration_ms) / 1000.0);
-
-    // latency statistics
-    auto get_percentile = [&](double percent) -> uint64_t {
-        std::vector<uint64_t> temp = latencies_ns;
-        auto idx = static_cast<uint8_t>((percent / 100.0) * static_cast<double>(temp.size() - 1));
-        std::nth_element(temp.begin(), temp.begin() + idx, temp.end());
-        return temp[idx];
-    };
+    // ----- baseline comparison -----
+    std::vector<comparison_t> comparisons;
+    bool regressed = false;
+    if(!args_value.baseline.empty())
+    {
+        std::ifstream baseline_file(args_value.baseline);
+        if(!baseline_file)
+        {
+            fmt::print(stderr, "cannot open baseline file '{}'\n", args_value.baseline);
+            return 2;
+        }
+        std::stringstream text;
+        text << baseline_file.rdbuf();
+        const baseline_reader_t baseline(text.str());
+        for(const auto& metric : tracked_metrics)
+        {
+            const auto baseline_samples = baseline.samples(metric.name);
+            if(!baseline_samples) { continue; }
+            comparisons.push_back(compare(metric, summarize(*baseline_samples), summarize(metric_samples(runs, metric)), args_value.threshold_pct));
+            regressed = regressed || comparisons.back().regression;
+        }
+    }
 
-    auto metric = eng->metrics();
-    auto snap = eng->snapshot(args_value.depth);
+    const auto& last = runs.back();
+    const char* layout_name = args_value.layout == LevelLayout::SOA ? "soa" : "aos";
+    const char* cancel_name = args_value.cancel_mode == CancelMode::TOMBSTONE ? "tombstone" : "erase";
+    if(args_value.json)
+    {
+        fmt::memory_buffer out;
+        fmt::format_to(std::back_inserter(out), "{{\"bench\":\"scopeX_bench\",\"format_version\":1,"
+            "\"config\":{{\"n_orders\":{},\"seed\":{},\"hot_levels\":{},\"max_qty\":{},\"mid_price\":{},\"layout\":\"{}\",\"cancel\":\"{}\",\"cancel_depth\":{},\"memory\":\"{}\",\"page_backing\":\"{}\",\"prewarm\":{},\"prewarm_orders\":{},"
+            "\"warmup\":{},\"sweeps\":{},\"perf\":{},\"perf_available\":{},\"rate\":{:.1f},\"pipeline\":{}}},\"iterations\":{},\"runs\":[",
+            args_value.n_orders, args_value.seed, args_value.hot_levels, args_value.max_qty, args_value.mid_price, layout_name, cancel_name, args_value.cancel_depth,
+            args_value.arena ? "arena" : "heap", page_backing_name(page_backing), args_value.prewarm, args_value.prewarm_orders, args_value.warmup, args_value.sweeps, args_value.perf, counters != nullptr, args_value.rate, args_value.pipeline, args_value.iterations);
+        for(std::size_t i = 0; i < runs.size(); i++)
+        {
+            if(i != 0) { fmt::format_to(std::back_inserter(out), ","); }
+            write_run_json(out, runs[i]);
+        }
+        fmt::format_to(std::back_inserter(out), "],");
+        write_metrics_json(out, runs);
+        fmt::format_to(std::back_inserter(out), ",");
+        write_engine_json(out, last.metrics);
+        fmt::format_to(std::back_inserter(out), ",");
+        write_memory_json(out, last.memory);
+        if(!args_value.baseline.empty())
+        {
+            fmt::format_to(std::back_inserter(out), ",");
+            write_comparison_json(out, comparisons, args_value.threshold_pct);
+            fmt::format_to(std::back_inserter(out), ",\"regression\":{}", regressed);
+        }
+        fmt::format_to(std::back_inserter(out), "}}\n");
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        return regressed ? 1 : 0;
+    }
 
+    const auto& metric = last.metrics;
     fmt::print("=== BENCH TEST ===\n");
-    fmt::print("orders={} total_ms = {} throughput_mops={:.3f}\n", 
-        args_value.n_orders, total_duration_ms, throughput_mops);
-    fmt::print("latency_ns: p50={} p90={} p99={} min={} max={}\n", 
-        get_percentile(50.0), get_percentile(90.0), get_percentile(99.0), metric.add_min_ns, metric.add_max_ns);
+    fmt::print("layout={} cancel={} memory={} pages={} prewarm={}\n", layout_name, cancel_name, args_value.arena ? "arena" : "heap", page_backing_name(page_backing), args_value.prewarm);
+    fmt::print("orders={} total_ms = {:.3f} throughput_mops={:.3f}\n", 
+        args_value.n_orders, last.total_ms, last.throughput_mops);
+    fmt::print("latency_ns: p50={} p90={} p99={} p99.9={} p99.99={} min={} max={}\n", 
+        last.latency.p50, last.latency.p90, last.latency.p99, last.latency.p999, last.latency.p9999, last.latency.min, last.latency.max);
+    if(open_loop)
+    {
+        // latency above counts from the intended send time, service from the actual one
+        fmt::print("open_loop: rate={:.0f}/s pipeline={} max_behind_ns={} service_latency_ns: p50={} p90={} p99={} p99.9={} max={}\n", args_value.rate,
+            args_value.pipeline, last.max_behind_ns, last.service_latency.p50, last.service_latency.p90, last.service_latency.p99, last.service_latency.p999, last.service_latency.max);
+    }
+    fmt::print("startup_ms={:.3f} first_{}_latency_ns: p50={} p90={} p99={} max={} mean={:.1f}\n", last.startup_ms, last.first_n,
+        last.first_latency.p50, last.first_latency.p90, last.first_latency.p99, last.first_latency.max, last.first_latency.mean);
+    fmt::print("cancel_depth={} cancel_latency_ns: p50={} p90={} p99={} max={} mean={:.1f}\n", args_value.cancel_depth,
+        last.cancel_latency.p50, last.cancel_latency.p90, last.cancel_latency.p99, last.cancel_latency.max, last.cancel_latency.mean);
+    if(args_value.perf && counters == nullptr)
+    {
+        fmt::print("perf counters unavailable: {}\n", counter_group->error());
+    }
+    for(const auto& phase : last.phases) { print_phase(phase, counters != nullptr); }
+    if(runs.size() > 1)
+    {
+        fmt::print("iterations={} (median [95% CI])\n", runs.size());
+        for(const auto& tracked : tracked_metrics)
+        {
+            const auto summary = summarize(metric_samples(runs, tracked));
+            fmt::print("  {}: {:.3f} [{:.3f}, {:.3f}]\n", tracked.name, summary.median, summary.ci_low, summary.ci_high);
+        }
+    }
+    if(!comparisons.empty())
+    {
+        fmt::print("baseline={} threshold={:.1f}%\n", args_value.baseline, args_value.threshold_pct);
+        for(const auto& cmp : comparisons)
+        {
+            fmt::print("  {}: {:.3f} -> {:.3f} change={:+.2f}% {}\n", cmp.name, cmp.baseline.median, cmp.current.median, cmp.change_pct,
+                cmp.regression ? "REGRESSION" : (!cmp.conclusive ? "inconclusive" : (cmp.significant ? "significant" : "ok")));
+        }
+    }
+    const auto& memory = last.memory;
+    fmt::print("memory: levels={}/{} orders={} slots={} tombstones={} index={} buckets={} bytes: levels={} queues={} index={} total={} per_order={:.1f}\n",
+        memory.bid_levels, memory.ask_levels, memory.resting_orders, memory.queue_slots, memory.tombstones, memory.index_entries, memory.index_buckets,
+        memory.levels.bytes_in_use, memory.queues.bytes_in_use, memory.index.bytes_in_use, memory.total_bytes(), memory.bytes_per_order());
     fmt::print("best_bid: price={} qty={}\n", metric.best_bid_px, metric.best_bid_qty);
     fmt::print("best_ask: price={} qty={}\n", metric.best_ask_px, metric.best_ask_qty);
 
@@ -134,6 +529,6 @@ int main(int argc, char** argv)
     {
         fmt::print("price={} qty={}\n", ask.price, ask.qty);
     }
-    return 0;
+    return regressed ? 1 : 0;
 }
 
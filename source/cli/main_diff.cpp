@@ -0,0 +1,456 @@
+#include <libs/engine/engine.hpp>
+#include <fmt/format.h>
+#include "replay.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace engine;
+
+namespace cli_diff {
+/**
+ * @brief Command line arguments of the differential harness.
+ * 
+ */
+struct args
+{
+    std::string replay_file; /**< replay CSV to drive the engines (empty: generated workload) */
+    std::vector<std::string> engines; /**< engines to compare, the first one is the reference */
+    std::uint32_t n_orders = 200000; /**< generated commands */
+    std::uint32_t seed = 42; /**< seed of the generated workload */
+    std::uint8_t hot_levels = 5; /**< hot levels of price (±N ticks around mid price) */
+    std::uint16_t max_qty = 100; /**< maximum quantity per order */
+    price_t mid_price = 10000; /**< mid price in ticks */
+    std::uint32_t cancel_pct = 20; /**< percent of generated commands that cancel an earlier order */
+    std::uint32_t snapshot_every = 1000; /**< compare snapshots every N commands */
+    int depth = 10; /**< depth of compared snapshots */
+    std::uint32_t max_reports = 10; /**< mismatches printed before going quiet */
+};
+
+/**
+ * @brief A named engine configuration that the harness can build through make_engine.
+ * 
+ */
+struct engine_spec_t
+{
+    const char* name; /**< name used on the command line */
+    engine_config_t config; /**< configuration passed to make_engine */
+};
+
+// the ERASE engines come first, so the default run checks tombstone cancels against them
+inline const std::array<engine_spec_t, 4> engine_specs{{
+    {"aos", engine_config_t{.market_gtc_as_ioc=true, .market_max_levels=0, .level_layout=LevelLayout::AOS}},
+    {"soa", engine_config_t{.market_gtc_as_ioc=true, .market_max_levels=0, .level_layout=LevelLayout::SOA}},
+    {"tombstone", engine_config_t{.market_gtc_as_ioc=true, .market_max_levels=0, .level_layout=LevelLayout::AOS, .cancel_mode=CancelMode::TOMBSTONE}},
+    {"tombstone-soa", engine_config_t{.market_gtc_as_ioc=true, .market_max_levels=0, .level_layout=LevelLayout::SOA, .cancel_mode=CancelMode::TOMBSTONE}},
+}};
+
+auto find_spec(const std::string& name) -> const engine_spec_t*
+{
+    for(const auto& spec : engine_specs)
+    {
+        if(name == spec.name) { return &spec; }
+    }
+    return nullptr;
+}
+
+// generated flow: GTC/IOC/FOK limits around mid, some market orders, and cancels of earlier orders
+auto generate_workload(const args& args_value) -> std::vector<cli::replay_cmd_t>
+{
+    std::mt19937 rng(args_value.seed);
+    std::uniform_int_distribution<int> side_dist(0, 1);
+    std::uniform_int_distribution<int> type_dist(0, 9); // 0: MARKET, else LIMIT
+    std::uniform_int_distribution<int> time_in_force_dist(0, 2);
+    std::uniform_int_distribution<int> price_level_dist(-args_value.hot_levels, args_value.hot_levels);
+    std::uniform_int_distribution<int> qty_dist(1, args_value.max_qty);
+    std::uniform_int_distribution<std::uint32_t> pct_dist(0, 99);
+
+    std::vector<cli::replay_cmd_t> flow;
+    flow.reserve(args_value.n_orders);
+    engine::id_t next_id = 1;
+
+    for(std::uint32_t i = 0; i < args_value.n_orders; i++)
+    {
+        cli::replay_cmd_t replay_cmd{};
+        if(next_id > 1 && pct_dist(rng) < args_value.cancel_pct)
+        {
+            replay_cmd.kind = cli::replay_kind::CANCEL;
+            replay_cmd.cancel_id = std::uniform_int_distribution<engine::id_t>(1, next_id - 1)(rng);
+            flow.push_back(replay_cmd);
+            continue;
+        }
+
+        order_cmd_t& order_cmd = replay_cmd.order;
+        order_cmd.order_id = next_id++;
+        order_cmd.side = (side_dist(rng) == 0) ? Side::BUY : Side::SELL;
+        order_cmd.order_type = (type_dist(rng) == 0) ? OrderType::MARKET : OrderType::LIMIT;
+        const int tif = time_in_force_dist(rng);
+        order_cmd.time_in_force = (tif == 0) ? TimeInForce::GTC : (tif == 1) ? TimeInForce::IOC : TimeInForce::FOK;
+        if(order_cmd.order_type == OrderType::MARKET && order_cmd.time_in_force == TimeInForce::GTC)
+        {
+            order_cmd.time_in_force = TimeInForce::IOC;
+        }
+        order_cmd.price = order_cmd.order_type == OrderType::LIMIT ? args_value.mid_price + static_cast<price_t>(price_level_dist(rng)) : 0;
+        order_cmd.qty = static_cast<qty_t>(qty_dist(rng));
+        replay_cmd.kind = cli::replay_kind::ADD;
+        flow.push_back(replay_cmd);
+    }
+    return flow;
+}
+
+/**
+ * @brief The engines under comparison for one symbol, in command line order.
+ * 
+ */
+struct engine_set_t
+{
+    std::vector<std::unique_ptr<IEngine>> engines;
+};
+
+/**
+ * @brief Compares every result and periodic snapshots of the engines against the reference (first) engine.
+ * 
+ */
+class differ_t
+{
+public:
+    differ_t(const args& args_value, std::vector<const engine_spec_t*> specs) : args_(args_value), specs_(std::move(specs)) {}
+
+    void run(const std::vector<cli::replay_cmd_t>& flow)
+    {
+        for(std::size_t i = 0; i < flow.size(); i++)
+        {
+            const auto& replay_cmd = flow[i];
+            auto& set = set_for(replay_cmd.symbol);
+            step(set, replay_cmd, i);
+            if(args_.snapshot_every != 0 && (i + 1) % args_.snapshot_every == 0)
+            {
+                compare_snapshots(set, i);
+            }
+        }
+        // final state of every book
+        for(auto& [symbol, set] : sets_)
+        {
+            compare_snapshots(set, flow.size());
+            compare_metrics(set, flow.size());
+        }
+    }
+
+    std::uint64_t mismatches() const { return mismatches_; }
+    std::uint64_t results_compared() const { return results_compared_; }
+    std::uint64_t snapshots_compared() const { return snapshots_compared_; }
+
+private:
+    const args& args_;
+    std::vector<const engine_spec_t*> specs_;
+    std::map<std::uint32_t, engine_set_t> sets_;
+    std::uint64_t mismatches_ = 0;
+    std::uint64_t results_compared_ = 0;
+    std::uint64_t snapshots_compared_ = 0;
+
+    auto set_for(std::uint32_t symbol) -> engine_set_t&
+    {
+        auto [it, inserted] = sets_.try_emplace(symbol);
+        if(inserted)
+        {
+            for(const auto* spec : specs_) { it->second.engines.push_back(make_engine(spec->config)); }
+        }
+        return it->second;
+    }
+
+    // returns true if reports are still printed
+    bool report(std::size_t index, std::size_t engine_idx, const std::string& what)
+    {
+        if(++mismatches_ > args_.max_reports) { return false; }
+        fmt::print("MISMATCH cmd#{} {} vs {}: {}\n", index, specs_[engine_idx]->name, specs_[0]->name, what);
+        return true;
+    }
+
+    static std::string describe(const add_result_t& result)
+    {
+        std::string text = fmt::format("status={} order_id={} filled={} remaining={} trades=[", 
+            static_cast<int>(result.status), result.order_id, result.filled_qty, result.remaining_qty);
+        for(const auto& trade : result.trades)
+        {
+            text += fmt::format(" {}x{}@{} maker={} ts={}", trade.taker, trade.qty, trade.price, trade.maker, trade.timestamp);
+        }
+        return text + " ]";
+    }
+
+    void step(engine_set_t& set, const cli::replay_cmd_t& replay_cmd, std::size_t index)
+    {
+        switch(replay_cmd.kind)
+        {
+        case cli::replay_kind::ADD:
+        {
+            const auto reference = set.engines[0]->add_order(replay_cmd.order);
+            for(std::size_t e = 1; e < set.engines.size(); e++)
+            {
+                const auto result = set.engines[e]->add_order(replay_cmd.order);
+                if(!(result == reference))
+                {
+                    report(index, e, fmt::format("add_result\n  ref: {}\n  got: {}", describe(reference), describe(result)));
+                }
+            }
+            break;
+        }
+        case cli::replay_kind::CANCEL:
+        {
+            const bool reference = set.engines[0]->cancel_order(replay_cmd.cancel_id);
+            for(std::size_t e = 1; e < set.engines.size(); e++)
+            {
+                const bool result = set.engines[e]->cancel_order(replay_cmd.cancel_id);
+                if(result != reference)
+                {
+                    report(index, e, fmt::format("cancel {} ref={} got={}", replay_cmd.cancel_id, reference, result));
+                }
+            }
+            break;
+        }
+        case cli::replay_kind::MASS_CANCEL:
+        {
+            const auto reference = set.engines[0]->mass_cancel(replay_cmd.mass);
+            for(std::size_t e = 1; e < set.engines.size(); e++)
+            {
+                const auto result = set.engines[e]->mass_cancel(replay_cmd.mass);
+                if(!(result == reference))
+                {
+                    report(index, e, fmt::format("mass_cancel ref={}/{} got={}/{}", 
+                        reference.cancelled, reference.cancelled_qty, result.cancelled, result.cancelled_qty));
+                }
+            }
+            break;
+        }
+        case cli::replay_kind::UNCROSS:
+        case cli::replay_kind::SET_MODE:
+        {
+            auto run = [&](IEngine& eng) {
+                return replay_cmd.kind == cli::replay_kind::UNCROSS ? eng.uncross() : eng.set_matching_mode(replay_cmd.mode);
+            };
+            const auto reference = run(*set.engines[0]);
+            for(std::size_t e = 1; e < set.engines.size(); e++)
+            {
+                const auto result = run(*set.engines[e]);
+                if(!(result == reference))
+                {
+                    report(index, e, fmt::format("uncross ref={}x{}/{} trades got={}x{}/{} trades", 
+                        reference.volume, reference.price, reference.trades.size(), result.volume, result.price, result.trades.size()));
+                }
+            }
+            break;
+        }
+        case cli::replay_kind::STOP:
+            return;
+        }
+        results_compared_++;
+    }
+
+    void compare_snapshots(engine_set_t& set, std::size_t index)
+    {
+        const auto reference = set.engines[0]->snapshot(args_.depth);
+        for(std::size_t e = 1; e < set.engines.size(); e++)
+        {
+            const auto snap = set.engines[e]->snapshot(args_.depth);
+            if(snap.bids != reference.bids || snap.asks != reference.asks)
+            {
+                report(index, e, fmt::format("snapshot differs (bids {} vs {}, asks {} vs {} levels)", 
+                    snap.bids.size(), reference.bids.size(), snap.asks.size(), reference.asks.size()));
+            }
+        }
+        snapshots_compared_++;
+    }
+
+    void compare_metrics(engine_set_t& set, std::size_t index)
+    {
+        const auto reference = set.engines[0]->metrics();
+        for(std::size_t e = 1; e < set.engines.size(); e++)
+        {
+            const auto metric = set.engines[e]->metrics();
+            if(metric.add_orders != reference.add_orders || metric.cancel_orders != reference.cancel_orders ||
+               metric.trades != reference.trades || metric.traded_qty != reference.traded_qty)
+            {
+                report(index, e, fmt::format("metrics differ (trades {} vs {}, traded_qty {} vs {})", 
+                    metric.trades, reference.trades, metric.traded_qty, reference.traded_qty));
+            }
+        }
+    }
+};
+
+/**
+ * @brief Throughput and latency percentiles of one engine over the whole command stream.
+ * 
+ */
+struct perf_t
+{
+    std::uint64_t total_ns = 0; /**< wall time of the whole replay */
+    std::vector<std::uint64_t> latencies_ns; /**< per command latency, sorted */
+
+    std::uint64_t percentile(double percent) const
+    {
+        if(latencies_ns.empty()) { return 0; }
+        const auto idx = static_cast<std::size_t>((percent / 100.0) * static_cast<double>(latencies_ns.size() - 1));
+        return latencies_ns[idx];
+    }
+};
+
+// replay the stream alone on fresh engines of one spec, timing every call
+auto measure(const engine_spec_t& spec, const std::vector<cli::replay_cmd_t>& flow) -> perf_t
+{
+    using clock = std::chrono::steady_clock;
+    std::map<std::uint32_t, std::unique_ptr<IEngine>> engines;
+    perf_t perf;
+    perf.latencies_ns.reserve(flow.size());
+
+    const auto t_start = clock::now();
+    for(const auto& replay_cmd : flow)
+    {
+        auto& eng = engines[replay_cmd.symbol];
+        if(!eng) { eng = make_engine(spec.config); }
+
+        const auto t_cmd_start = clock::now();
+        switch(replay_cmd.kind)
+        {
+        case cli::replay_kind::ADD: eng->add_order(replay_cmd.order); break;
+        case cli::replay_kind::CANCEL: eng->cancel_order(replay_cmd.cancel_id); break;
+        case cli::replay_kind::MASS_CANCEL: eng->mass_cancel(replay_cmd.mass); break;
+        case cli::replay_kind::UNCROSS: eng->uncross(); break;
+        case cli::replay_kind::SET_MODE: eng->set_matching_mode(replay_cmd.mode); break;
+        case cli::replay_kind::STOP: break;
+        }
+        const auto t_cmd_end = clock::now();
+        perf.latencies_ns.push_back(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t_cmd_end - t_cmd_start).count()));
+    }
+    perf.total_ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - t_start).count());
+    std::sort(perf.latencies_ns.begin(), perf.latencies_ns.end());
+    return perf;
+}
+}; //namespace cli_diff
+
+using namespace cli_diff;
+
+int main(int argc, char** argv)
+{
+    args args_value{};
+
+    // parse arguments
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if(arg == "--replay" && ( i + 1 < argc ))
+        {
+            args_value.replay_file = argv[++i];
+        }
+        else if(arg == "--engine" && ( i + 1 < argc ))
+        {
+            args_value.engines.emplace_back(argv[++i]);
+        }
+        else if(arg == "--n-orders" && ( i + 1 < argc ))
+        {
+            args_value.n_orders = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+        }
+        else if(arg == "--seed" && ( i + 1 < argc ))
+        {
+            args_value.seed = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+        }
+        else if(arg == "--hot-levels" && ( i + 1 < argc ))
+        {
+            args_value.hot_levels = static_cast<std::uint8_t>(std::stoul(argv[++i]));
+        }
+        else if(arg == "--max-qty" && ( i + 1 < argc ))
+        {
+            args_value.max_qty = static_cast<std::uint16_t>(std::stoul(argv[++i]));
+        }
+        else if(arg == "--cancel-pct" && ( i + 1 < argc ))
+        {
+            args_value.cancel_pct = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+        }
+        else if(arg == "--snapshot-every" && ( i + 1 < argc ))
+        {
+            args_value.snapshot_every = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+        }
+        else if(arg == "--depth" && ( i + 1 < argc ))
+        {
+            args_value.depth = std::stoi(argv[++i]);
+        }
+        else if(arg == "-h" || arg == "--help")
+        {
+            fmt::print("Usage: scopeX_diff [--replay <file> | --n-orders <n> --seed <n> --cancel-pct <n>] --engine <name> --engine <name> [...]\n");
+            fmt::print("engines:");
+            for(const auto& spec : engine_specs) { fmt::print(" {}", spec.name); }
+            fmt::print("\n");
+            return 0;
+        }
+    }
+
+    if(args_value.engines.empty())
+    {
+        for(const auto& spec : engine_specs) { args_value.engines.emplace_back(spec.name); }
+    }
+    std::vector<const engine_spec_t*> specs;
+    for(const auto& name : args_value.engines)
+    {
+        const auto* spec = find_spec(name);
+        if(spec == nullptr)
+        {
+            fmt::print(stderr, "Error: unknown engine {}\n", name);
+            return 2;
+        }
+        specs.push_back(spec);
+    }
+    if(specs.size() < 2)
+    {
+        fmt::print(stderr, "Error: at least two engines are needed\n");
+        return 2;
+    }
+
+    // ----- command stream -----
+    std::vector<cli::replay_cmd_t> flow;
+    if(!args_value.replay_file.empty())
+    {
+        std::ifstream infile(args_value.replay_file);
+        if(!infile.is_open())
+        {
+            fmt::print(stderr, "Error: cannot open replay file {}\n", args_value.replay_file);
+            return 2;
+        }
+        cli::symbol_table_t symbols;
+        const int exit_code = cli::for_each_replay_cmd(infile, symbols, [&](const cli::replay_cmd_t& replay_cmd) { flow.push_back(replay_cmd); });
+        if(exit_code != 0) { return exit_code; }
+    }
+    else
+    {
+        flow = generate_workload(args_value);
+    }
+
+    // ----- equivalence -----
+    differ_t differ(args_value, specs);
+    differ.run(flow);
+
+    fmt::print("=== DIFF TEST ===\n");
+    fmt::print("commands={} results_compared={} snapshots_compared={} mismatches={}\n", 
+        flow.size(), differ.results_compared(), differ.snapshots_compared(), differ.mismatches());
+
+    // ----- performance, each engine alone on the same stream -----
+    fmt::print("{:<13} {:>10} {:>10} {:>8} {:>8} {:>8} {:>8} {:>10} {:>8}\n", 
+        "engine", "total_ms", "mops", "p50", "p90", "p99", "p99.9", "max", "speedup");
+    double reference_ns = 0.0;
+    for(const auto* spec : specs)
+    {
+        const auto perf = measure(*spec, flow);
+        const double total_ns = static_cast<double>(perf.total_ns);
+        if(reference_ns <= 0.0) { reference_ns = total_ns; } // the first engine is the reference
+        fmt::print("{:<13} {:>10.1f} {:>10.3f} {:>8} {:>8} {:>8} {:>8} {:>10} {:>7.2f}x\n", 
+            spec->name, total_ns / 1e6, static_cast<double>(flow.size()) / (total_ns / 1e3),
+            perf.percentile(50.0), perf.percentile(90.0), perf.percentile(99.0), perf.percentile(99.9),
+            perf.latencies_ns.empty() ? 0 : perf.latencies_ns.back(), reference_ns / total_ns);
+    }
+
+    return differ.mismatches() == 0 ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Open-loop load shared by scopeX_bench and scopeX_cli: commands are released on a schedule that does not wait
+// for the engine, and latency is taken from the intended release time, so time spent queueing behind a slow
+// command is counted instead of hidden (no coordinated omission).
+namespace cli {
+
+    using load_clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Poisson arrivals: intended release times in ns after the start, with exponential gaps of mean 1 / rate_per_s.
+     *
+     */
+    struct poisson_arrivals_t {
+        std::mt19937_64 rng;
+        std::exponential_distribution<double> gap_s;
+        double offset_ns = 0.0;
+
+        poisson_arrivals_t(double rate_per_s, std::uint32_t seed) : rng(seed), gap_s(rate_per_s) {}
+
+        auto due_ns() -> std::uint64_t
+        {
+            const auto due = static_cast<std::uint64_t>(offset_ns);
+            offset_ns += gap_s(rng) * 1e9;
+            return due;
+        }
+    };
+
+    inline auto poisson_schedule(std::size_t count, double rate_per_s, std::uint32_t seed) -> std::vector<std::uint64_t>
+    {
+        std::vector<std::uint64_t> schedule;
+        schedule.reserve(count);
+        poisson_arrivals_t arrivals(rate_per_s, seed);
+        for(std::size_t i = 0; i < count; i++) { schedule.push_back(arrivals.due_ns()); }
+        return schedule;
+    }
+
+    /**
+     * @brief Release times from recorded timestamps: the first timestamp is the start, a speed of 2 replays twice as fast. Timestamps that go backwards release at once.
+     *
+     */
+    struct timestamp_schedule_t {
+        double ns_per_unit = 1000.0;   /**< timestamp unit, microseconds by default */
+        double speed = 1.0;            /**< replay speed multiplier */
+        bool started = false;
+        std::uint64_t first = 0;
+        std::uint64_t last_due_ns = 0;
+
+        auto due_ns(std::uint64_t timestamp) -> std::uint64_t
+        {
+            if(!started) { started = true; first = timestamp; }
+            if(timestamp < first) { return last_due_ns; }
+            last_due_ns = std::max(last_due_ns, static_cast<std::uint64_t>(static_cast<double>(timestamp - first) * ns_per_unit / speed));
+            return last_due_ns;
+        }
+    };
+
+    /**
+     * @brief Releases commands at their intended times and records how long each took from that time (latency) and from its actual release (service). A pacer that falls behind releases at once and the wait shows up in latency.
+     *
+     */
+    class open_loop_pacer_t {
+    public:
+        open_loop_pacer_t() : start_(load_clock::now()) {}
+
+        // spin until due_ns after the start; the returned intended time is what latency counts from
+        auto wait(std::uint64_t due_ns) const -> load_clock::time_point
+        {
+            const auto due = start_ + std::chrono::nanoseconds(due_ns);
+            while(load_clock::now() < due) { std::this_thread::yield(); }
+            return due;
+        }
+
+        auto intended(std::uint64_t due_ns) const -> load_clock::time_point { return start_ + std::chrono::nanoseconds(due_ns); }
+        auto start() const -> load_clock::time_point { return start_; }
+
+    private:
+        load_clock::time_point start_;
+    };
+
+    /**
+     * @brief Open-loop timings of one stream of commands.
+     *
+     */
+    struct open_loop_samples_t {
+        std::vector<std::uint64_t> latency_ns;  /**< completion - intended release */
+        std::vector<std::uint64_t> service_ns;  /**< completion - actual release */
+        std::uint64_t max_behind_ns = 0;        /**< largest delay of a release behind its schedule */
+
+        void record(load_clock::time_point intended, load_clock::time_point released, load_clock::time_point done)
+        {
+            latency_ns.push_back(elapsed_ns(intended, done));
+            service_ns.push_back(elapsed_ns(released, done));
+            max_behind_ns = std::max(max_behind_ns, elapsed_ns(intended, released));
+        }
+
+        void merge(const open_loop_samples_t& other)
+        {
+            latency_ns.insert(latency_ns.end(), other.latency_ns.begin(), other.latency_ns.end());
+            service_ns.insert(service_ns.end(), other.service_ns.begin(), other.service_ns.end());
+            max_behind_ns = std::max(max_behind_ns, other.max_behind_ns);
+        }
+
+        static auto elapsed_ns(load_clock::time_point from, load_clock::time_point to) -> std::uint64_t
+        {
+            return to <= from ? 0 : static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+        }
+    };
+
+    // nearest-rank percentile of sorted samples
+    inline auto percentile_of_sorted(const std::vector<std::uint64_t>& sorted, double percent) -> std::uint64_t
+    {
+        if(sorted.empty()) { return 0; }
+        return sorted[static_cast<std::size_t>((percent / 100.0) * static_cast<double>(sorted.size() - 1))];
+    }
+}; // namespace cli
@@ -0,0 +1,260 @@
+#pragma once
+#include <libs/engine/engine.hpp>
+#include <fmt/format.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <string>
+
+// Machine-readable replay output (--out) shared by the replay threads
+namespace cli {
+    using namespace engine;
+
+    /**
+     * @brief Encoding of the --out file.
+     *
+     */
+    enum class out_format: uint8_t {
+        CSV,    /**< one compact text line per record */
+        BINARY  /**< fixed-size out_record_t records after an out_file_header_t */
+    };
+
+    /**
+     * @brief Kind of an output record; also the first CSV field (R, T, F, C, M, U, S, Y).
+     *
+     */
+    enum class record_kind: uint8_t {
+        RESULT = 'R',       /**< add_order result: id, flag=status, qty=filled, aux=remaining */
+        TRADE = 'T',        /**< execution: id=taker, other=maker, price, qty, aux=timestamp */
+        LEVEL_FILL = 'F',   /**< executions of a taker at one price level (--fill-report levels|both): id=taker, other=makers, price, qty */
+        CANCEL = 'C',       /**< cancel: id, flag=1 if found */
+        MASS_CANCEL = 'M',  /**< mass cancel: other=cancelled orders, qty=cancelled qty */
+        UNCROSS = 'U',      /**< auction uncross: price=clearing price, qty=volume, aux=imbalance; its trades follow */
+        LEVEL = 'S',        /**< final snapshot level: flag=side, level, price, qty */
+        SYMBOL = 'Y'        /**< symbol index to name mapping, written last; binary: name in the payload */
+    };
+
+    /**
+     * @brief Fixed 48-byte binary record. Fields are reused per record_kind as documented there.
+     *
+     */
+    struct out_record_t {
+        uint8_t kind = 0;       /**< record_kind */
+        uint8_t flag = 0;       /**< status / side / found flag */
+        uint16_t level = 0;     /**< snapshot level index */
+        uint32_t symbol = 0;    /**< interned symbol index */
+        uint64_t id = 0;        /**< order id or taker id */
+        uint64_t other = 0;     /**< maker id, maker count or cancelled count */
+        int64_t price = 0;      /**< price in ticks */
+        int64_t qty = 0;        /**< quantity */
+        int64_t aux = 0;        /**< remaining qty or timestamp */
+    };
+    static_assert(sizeof(out_record_t) == 48, "binary record layout is part of the file format");
+
+    /**
+     * @brief Header of a binary --out file.
+     *
+     */
+    struct out_file_header_t {
+        char magic[4] = {'S', 'X', 'O', 'R'};   /**< file magic */
+        uint16_t version = 1;                   /**< format version */
+        uint16_t record_size = sizeof(out_record_t); /**< size of every following record */
+    };
+
+    /**
+     * @brief The --out file shared by all writers; whole buffers are appended under the lock so records never interleave.
+     *
+     */
+    class out_file_t {
+    public:
+        out_file_t(const std::string& path, out_format format) : file_(std::fopen(path.c_str(), "wb")), format_(format)
+        {
+            if(file_ == nullptr) { return; }
+            if(format_ == out_format::BINARY)
+            {
+                const out_file_header_t header{};
+                std::fwrite(&header, sizeof(header), 1, file_);
+            }
+            else
+            {
+                std::fputs("# R,symbol,order_id,status,filled_qty,remaining_qty | T,symbol,taker,maker,price,qty,timestamp | F,symbol,taker,makers,price,qty"
+                           " | C,symbol,order_id,found | M,symbol,cancelled,cancelled_qty | U,symbol,price,volume,imbalance | S,symbol,side,level,price,qty | Y,symbol,name\n", file_);
+            }
+        }
+        ~out_file_t() { if(file_ != nullptr) { std::fclose(file_); } }
+
+        out_file_t(const out_file_t&) = delete;
+        out_file_t& operator=(const out_file_t&) = delete;
+
+        bool is_open() const noexcept { return file_ != nullptr; }
+        out_format format() const noexcept { return format_; }
+
+        void append(const char* data, std::size_t size)
+        {
+            const std::lock_guard<std::mutex> guard(lock_);
+            std::fwrite(data, 1, size, file_);
+        }
+
+    private:
+        std::FILE* file_;
+        out_format format_;
+        std::mutex lock_;
+    };
+
+    /**
+     * @brief Per-thread buffered record writer. Records are encoded into a large in-memory buffer and handed to the file in big chunks, so replay speed is bounded by matching and not by formatting or I/O.
+     *
+     */
+    class result_writer_t {
+    public:
+        static constexpr std::size_t flush_bytes = 1U << 20;
+
+        explicit result_writer_t(out_file_t& file) : file_(file) {}
+        ~result_writer_t() { flush(); }
+
+        result_writer_t(const result_writer_t&) = delete;
+        result_writer_t& operator=(const result_writer_t&) = delete;
+
+        void result(uint32_t symbol, const add_result_t& order_result)
+        {
+            if(file_.format() == out_format::CSV)
+            {
+                fmt::format_to(std::back_inserter(buffer_), "R,{},{},{},{},{}\n", symbol, order_result.order_id,
+                    static_cast<int>(order_result.status), order_result.filled_qty, order_result.remaining_qty);
+            }
+            else
+            {
+                put(out_record_t{.kind=static_cast<uint8_t>(record_kind::RESULT), .flag=static_cast<uint8_t>(order_result.status), .symbol=symbol,
+                    .id=order_result.order_id, .qty=order_result.filled_qty, .aux=order_result.remaining_qty});
+            }
+            for(const auto& trade : order_result.trades) { this->trade(symbol, trade); }
+            for(const auto& level : order_result.level_fills) { level_fill(symbol, order_result.order_id, level); }
+            maybe_flush();
+        }
+
+        void cancel(uint32_t symbol, engine::id_t order_id, bool found)
+        {
+            if(file_.format() == out_format::CSV)
+            {
+                fmt::format_to(std::back_inserter(buffer_), "C,{},{},{}\n", symbol, order_id, found ? 1 : 0);
+            }
+            else
+            {
+                put(out_record_t{.kind=static_cast<uint8_t>(record_kind::CANCEL), .flag=static_cast<uint8_t>(found), .symbol=symbol, .id=order_id});
+            }
+            maybe_flush();
+        }
+
+        void mass_cancel(uint32_t symbol, const mass_cancel_result_t& mass_result)
+        {
+            if(file_.format() == out_format::CSV)
+            {
+                fmt::format_to(std::back_inserter(buffer_), "M,{},{},{}\n", symbol, mass_result.cancelled, mass_result.cancelled_qty);
+            }
+            else
+            {
+                put(out_record_t{.kind=static_cast<uint8_t>(record_kind::MASS_CANCEL), .symbol=symbol, .other=mass_result.cancelled, .qty=mass_result.cancelled_qty});
+            }
+            maybe_flush();
+        }
+
+        void uncross(uint32_t symbol, const uncross_result_t& uncross_result)
+        {
+            if(file_.format() == out_format::CSV)
+            {
+                fmt::format_to(std::back_inserter(buffer_), "U,{},{},{},{}\n", symbol, uncross_result.price, uncross_result.volume, uncross_result.imbalance);
+            }
+            else
+            {
+                put(out_record_t{.kind=static_cast<uint8_t>(record_kind::UNCROSS), .symbol=symbol, .price=uncross_result.price,
+                    .qty=uncross_result.volume, .aux=uncross_result.imbalance});
+            }
+            for(const auto& trade : uncross_result.trades) { this->trade(symbol, trade); }
+            maybe_flush();
+        }
+
+        void level(uint32_t symbol, Side side, uint16_t level_idx, const snapshot_level_t& snap_level)
+        {
+            if(file_.format() == out_format::CSV)
+            {
+                fmt::format_to(std::back_inserter(buffer_), "S,{},{},{},{},{}\n", symbol, side == Side::BUY ? "BUY" : "SELL",
+                    level_idx, snap_level.price, snap_level.qty);
+            }
+            else
+            {
+                put(out_record_t{.kind=static_cast<uint8_t>(record_kind::LEVEL), .flag=static_cast<uint8_t>(side), .level=level_idx,
+                    .symbol=symbol, .price=snap_level.price, .qty=snap_level.qty});
+            }
+            maybe_flush();
+        }
+
+        // binary: the name (truncated to 39 bytes) is stored in the payload after symbol
+        void symbol_name(uint32_t symbol, const std::string& name)
+        {
+            if(file_.format() == out_format::CSV)
+            {
+                fmt::format_to(std::back_inserter(buffer_), "Y,{},{}\n", symbol, name);
+            }
+            else
+            {
+                out_record_t record{.kind=static_cast<uint8_t>(record_kind::SYMBOL), .symbol=symbol};
+                constexpr std::size_t payload = sizeof(out_record_t) - offsetof(out_record_t, id);
+                std::memcpy(reinterpret_cast<char*>(&record) + offsetof(out_record_t, id), name.data(), std::min(name.size(), payload - 1));
+                put(record);
+            }
+            maybe_flush();
+        }
+
+        void flush()
+        {
+            if(buffer_.size() == 0) { return; }
+            file_.append(buffer_.data(), buffer_.size());
+            buffer_.clear();
+        }
+
+    private:
+        out_file_t& file_;
+        fmt::memory_buffer buffer_;
+
+        void trade(uint32_t symbol, const trade_t& trade)
+        {
+            if(file_.format() == out_format::CSV)
+            {
+                fmt::format_to(std::back_inserter(buffer_), "T,{},{},{},{},{},{}\n", symbol, trade.taker, trade.maker, trade.price, trade.qty, trade.timestamp);
+            }
+            else
+            {
+                put(out_record_t{.kind=static_cast<uint8_t>(record_kind::TRADE), .symbol=symbol, .id=trade.taker, .other=trade.maker,
+                    .price=trade.price, .qty=trade.qty, .aux=static_cast<int64_t>(trade.timestamp)});
+            }
+        }
+
+        void level_fill(uint32_t symbol, engine::id_t taker, const level_fill_t& level)
+        {
+            if(file_.format() == out_format::CSV)
+            {
+                fmt::format_to(std::back_inserter(buffer_), "F,{},{},{},{},{}\n", symbol, taker, level.makers, level.price, level.qty);
+            }
+            else
+            {
+                put(out_record_t{.kind=static_cast<uint8_t>(record_kind::LEVEL_FILL), .symbol=symbol, .id=taker, .other=level.makers,
+                    .price=level.price, .qty=level.qty});
+            }
+        }
+
+        void put(const out_record_t& record)
+        {
+            const auto* bytes = reinterpret_cast<const char*>(&record);
+            buffer_.append(bytes, bytes + sizeof(record));
+        }
+
+        void maybe_flush()
+        {
+            if(buffer_.size() >= flush_bytes) { flush(); }
+        }
+    };
+}; // namespace cli
@@ -0,0 +1,151 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// Hardware performance counters for scopeX_bench (Linux perf_event_open)
+namespace cli_bench {
+
+/**
+ * @brief Counters measured by perf_counter_group_t, in report order.
+ *
+ */
+enum class perf_counter: uint8_t {
+    CYCLES = 0,     /**< CPU cycles */
+    INSTRUCTIONS,   /**< retired instructions */
+    L1D_MISSES,     /**< L1 data cache read misses */
+    LLC_MISSES,     /**< last level cache misses */
+    BRANCH_MISSES,  /**< mispredicted branches */
+    DTLB_MISSES,    /**< data TLB read misses */
+    COUNT           /**< number of counters */
+};
+
+inline constexpr std::array<const char*, static_cast<std::size_t>(perf_counter::COUNT)> perf_counter_names{
+    "cycles", "instructions", "l1d_miss", "llc_miss", "branch_miss", "dtlb_miss"};
+
+/**
+ * @brief Counter values of one measured region; a counter that could not be opened is marked invalid. Values are scaled when the kernel multiplexed the counters.
+ *
+ */
+struct perf_sample_t {
+    std::array<std::uint64_t, static_cast<std::size_t>(perf_counter::COUNT)> values{}; /**< counter values */
+    std::array<bool, static_cast<std::size_t>(perf_counter::COUNT)> valid{};            /**< counter was measured */
+
+    bool any_valid() const
+    {
+        for(bool is_valid : valid) { if(is_valid) { return true; } }
+        return false;
+    }
+};
+
+/**
+ * @brief A perf_event_open counter group for the calling thread (user space only). Counters that the kernel, the CPU or the container does not provide are skipped; if none can be opened the group reports itself unavailable and measuring is a no-op.
+ *
+ */
+class perf_counter_group_t {
+public:
+    perf_counter_group_t()
+    {
+#if defined(__linux__)
+        fds_.fill(-1);
+        for(std::size_t i = 0; i < fds_.size(); i++)
+        {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            if(leader_ < 0) { attr.disabled = 1; } // the leader starts and stops the whole group
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            set_event(static_cast<perf_counter>(i), attr);
+
+            const long fd = syscall(SYS_perf_event_open, &attr, 0, -1, leader_, 0);
+            if(fd < 0)
+            {
+                if(error_.empty()) { error_ = std::string(perf_counter_names[i]) + ": " + std::strerror(errno); }
+                continue;
+            }
+            fds_[i] = static_cast<int>(fd);
+            if(leader_ < 0) { leader_ = fds_[i]; }
+        }
+#else
+        error_ = "perf_event_open is only available on Linux";
+#endif
+    }
+
+    ~perf_counter_group_t()
+    {
+#if defined(__linux__)
+        for(int fd : fds_) { if(fd >= 0) { close(fd); } }
+#endif
+    }
+
+    perf_counter_group_t(const perf_counter_group_t&) = delete;
+    perf_counter_group_t& operator=(const perf_counter_group_t&) = delete;
+
+    bool available() const noexcept { return leader_ >= 0; }
+    const std::string& error() const noexcept { return error_; } ///< first reason a counter could not be opened
+
+    void start()
+    {
+#if defined(__linux__)
+        if(!available()) { return; }
+        ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    auto stop() -> perf_sample_t
+    {
+        perf_sample_t sample;
+#if defined(__linux__)
+        if(!available()) { return sample; }
+        ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        for(std::size_t i = 0; i < fds_.size(); i++)
+        {
+            if(fds_[i] < 0) { continue; }
+            std::array<std::uint64_t, 3> data{}; // value, time_enabled, time_running
+            if(read(fds_[i], data.data(), sizeof(data)) != static_cast<ssize_t>(sizeof(data)) || data[2] == 0) { continue; }
+            // scale up when the kernel multiplexed the counter
+            const double scale = static_cast<double>(data[1]) / static_cast<double>(data[2]);
+            sample.values[i] = static_cast<std::uint64_t>(static_cast<double>(data[0]) * scale);
+            sample.valid[i] = true;
+        }
+#endif
+        return sample;
+    }
+
+private:
+    std::array<int, static_cast<std::size_t>(perf_counter::COUNT)> fds_{};
+    int leader_ = -1;
+    std::string error_;
+
+#if defined(__linux__)
+    static void set_event(perf_counter counter, perf_event_attr& attr)
+    {
+        auto cache_read_miss = [](std::uint64_t cache) {
+            return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8U) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16U);
+        };
+        switch(counter)
+        {
+        case perf_counter::CYCLES: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+        case perf_counter::INSTRUCTIONS: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+        case perf_counter::L1D_MISSES: attr.type = PERF_TYPE_HW_CACHE; attr.config = cache_read_miss(PERF_COUNT_HW_CACHE_L1D); break;
+        case perf_counter::LLC_MISSES: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+        case perf_counter::BRANCH_MISSES: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+        case perf_counter::DTLB_MISSES: attr.type = PERF_TYPE_HW_CACHE; attr.config = cache_read_miss(PERF_COUNT_HW_CACHE_DTLB); break;
+        case perf_counter::COUNT: break;
+        }
+    }
+#endif
+};
+
+} // namespace cli_bench
@@ -0,0 +1,302 @@
+#pragma once
+#include <libs/engine/engine.hpp>
+#include <libs/engine/trace.hpp>
+#include <fmt/format.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <istream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Replay CSV decoding shared by scopeX_cli and scopeX_diff
+namespace cli {
+    using namespace engine;
+
+    /**
+     * @brief Enum class representing the columns in the CSV file for order book replay.
+     * 
+     */
+    enum class csv_columns: uint8_t {
+        TIMESTAMP = 0,   /**< Timestamp of the order */
+        CMD,             /**< Command type (e.g., NEW, CANCEL) */
+        SIDE,            /**< Side of the order (e.g., BUY, SELL) */
+        ORDER_TYPE,      /**< Type of the order (e.g., LIMIT, MARKET) */
+        TIME_IN_FORCE,   /**< Time in force for the order (e.g., GTC, IOC, GTD) */
+        PRICE,           /**< Price of the order */
+        QTY,             /**< Quantity of the order */
+        ORDER_ID,        /**< Unique identifier for the order */
+        OWNER,           /**< Optional client/owner tag of the order */
+        SYMBOL,          /**< Optional instrument of the order, one book per symbol */
+        EXPIRE_AT,       /**< Expiry of a GTD order, in engine time (see --clock) */
+        // total columns count
+        COUNT            /**< Total number of columns */
+    }; 
+
+    /**
+     * @brief Case-insensitive string comparison.
+     * 
+     * @param str_a First string to compare.
+     * @param str_b Second string to compare.
+     * @return true If the strings are equal (case-insensitive).
+     * @return false If the strings are not equal.
+     */
+    auto inline ieq(const std::string& str_a, const std::string& str_b) -> bool
+    {
+        if(str_a.size() != str_b.size()) { return false; }
+        for(size_t i = 0; i < str_a.size(); i++)
+        {
+            if(std::tolower(static_cast<unsigned char>(str_a[i])) != std::tolower(static_cast<unsigned char>(str_b[i])))
+            { return false; }
+        }
+        return true;
+    };
+
+    // remove head and tail spaces
+    inline auto trim(std::string str) -> std::string
+    {
+        auto isspace2 = [](unsigned char chara){return std::isspace(chara);};
+        while(!str.empty() && (isspace2(static_cast<unsigned char>(str.front())) != 0)) {str.erase(str.begin());}
+        while(!str.empty() && (isspace2(static_cast<unsigned char>(str.back())) != 0)) {str.pop_back();}
+        return str;
+    }
+
+    inline auto split_csv_line(const std::string& line) -> std::vector<std::string>
+    {
+        // for simple CSV without quoted fields
+        std::vector<std::string> result;
+        std::stringstream s_stream(line);
+        std::string cell;
+        while(std::getline(s_stream, cell, ',')) {
+            // remove head/tail spaces for each cell
+            result.push_back(trim(cell));
+        }
+        return result; 
+    }
+
+    /**
+     * @brief Kind of a decoded replay line.
+     * 
+     */
+    enum class replay_kind: uint8_t {
+        ADD,            /**< new order */
+        CANCEL,         /**< cancel one order by id */
+        MASS_CANCEL,    /**< bulk cancel */
+        UNCROSS,        /**< batch auction uncross */
+        SET_MODE,       /**< switch between continuous matching and auction collection */
+        STOP            /**< end of stream marker for replay workers */
+    };
+
+    /**
+     * @brief A decoded replay line, routed by symbol to the book that replays it.
+     * 
+     */
+    struct replay_cmd_t {
+        replay_kind kind = replay_kind::STOP;   /**< command kind */
+        uint32_t symbol = 0;                    /**< interned symbol index */
+        order_cmd_t order{};                    /**< ADD payload */
+        engine::id_t cancel_id = 0;             /**< CANCEL payload */
+        mass_cancel_cmd_t mass{};               /**< MASS_CANCEL payload */
+        MatchingMode mode = MatchingMode::CONTINUOUS; /**< SET_MODE payload */
+        uint64_t timestamp = 0;                 /**< TIMESTAMP column, 0 when not numeric */
+        uint64_t due_ns = 0;                    /**< open-loop replay: intended release, ns after the replay start */
+        trace_t trace{};                        /**< --trace: stage stamps of an ADD, from decoding to matching */
+    };
+
+    /**
+     * @brief Interns symbol names to dense indices; index 0 is the default (empty) symbol.
+     * 
+     */
+    struct symbol_table_t {
+        std::vector<std::string> names{""};
+        std::unordered_map<std::string, uint32_t> ids{{"", 0}};
+
+        auto intern(const std::string& name) -> uint32_t
+        {
+            auto [it, inserted] = ids.try_emplace(name, static_cast<uint32_t>(names.size()));
+            if(inserted) { names.push_back(name); }
+            return it->second;
+        }
+    };
+
+    inline auto cell_at(const std::vector<std::string>& cells, csv_columns col) -> std::string
+    {
+        return cells.size() > static_cast<size_t>(col) ? cells[static_cast<size_t>(col)] : std::string{};
+    }
+
+    // decode one data line, warnings go to stderr and return nullopt
+    inline auto parse_line(const std::vector<std::string>& cells, const std::string& line, symbol_table_t& symbols) -> std::optional<replay_cmd_t>
+    {
+        replay_cmd_t replay_cmd{};
+        replay_cmd.symbol = symbols.intern(cell_at(cells, csv_columns::SYMBOL));
+
+        // timestamp paces open-loop replay and feeds ClockSource::CALLER, a non-numeric value is kept as 0
+        const std::string ts_str = cell_at(cells, csv_columns::TIMESTAMP);
+        if(!ts_str.empty() && std::all_of(ts_str.begin(), ts_str.end(), [](unsigned char chara){ return std::isdigit(chara) != 0; }))
+        {
+            replay_cmd.timestamp = static_cast<uint64_t>(std::stoull(ts_str));
+        }
+
+        // cmd column
+        const std::string cmd = cell_at(cells, csv_columns::CMD);
+
+        // timestamp,cmd[,...,symbol]: UNCROSS executes the auction, AUCTION starts collecting, CONTINUOUS uncrosses and resumes matching
+        if (ieq(cmd, "UNCROSS"))
+        {
+            replay_cmd.kind = replay_kind::UNCROSS;
+            return replay_cmd;
+        }
+        if (ieq(cmd, "AUCTION") || ieq(cmd, "CONTINUOUS"))
+        {
+            replay_cmd.kind = replay_kind::SET_MODE;
+            replay_cmd.mode = ieq(cmd, "AUCTION") ? MatchingMode::AUCTION : MatchingMode::CONTINUOUS;
+            return replay_cmd;
+        }
+
+        if(cells.size() < 3)
+        {
+            fmt::print(stderr, "Warning: invalid line (too few columns): {}\n", line);
+            return std::nullopt;
+        }
+
+        if(ieq(cmd, "ADD"))
+        {
+            // timestamp,cmd,side,order_type,time_in_force,price,qty[,order_id[,owner[,symbol[,expire_at]]]], at least 7 columns
+            if(cells.size() < static_cast<size_t>(csv_columns::ORDER_ID))
+            {
+                fmt::print(stderr, "Warning: invalid ADD line (too few columns): {}\n", line);
+                return std::nullopt;
+            }
+
+            const std::string& side_str = cells[static_cast<size_t>(csv_columns::SIDE)];
+            const std::string& order_type_str = cells[static_cast<size_t>(csv_columns::ORDER_TYPE)];
+            const std::string& tif_str = cells[static_cast<size_t>(csv_columns::TIME_IN_FORCE)];
+            const std::string& price_str = cells[static_cast<size_t>(csv_columns::PRICE)];
+            const std::string& qty_str = cells[static_cast<size_t>(csv_columns::QTY)];
+            const std::string order_id_str = cell_at(cells, csv_columns::ORDER_ID);
+            const std::string owner_str = cell_at(cells, csv_columns::OWNER);
+            const std::string expire_str = cell_at(cells, csv_columns::EXPIRE_AT);
+
+            order_cmd_t& order_cmd = replay_cmd.order;
+            order_cmd.side = ieq(side_str, "BUY") ? Side::BUY : (Side::SELL);
+            order_cmd.order_type =  ieq(order_type_str, "LIMIT") ? OrderType::LIMIT : OrderType::MARKET;
+            order_cmd.time_in_force = ieq(tif_str, "IOC") ? TimeInForce::IOC : (ieq(tif_str, "FOK") ? TimeInForce::FOK : 
+                                      (ieq(tif_str, "GTD") ? TimeInForce::GTD : TimeInForce::GTC));
+
+            order_cmd.price = price_str.empty() ? 0 : static_cast<price_t>(std::stoll(price_str));
+            order_cmd.qty = static_cast<qty_t>(std::stoll(qty_str));
+            order_cmd.timestamp = replay_cmd.timestamp;
+
+            // optional order_id field - if empty, engine will assign with offset automatically
+            if(!order_id_str.empty())
+            {
+                order_cmd.order_id = static_cast<engine::id_t>(std::stoull(order_id_str));
+            }
+            // optional owner tag - used by MASS_CANCEL
+            if(!owner_str.empty())
+            {
+                order_cmd.owner = static_cast<owner_t>(std::stoul(owner_str));
+            }
+            // GTD expiry - without one the engine rejects the order as BAD_INPUT
+            if(!expire_str.empty())
+            {
+                order_cmd.expire_at = static_cast<uint64_t>(std::stoull(expire_str));
+            }
+            replay_cmd.kind = replay_kind::ADD;
+            return replay_cmd;
+        }
+
+        if (ieq(cmd, "CANCEL"))
+        {
+            // timestamp,cmd,order_id or the full layout with order_id in its own column
+            const std::string order_id_str = cells.size() > static_cast<size_t>(csv_columns::ORDER_ID) ? cell_at(cells, csv_columns::ORDER_ID) : cells.back();
+
+            // for cancel, order_id is required and able to be parsed to uint64_t
+            if(order_id_str.empty())
+            {
+                fmt::print(stderr, "Warning: invalid CANCEL line (missing order_id): {}\n", line);
+                return std::nullopt;
+            }
+            replay_cmd.kind = replay_kind::CANCEL;
+            replay_cmd.cancel_id = static_cast<engine::id_t>(std::stoull(order_id_str));
+            return replay_cmd;
+        }
+
+        if (ieq(cmd, "MASS_CANCEL"))
+        {
+            // timestamp,cmd,side[,,,price[,,,owner]]: owner selects OWNER scope, price selects PRICE scope, otherwise whole side
+            const std::string side_str = cell_at(cells, csv_columns::SIDE);
+            const std::string price_str = cell_at(cells, csv_columns::PRICE);
+            const std::string owner_str = cell_at(cells, csv_columns::OWNER);
+
+            mass_cancel_cmd_t& mass_cmd = replay_cmd.mass;
+            if(ieq(side_str, "BUY")) { mass_cmd.side = Side::BUY; }
+            else if(ieq(side_str, "SELL")) { mass_cmd.side = Side::SELL; }
+
+            if(!owner_str.empty())
+            {
+                mass_cmd.scope = MassCancelScope::OWNER;
+                mass_cmd.owner = static_cast<owner_t>(std::stoul(owner_str));
+            }
+            else if(!price_str.empty())
+            {
+                mass_cmd.scope = MassCancelScope::PRICE;
+                mass_cmd.price = static_cast<price_t>(std::stoll(price_str));
+            }
+            replay_cmd.kind = replay_kind::MASS_CANCEL;
+            return replay_cmd;
+        }
+
+        fmt::print(stderr, "Warning: unknown command (not ADD, CANCEL, MASS_CANCEL, UNCROSS, AUCTION or CONTINUOUS): {}\n", line);
+        return std::nullopt;
+    }
+
+    inline auto side_name(Side side) -> const char* { return side == Side::BUY ? "BUY" : "SELL"; }
+    inline auto order_type_name(OrderType type) -> const char* { return type == OrderType::LIMIT ? "LIMIT" : "MARKET"; }
+    inline auto tif_name(TimeInForce tif) -> const char*
+    {
+        return tif == TimeInForce::IOC ? "IOC" : (tif == TimeInForce::FOK ? "FOK" : (tif == TimeInForce::GTD ? "GTD" : "GTC"));
+    }
+
+    /**
+     * @brief Read a replay CSV: checks the header line, skips blank and comment lines and hands every decoded command to on_cmd in file order.
+     * 
+     * @return 0 on success, 3 if the first line is not a header.
+     */
+    template <class on_cmd_t>
+    auto for_each_replay_cmd(std::istream& input, symbol_table_t& symbols, on_cmd_t&& on_cmd) -> int
+    {
+        std::string line;
+        bool first_line = true;
+
+        while(std::getline(input, line))
+        {
+            // do cleanup for the line in order to get # or spaces only
+            line = trim(line);
+            if(line.empty() || line[0] == '#') {continue;} // skip empty lines or comments
+            auto cells = split_csv_line(line);
+
+            // parsing header line or skip it
+            if(first_line) 
+            {
+                if(!cells.empty() && ieq(cells[0], "timestamp"))
+                {
+                    // get first line
+                    first_line = false; 
+                    continue;
+                }
+                // error code 
+                fmt::print(stderr, "Error: invalid first line (not header): {}\n", line); 
+                return 3;
+            }
+
+            auto replay_cmd = parse_line(cells, line, symbols);
+            if(replay_cmd.has_value()) { on_cmd(*replay_cmd); }
+        }
+        return 0;
+    }
+}; // namespace cli
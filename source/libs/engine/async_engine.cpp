@@ -0,0 +1,94 @@
+#include <libs/engine/async_engine.hpp>
+#include <libs/engine/trace.hpp>
+#include <array>
+
+namespace engine {
+
+// completions get twice the room of commands, so the matching thread rarely waits for poll()
+AsyncEngine::AsyncEngine(const engine_config_t& config, std::size_t capacity_pow2)
+    : engine_(make_engine(config)), commands_(capacity_pow2), completions_(capacity_pow2 * 2)
+{
+}
+
+void AsyncEngine::start()
+{
+    if (running_.exchange(true)) {return;} // already running
+    thread_ = std::thread([this] { run(); });
+}
+
+void AsyncEngine::stop()
+{
+    if (!running_.exchange(false)) {return;}
+    thread_.join();
+}
+
+// ------------Submitter side---------
+void AsyncEngine::enqueue(submit_op_t* op)
+{
+    ++in_flight_;
+    if (op->cmd.trace != nullptr && !op->cmd.trace->reached(TraceStage::INGRESS)) {op->cmd.trace->stamp(TraceStage::INGRESS);}
+    // keep submission order: once something waits, everything after it waits too
+    if (!pending_.empty() || !push_command(op)) {
+        pending_.push_back(op);
+    }
+}
+
+void AsyncEngine::flush_pending()
+{
+    while (!pending_.empty() && push_command(pending_.front())) {
+        pending_.pop_front();
+    }
+}
+
+// ENQUEUE is stamped before the push: once in the ring the op belongs to the matching thread. A failed push is retried and stamped again
+bool AsyncEngine::push_command(submit_op_t* op)
+{
+    if (op->cmd.trace != nullptr) {op->cmd.trace->stamp(TraceStage::ENQUEUE);}
+    return commands_.push(op);
+}
+
+std::size_t AsyncEngine::poll()
+{
+    flush_pending();
+    std::array<submit_op_t*, batch_size> batch{};
+    const std::size_t num = completions_.try_pop_n(batch.data(), batch.size());
+    in_flight_ -= num;
+    for (std::size_t i = 0; i < num; ++i) {
+        // a resumed coroutine may submit again; that only touches pending_ and the command ring
+        batch[i]->handle.resume();
+    }
+    return num;
+}
+
+void AsyncEngine::drain()
+{
+    while (in_flight_ != 0) {
+        if (poll() == 0) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// ------------Matching thread---------
+void AsyncEngine::run()
+{
+    std::array<submit_op_t*, batch_size> batch{};
+    while (true) {
+        const std::size_t num = commands_.try_pop_n(batch.data(), batch.size());
+        if (num == 0) {
+            // the submitter calls stop() after its last submit, so an empty ring is final once stopped
+            if (!running_.load(std::memory_order_acquire) && commands_.approx_size() == 0) {break;}
+            std::this_thread::yield();
+            continue;
+        }
+        for (std::size_t i = 0; i < num; ++i) {
+            if (batch[i]->cmd.trace != nullptr) {batch[i]->cmd.trace->stamp(TraceStage::DEQUEUE);}
+            batch[i]->result = engine_->add_order(batch[i]->cmd);
+            while (!completions_.push(batch[i])) {
+                std::this_thread::yield(); // submitter is behind on poll()
+            }
+        }
+    }
+}
+
+}  // namespace engine
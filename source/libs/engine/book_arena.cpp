@@ -0,0 +1,123 @@
+#include <libs/engine/book_arena.hpp>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace engine {
+
+namespace {
+constexpr std::size_t huge_page_bytes = 2U << 20;
+constexpr std::size_t block_alignment = 64;
+
+std::size_t round_up(std::size_t bytes, std::size_t multiple)
+{
+    return (bytes + multiple - 1) / multiple * multiple;
+}
+
+std::size_t page_bytes()
+{
+#if defined(__linux__)
+    const long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? static_cast<std::size_t>(size) : 4096;
+#else
+    return 4096;
+#endif
+}
+} // namespace
+
+// ------------Initial block---------
+BookArena::Region::Region(const book_arena_options_t& options, std::pmr::memory_resource* upstream)
+    : upstream_(upstream), bytes_(options.initial_bytes)
+{
+    if (bytes_ == 0) {return;}
+
+#if defined(__linux__)
+    if (options.huge_pages) {
+        const std::size_t bytes = round_up(bytes_, huge_page_bytes);
+        void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) {
+            backing_ = PageBacking::HUGE_TLB;
+        } else {
+            // no reserved huge pages: ask for transparent huge pages on a normal mapping
+            ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ptr != MAP_FAILED) {
+                backing_ = (madvise(ptr, bytes, MADV_HUGEPAGE) == 0) ? PageBacking::HUGE_TRANSPARENT : PageBacking::MAPPED;
+            }
+        }
+        if (ptr != MAP_FAILED) {
+            data_ = ptr;
+            bytes_ = bytes;
+        }
+    }
+#endif
+    if (data_ == nullptr) {
+        backing_ = PageBacking::HEAP;
+        data_ = upstream_->allocate(bytes_, block_alignment);
+    }
+
+    if (options.prefault) {
+        // one write per page makes the kernel back the whole block now
+        auto* bytes = static_cast<volatile unsigned char*>(data_);
+        const std::size_t step = page_bytes();
+        for (std::size_t offset = 0; offset < bytes_; offset += step) {
+            bytes[offset] = 0;
+        }
+    }
+}
+
+BookArena::Region::~Region()
+{
+    if (data_ == nullptr) {return;}
+#if defined(__linux__)
+    if (backing_ != PageBacking::HEAP) {
+        munmap(data_, bytes_);
+        return;
+    }
+#endif
+    upstream_->deallocate(data_, bytes_, block_alignment);
+}
+
+// ------------Arena---------
+BookArena::BookArena(const book_arena_options_t& options, std::pmr::memory_resource* upstream)
+    : upstream_(upstream),
+      max_pooled_block_(options.max_pooled_block),
+      region_(options, upstream),
+      chunks_(region_.data(), region_.bytes(), upstream),
+      pools_(std::pmr::pool_options{.max_blocks_per_chunk = options.max_blocks_per_chunk,
+                                    .largest_required_pool_block = options.max_pooled_block},
+             &chunks_)
+{
+}
+
+void BookArena::release()
+{
+    pools_.release();
+    chunks_.release();
+    pooled_bytes_ = 0;
+    large_bytes_ = 0;
+}
+
+void* BookArena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    if (bytes > max_pooled_block_) {
+        large_bytes_ += bytes;
+        return upstream_->allocate(bytes, alignment);
+    }
+    pooled_bytes_ += bytes;
+    return pools_.allocate(bytes, alignment);
+}
+
+void BookArena::do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment)
+{
+    if (bytes > max_pooled_block_) {
+        large_bytes_ -= bytes;
+        upstream_->deallocate(ptr, bytes, alignment);
+        return;
+    }
+    pooled_bytes_ -= bytes;
+    pools_.deallocate(ptr, bytes, alignment);
+}
+
+}  // namespace engine
@@ -0,0 +1,62 @@
+#include <libs/engine/clock.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace engine {
+
+namespace {
+std::uint64_t steady_ns()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+} // namespace
+
+const TscClock& TscClock::instance()
+{
+    static const TscClock clock;
+    return clock;
+}
+
+// spin for calibration_time and take the tick rate from both ends; the steady_clock reading sits between two
+// counter reads so the pairing error is one clock_gettime call
+TscClock::TscClock()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax = 0;
+    unsigned int ebx = 0;
+    unsigned int ecx = 0;
+    unsigned int edx = 0;
+    // CPUID.80000007H:EDX[8] is the invariant TSC flag
+    invariant_ = __get_cpuid(0x80000007U, &eax, &ebx, &ecx, &edx) != 0 && (edx & (1U << 8)) != 0;
+
+    auto sample = [](std::uint64_t& tsc, std::uint64_t& ns) {
+        const std::uint64_t before = ticks();
+        ns = steady_ns();
+        const std::uint64_t after = ticks();
+        tsc = before + (after - before) / 2;
+    };
+    std::uint64_t start_tsc = 0;
+    std::uint64_t start_ns = 0;
+    sample(start_tsc, start_ns);
+    const auto stop = std::chrono::steady_clock::now() + calibration_time;
+    while (std::chrono::steady_clock::now() < stop) {}
+    std::uint64_t end_tsc = 0;
+    std::uint64_t end_ns = 0;
+    sample(end_tsc, end_ns);
+
+    base_ticks_ = end_tsc;
+    base_ns_ = end_ns;
+    if (end_tsc > start_tsc) {
+        ns_per_tick_ = static_cast<double>(end_ns - start_ns) / static_cast<double>(end_tsc - start_tsc);
+    }
+#else
+    // ticks are already steady_clock nanoseconds
+    invariant_ = true;
+    base_ns_ = steady_ns();
+    base_ticks_ = base_ns_;
+#endif
+}
+
+} // namespace engine
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <libs/engine/engine.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+
+namespace engine {
+
+/**
+ * @brief engine::CountingResource is the allocator hook behind memory_stats(). It forwards every request to an upstream memory resource and counts bytes and calls on the way, so each book structure gets its own memory_usage_t. Counters are plain integers: the resource belongs to one book and is used only by the thread driving it.
+ *
+ */
+class CountingResource final : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept : upstream_(upstream) {}
+
+    CountingResource(const CountingResource&) = delete;
+    CountingResource& operator=(const CountingResource&) = delete;
+
+    const memory_usage_t& usage() const noexcept { return usage_; }
+    std::pmr::memory_resource* upstream() const noexcept { return upstream_; }
+
+private:
+    std::pmr::memory_resource* upstream_;
+    memory_usage_t usage_{};
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        void* ptr = upstream_->allocate(bytes, alignment);
+        usage_.bytes_in_use += bytes;
+        usage_.peak_bytes = std::max(usage_.peak_bytes, usage_.bytes_in_use);
+        ++usage_.allocations;
+        return ptr;
+    }
+
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override
+    {
+        upstream_->deallocate(ptr, bytes, alignment);
+        usage_.bytes_in_use -= bytes;
+        ++usage_.deallocations;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+} // namespace engine
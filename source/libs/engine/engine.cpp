@@ -7,319 +7,292 @@
  * @Description: 
  */
 #include <libs/engine/engine.hpp>
+#include <libs/engine/event_publisher.hpp>
+#include <libs/engine/clock.hpp>
+#include <libs/engine/trace.hpp>
+#include "order_book.hpp"
+#include "engine_counters.hpp"
+#include "timing_wheel.hpp"
 #include <algorithm>
-#include <map>
-#include <deque>
-#include <unordered_map>
 #include <chrono>
+#include <utility>
 
 namespace engine {
 
-// ------------order_t Book Implementation---------
-class OrderBook {
+// ------------Engine Implementation---------
+// V1: simple single thread implementation
+// stop for further derivation. For safe capsulation, make it final.
+// Level selects the price level storage layout of the order book.
+template <class Level>
+class EngineSingleThreaded final: public IEngine {
 public:
-    // only use side, price, qty, id from order
-    std::vector<trade_t> add_limit(order_t order, TimeInForce tif, std::uint64_t timestamp);
-    std::vector<trade_t> add_market(order_t order, std::uint64_t timestamp, std::uint16_t max_levels, bool& empty_book);
-    bool cancel(id_t order_id);
-
-    snapshot_t snapshot(int depth) const;
-
-    // for FOK (Fill-Or-Kill) check
-    qty_t available_to_buy_up_to(price_t price) const;
-    qty_t available_to_sell_down_to(price_t price) const;
-    qty_t available_market(Side side, std::uint16_t max_levels) const;
-
-private:
-    using BidBook = std::map<price_t, std::deque<order_t>, std::greater<>>; // Bid price type
-    using AskBook = std::map<price_t, std::deque<order_t>, std::less<> >;   // Ask price type
-
-    BidBook bids_;
-    AskBook asks_;
-    std::unordered_map<id_t, locate_t> index_; // order id -> (side, price)
-
-    static qty_t level_qty(const std::deque<order_t>& price_level)
+    explicit EngineSingleThreaded(const engine_config_t& config)
+        : config_(config), ob_(upstream_of(config), config.cancel_mode, config.compact_dead_ratio), expiries_(upstream_of(config))
+    {
+        // the warm-up exercises continuous matching, the configured mode applies afterwards
+        if(config_.clock == ClockSource::TSC) { tsc_ = &TscClock::instance(); }
+        if(config_.reserve_orders > 0) { ob_.reserve(config_.reserve_orders); }
+        if(config_.warmup_orders > 0) { warm_up(config_.warmup_orders); }
+        mode_ = config_.matching_mode;
+    }
+    add_result_t add_order(const order_cmd_t& cmd) override
     {
-        qty_t quantity = 0;
-        for (const auto& order : price_level) {
-            quantity += order.qty;
+        if(cmd.trace != nullptr) { cmd.trace->stamp(TraceStage::MATCH_START); }
+        auto result = match_order(cmd);
+        if(cmd.trace != nullptr) { cmd.trace->stamp(TraceStage::MATCH_END); }
+        if(config_.publisher != nullptr)
+        {
+            publish_result(result);
+            if(cmd.trace != nullptr) { cmd.trace->stamp(TraceStage::PUBLISH); }
         }
-        return quantity;
+        return result;
     }
+    bool cancel_order(id_t order_id) override 
+    { 
+        bool is_ok = ob_.cancel(order_id);
+        if(is_ok)
+        {
+            counters_.on_cancel(1);
+            refresh_best();
+        }
+        if(config_.publisher != nullptr)
+        {
+            now_ = clock_now(seq_, now_);
+            config_.publisher->publish(event_t{.type=EventType::CANCEL, .code=static_cast<uint8_t>(is_ok), .order_id=order_id, .timestamp=now_});
+            publish_top();
+        }
 
-    void match_level(order_t& in_order, std::deque<order_t>& level, price_t level_px, std::vector<trade_t>& trades, uint64_t timestamp)
+        return is_ok; 
+    };
+    mass_cancel_result_t mass_cancel(const mass_cancel_cmd_t& cmd) override
+    {
+        auto result = ob_.mass_cancel(cmd);
+        counters_.on_cancel(result.cancelled);
+        refresh_best();
+        if(config_.publisher != nullptr)
+        {
+            now_ = clock_now(seq_, now_);
+            config_.publisher->publish(event_t{.type=EventType::MASS_CANCEL, .aux=result.cancelled, .qty=result.cancelled_qty, .timestamp=now_});
+            publish_top();
+        }
+        return result;
+    }
+    mass_cancel_result_t expire_orders(uint64_t now) override
     {
-        while (in_order.qty > 0 && !level.empty()) {
-            // pick up the top order in the same price level
-            order_t& top = level.front();
-            qty_t trade_qty = std::min(in_order.qty, top.qty);
-            trades.push_back( trade_t{ .taker=in_order.id, .maker=top.id, .price=level_px, .qty=trade_qty, .timestamp=timestamp } );
-            // update in order quantity. Later can be decided whether it has to be added in order list
-            in_order.qty -= trade_qty;
-            top.qty -= trade_qty;
-            if (top.qty == 0) {
-                index_.erase(top.id);
-                level.pop_front();
+        auto result = expire_due(now);
+        if(result.cancelled > 0 && config_.publisher != nullptr) { publish_top(); }
+        return result;
+    }
+    uint64_t engine_time() const override { return now_; }
+    uncross_result_t uncross() override
+    {
+        const uint64_t seq = ++seq_;
+        now_ = clock_now(seq, now_); // no caller timestamp: CALLER keeps the last one
+        expire_due(now_);
+        auto result = ob_.uncross(stamp_t{.timestamp=now_, .seq=seq});
+        counters_.on_trades(result.trades.size(), static_cast<uint64_t>(result.volume));
+        refresh_best();
+        if(config_.publisher != nullptr)
+        {
+            for(const auto& trade : result.trades)
+            {
+                config_.publisher->publish(event_t{.type=EventType::TRADE, .order_id=trade.taker, .aux=trade.maker, 
+                    .price=trade.price, .qty=trade.qty, .timestamp=trade.timestamp});
             }
+            publish_top();
         }
+        return result;
     }
-};
-
-// ------------order_t Book Implementation---------
-// capacity calculation
-qty_t OrderBook::available_to_buy_up_to(price_t price) const
-{
-    qty_t total = 0;
-    for (const auto& [ask_px, price_level] : asks_) {
-        if (ask_px > price) {break;}
-        total += level_qty(price_level);
+    uncross_result_t set_matching_mode(MatchingMode mode) override
+    {
+        uncross_result_t result;
+        // continuous matching assumes an uncrossed book
+        if(mode_ == MatchingMode::AUCTION && mode == MatchingMode::CONTINUOUS) { result = uncross(); }
+        mode_ = mode;
+        return result;
+    }
+    MatchingMode matching_mode() const override { return mode_; }
+    snapshot_t snapshot(int depth) const override {return ob_.snapshot(depth);};
+    snapshot_counts_t snapshot_into(std::span<snapshot_level_t> bids, std::span<snapshot_level_t> asks) const override
+    {
+        return ob_.snapshot_into(bids, asks, 0);
+    }
+    snapshot_counts_t snapshot_changed_into(std::span<snapshot_level_t> bids, std::span<snapshot_level_t> asks, std::uint64_t since_version) const override
+    {
+        return ob_.snapshot_into(bids, asks, since_version);
     }
-    return total;
 
-}
+    engine_metrics_t metrics() const override { return counters_.load(); }
+    latency_histogram_t add_latency() const override { return counters_.add_latency(); }
+    memory_stats_t memory_stats() const override { return ob_.memory_stats(); }
+    std::size_t compact(std::size_t max_levels) override { return ob_.compact(max_levels); }
 
-qty_t OrderBook::available_to_sell_down_to(price_t price) const
-{
-    qty_t total = 0;
-    for (const auto& [bid_px, price_level] : bids_) {
-        if (bid_px < price) {break;}
-        total += level_qty(price_level);
+private:
+    engine_config_t config_;
+    OrderBook<Level> ob_;
+    id_t next_{1000};
+    uint64_t seq_{0}; // internal sequence number for ordering
+    uint64_t now_{0}; // engine time of the last command
+    const TscClock* tsc_{nullptr}; // set with ClockSource::TSC
+    MatchingMode mode_{MatchingMode::CONTINUOUS};
+    EngineCounters counters_;
+    TimingWheel expiries_; // GTD orders by expiry time, in engine time
+    snapshot_level_t best_bid_{}; // current top of book, mirrored into counters_ when it changes
+    snapshot_level_t best_ask_{};
+    snapshot_level_t published_bid_{}; // top of book last sent to the publisher
+    snapshot_level_t published_ask_{};
+
+    add_result_t match_order(const order_cmd_t& cmd);
+
+    static std::pmr::memory_resource* upstream_of(const engine_config_t& config)
+    {
+        return config.memory_resource != nullptr ? config.memory_resource : std::pmr::get_default_resource();
     }
-    return total;
-}
 
-qty_t OrderBook::available_market(Side side, std::uint16_t max_levels) const
-{
-    qty_t total = 0;
-    std::uint16_t levels = 0;
-    if (side == Side::BUY) {
-        for (const auto& [ask_px, order_queue] : asks_) {
-            total += level_qty(order_queue);
-            if (++levels >= max_levels) {break;}
-        }
-    } else {
-        for (const auto& [bid_px, order_queue] : bids_) {
-            total += level_qty(order_queue);
-            if (++levels >= max_levels) {break;}
+    // engine time of a command: a single counter, clock or field read
+    uint64_t clock_now(uint64_t seq, uint64_t caller_timestamp) const
+    {
+        switch(config_.clock)
+        {
+        case ClockSource::TSC: return tsc_->now_ns();
+        case ClockSource::CALLER: return caller_timestamp;
+        case ClockSource::SEQUENCE: break;
         }
+        return seq;
     }
-    return total;
-}
+    void warm_up(std::uint32_t orders);
 
-// adding limit order
-std::vector<trade_t> OrderBook::add_limit(order_t order, TimeInForce tif, std::uint64_t timestamp)
-{
-    std::vector<trade_t> trades;
-    if (order.qty <= 0) {
-        return trades; // invalid qty
+    // refresh best bid/ask (O(1) speed, no allocation; an empty side reads as price 0 qty 0)
+    void refresh_best()
+    {
+        std::array<snapshot_level_t, 1> best_bid{};
+        std::array<snapshot_level_t, 1> best_ask{};
+        ob_.snapshot_into(best_bid, best_ask, 0);
+
+        if(best_bid[0] == best_bid_ && best_ask[0] == best_ask_) { return; }
+        best_bid_ = best_bid[0];
+        best_ask_ = best_ask[0];
+        counters_.set_top(best_bid_, best_ask_);
     }
 
-    if (order.side == Side::BUY) {
-        // match against asks
-        for (auto it = asks_.begin(); it != asks_.end() && order.qty > 0 && it->first <= order.price;) {
-            match_level(order, it->second, it->first, trades, timestamp);
-            if (it->second.empty()) {
-                it = asks_.erase(it);
-            } else {
-                ++it;
-            }
-        }
-        // remaining qty
-        if (order.qty > 0) {
-            if (tif == TimeInForce::GTC) {
-                // add to bids and get index price level iterator
-                auto [lv_it, _unused_bool] = bids_.try_emplace(order.price, std::deque<order_t>{});
-                auto& order_queue = lv_it->second;
-                // adding into deque end at the same price level
-                order_queue.emplace_back(order);
-                // index it
-                auto q_it = std::prev(order_queue.end());
-                // added only for Bid. it is able to find the location for price(lv_it) then order id(q_it) with O(1)
-                index_[order.id] = locate_t{ .side = Side::BUY, .bid_it = lv_it, .ask_it = AskBook::iterator{}, .q_it = q_it };
-            }
-            // IOC/FOK unfilled portion is discarded
-        }
-    } else { // SELL
-        // match against bids
-        for (auto it = bids_.begin(); it != bids_.end() && order.qty > 0 && it->first >= order.price;) {
-            match_level(order, it->second, it->first, trades, timestamp);
-            if (it->second.empty()) {
-                it = bids_.erase(it);
-            } else {
-                ++it;
-            }
-        }
-        // remaining qty
-        if (order.qty > 0) {
-            if (tif == TimeInForce::GTC) {
-                // add to asks and get index price level iterator
-                auto [lv_it, _unused_bool] = asks_.try_emplace(order.price, std::deque<order_t>{});
-                auto& order_queue = lv_it->second;
-                // adding into deque end at the same price level
-                order_queue.emplace_back(order);
-                // index it
-                auto q_it = std::prev(order_queue.end());
-                // added only for Ask. it is able to find the location for price(lv_it) then order id(q_it) with O(1)
-                index_[order.id] = locate_t{ .side = Side::SELL, .bid_it = BidBook::iterator{}, .ask_it = lv_it, .q_it = q_it };
+    // remove the GTD orders due at or before now in one batch; orders that filled or were cancelled first are skipped, also when their id rests again
+    mass_cancel_result_t expire_due(uint64_t now)
+    {
+        mass_cancel_result_t result;
+        expiries_.advance(now, [&](id_t order_id, uint32_t generation)
+        {
+            qty_t cancelled_qty = 0;
+            if(!ob_.cancel(order_id, generation, cancelled_qty)) { return; }
+            result.cancelled++;
+            result.cancelled_qty += cancelled_qty;
+            if(config_.publisher != nullptr)
+            {
+                config_.publisher->publish(event_t{.type=EventType::EXPIRE, .order_id=order_id, .qty=cancelled_qty, .timestamp=now});
             }
-            // IOC/FOK unfilled portion is discarded
+        });
+        if(result.cancelled > 0)
+        {
+            counters_.on_expire(result.cancelled);
+            refresh_best();
         }
+        return result;
     }
-    return trades;
-}
 
-// matching only, remaining qty is discarded
-std::vector<trade_t> OrderBook::add_market(order_t order, std::uint64_t timestamp, std::uint16_t max_levels, bool& empty_book)
-{
-    if (order.qty <= 0) {
-        return {}; // invalid qty
-    }
-    std::vector<trade_t> trades;
-    std::uint16_t level = 0;
-
-    if(order.side == Side::BUY)
+    // events are published after matching, outside the measured add latency
+    void publish_result(const add_result_t& result)
     {
-        while(order.qty > 0 && !asks_.empty())
+        for(const auto& trade : result.trades)
         {
-            auto ask_it = asks_.begin();
-            match_level(order, ask_it->second, ask_it->first, trades, timestamp);
-            if(ask_it->second.empty()) {asks_.erase(ask_it);} // remove empty level
-            if(max_levels > 0 && ++level >= max_levels) {break;} // reached max levels
+            config_.publisher->publish(event_t{.type=EventType::TRADE, .order_id=trade.taker, .aux=trade.maker, 
+                .price=trade.price, .qty=trade.qty, .timestamp=trade.timestamp});
         }
-        empty_book = asks_.empty();
-        // remaining qty is discarded for market orders
-    } 
-    else
-    {
-        while(order.qty > 0 && !bids_.empty())
+        for(const auto& level : result.level_fills)
         {
-            auto bid_it = bids_.begin();
-            match_level(order, bid_it->second, bid_it->first, trades, timestamp);
-            if(bid_it->second.empty()) {bids_.erase(bid_it);} // remove empty level
-            if(max_levels > 0 && ++level >= max_levels) {break;} // reached max levels
+            config_.publisher->publish(event_t{.type=EventType::LEVEL_FILL, .order_id=result.order_id, .aux=level.makers,
+                .price=level.price, .qty=level.qty, .timestamp=now_});
         }
-        empty_book = bids_.empty();
-        // remaining qty is discarded for market orders
-    }
-    return trades;
-}
-
-bool OrderBook::cancel(id_t order_id)
-{
-    auto price_it = index_.find(order_id);
-    if (price_it == index_.end()) {
-        return false; // not found
+        config_.publisher->publish(event_t{.type=EventType::ORDER, .code=static_cast<uint8_t>(result.status), .order_id=result.order_id, 
+            .qty=result.filled_qty, .remaining_qty=result.remaining_qty, .timestamp=now_});
+        publish_top();
     }
-    
-    // with O(1) cancel function it is much faster than O(logN) search + O(1) erase
-    auto& loc = price_it->second; // get locate info
-    if (loc.side == Side::BUY) {
-        // find price level
-        auto& order_queue = loc.bid_it->second;
-        // erase order in the price level queue
-        order_queue.erase(loc.q_it); // erase the queue iterator from deque
-        if (order_queue.empty()) {
-            bids_.erase(loc.bid_it);
-        } // remove empty price level
-    }
-    else
-    {
-        // find price level
-        auto& order_queue = loc.ask_it->second;
-        // erase order in the price level queue
-        order_queue.erase(loc.q_it); // erase the queue iterator from deque
-        if (order_queue.empty()) {
-            asks_.erase(loc.ask_it);
-        } // remove empty price level
-    }
-    index_.erase(price_it); // remove from index
-    return true;
-}
-
-snapshot_t OrderBook::snapshot(int depth) const
-{
-    snapshot_t snap;
-    snap.bids.reserve(depth > 0 ? depth : 10);
-    snap.asks.reserve(depth > 0 ? depth : 10);
 
-    auto bit = bids_.begin();
-    auto ait = asks_.begin();
-
-    for(int i = 0; i < depth; i++)
+    // TOP_OF_BOOK only when the best level of a side changed
+    void publish_top()
     {
-        if(bit != bids_.end())
+        const snapshot_level_t bid = best_bid_;
+        const snapshot_level_t ask = best_ask_;
+        if(!(bid == published_bid_))
         {
-            snap.bids.push_back(snapshot_level_t{bit->first, level_qty(bit->second)});
-            ++bit;
+            published_bid_ = bid;
+            config_.publisher->publish(event_t{.type=EventType::TOP_OF_BOOK, .code=static_cast<uint8_t>(Side::BUY), .price=bid.price, .qty=bid.qty, .timestamp=now_});
         }
-        if(ait != asks_.end())
+        if(!(ask == published_ask_))
         {
-            snap.asks.push_back(snapshot_level_t{ait->first, level_qty(ait->second)});
-            ++ait;
+            published_ask_ = ask;
+            config_.publisher->publish(event_t{.type=EventType::TOP_OF_BOOK, .code=static_cast<uint8_t>(Side::SELL), .price=ask.price, .qty=ask.qty, .timestamp=now_});
         }
     }
-
-    return snap;
-}
-
-
-// ------------Engine Implementation---------
-// V1: simple single thread implementation
-// stop for further derivation. For safe capsulation, make it final.
-class EngineSingleThreaded final: public IEngine {
-public:
-    explicit EngineSingleThreaded(const engine_config_t& config): config_(config) {}
-    add_result_t add_order(const order_cmd_t& cmd) override;
-    bool cancel_order(id_t order_id) override 
-    { 
-        bool is_ok = ob_.cancel(order_id);
-        if(is_ok)
-        {
-            metrics_.cancel_orders++;
-        }
-
-        return is_ok; 
-    };
-    snapshot_t snapshot(int depth) const override {return ob_.snapshot(depth);};
-
-    engine_metrics_t metrics() const override { return metrics_; }
-
-private:
-    engine_config_t config_;
-    OrderBook ob_;
-    id_t next_{1000};
-    uint64_t seq_{0}; // internal sequence number for ordering
-    mutable engine_metrics_t metrics_;
 };
 
-add_result_t EngineSingleThreaded::add_order(const order_cmd_t& cmd)
+template <class Level>
+add_result_t EngineSingleThreaded<Level>::match_order(const order_cmd_t& cmd)
 {
     // 0. basic validation
     if (cmd.qty <= 0) 
     {
-        return add_result_t{ .status=OrderStatus::BAD_INPUT, .order_id=0, .trades={}, .filled_qty=0, .remaining_qty=cmd.qty };
+        return add_result_t{ .status=OrderStatus::BAD_INPUT, .order_id=0, .trades={}, .level_fills={}, .filled_qty=0, .remaining_qty=cmd.qty };
     }
 
     if (cmd.order_type == OrderType::LIMIT && cmd.price <= 0) 
     {
-        return add_result_t{ .status=OrderStatus::BAD_INPUT, .order_id=0, .trades={}, .filled_qty=0, .remaining_qty=cmd.qty };
+        return add_result_t{ .status=OrderStatus::BAD_INPUT, .order_id=0, .trades={}, .level_fills={}, .filled_qty=0, .remaining_qty=cmd.qty };
     }
 
-    // Measurement variables
-    const auto t_start = std::chrono::high_resolution_clock::now();
+    if (cmd.time_in_force == TimeInForce::GTD && cmd.expire_at == 0) 
+    {
+        return add_result_t{ .status=OrderStatus::BAD_INPUT, .order_id=0, .trades={}, .level_fills={}, .filled_qty=0, .remaining_qty=cmd.qty };
+    }
+
+    // NO_OWNER is reserved for untagged orders, so it cannot be given as a tag
+    if (cmd.owner.has_value() && *cmd.owner == NO_OWNER) 
+    {
+        return add_result_t{ .status=OrderStatus::BAD_INPUT, .order_id=0, .trades={}, .level_fills={}, .filled_qty=0, .remaining_qty=cmd.qty };
+    }
 
     // logic variables
     // 1. assign a new order id if not provided.
     id_t order_id = cmd.order_id.value_or(next_++);
 
-    uint64_t timestamp = ++seq_; // internal sequence number for ordering -> in the future can be replaced by global time source
+    const uint64_t seq = ++seq_; // internal sequence number for ordering
+    now_ = clock_now(seq, cmd.timestamp);
+    const stamp_t stamp{.timestamp=now_, .seq=seq};
+
+    // 2. orders expiring by now leave the book before this one can trade against them (outside the measured latency)
+    expire_due(now_);
+    if(cmd.time_in_force == TimeInForce::GTD && cmd.expire_at <= now_)
+    {
+        return add_result_t{ .status=OrderStatus::REJECT, .order_id=order_id, .trades={}, .level_fills={}, .filled_qty=0, .remaining_qty=cmd.qty};
+    }
+
+    // Measurement variables
+    const auto t_start = std::chrono::high_resolution_clock::now();
 
-    std::vector<trade_t> trades;
+    execution_t exec{.report=config_.fill_report, .sink=config_.fill_sink, .trades={}, .levels={}};
     OrderStatus status = OrderStatus::OK;
     qty_t filled_qty = 0;
     qty_t remaining_qty = 0;
 
-    if(cmd.order_type==OrderType::LIMIT)
+    if(mode_ == MatchingMode::AUCTION)
+    {
+        // collection: only GTC and GTD limit orders take part, they rest without matching until uncross()
+        if(cmd.order_type != OrderType::LIMIT || (cmd.time_in_force != TimeInForce::GTC && cmd.time_in_force != TimeInForce::GTD))
+        {
+            return add_result_t{ .status=OrderStatus::REJECT, .order_id=order_id, .trades={}, .level_fills={}, .filled_qty=0, .remaining_qty=cmd.qty};
+        }
+        ob_.rest(order_t{.id=order_id, .side=cmd.side, .price=cmd.price, .qty=cmd.qty, .owner=cmd.owner.value_or(NO_OWNER)});
+        remaining_qty = cmd.qty;
+    }
+    else if(cmd.order_type==OrderType::LIMIT)
     {
         // FOK (Fill-Or-Kill) check
         if(cmd.time_in_force == TimeInForce::FOK)
@@ -329,13 +302,13 @@ add_result_t EngineSingleThreaded::add_order(const order_cmd_t& cmd)
                 (ob_.available_to_sell_down_to(cmd.price) >= cmd.qty);
             if(!is_ok)
             {
-                return add_result_t{ .status=OrderStatus::FOK_FAIL, .order_id=order_id, .trades={}, .filled_qty=0, .remaining_qty=cmd.qty};
+                return add_result_t{ .status=OrderStatus::FOK_FAIL, .order_id=order_id, .trades={}, .level_fills={}, .filled_qty=0, .remaining_qty=cmd.qty};
             }
         }
 
         // implement limit orders
-        trades = ob_.add_limit(order_t{.id=cmd.order_id.value_or(order_id), .side=cmd.side, .price=cmd.price, .qty=cmd.qty, .seq_num=0}, cmd.time_in_force, timestamp);
-        for(const auto& trade:trades) {filled_qty += trade.qty;}
+        ob_.add_limit(order_t{.id=cmd.order_id.value_or(order_id), .side=cmd.side, .price=cmd.price, .qty=cmd.qty, .owner=cmd.owner.value_or(NO_OWNER)}, cmd.time_in_force, stamp, exec);
+        filled_qty = exec.filled_qty;
         remaining_qty = cmd.qty - filled_qty;
 
         // State machine
@@ -348,7 +321,7 @@ add_result_t EngineSingleThreaded::add_order(const order_cmd_t& cmd)
             status = (filled_qty == 0 ? OrderStatus::OK :
                       (remaining_qty == 0 ? OrderStatus::FILLED : OrderStatus::PARTIAL));
         }
-        else // GTC
+        else // GTC or GTD
         {
             status = (filled_qty == 0 ? OrderStatus::OK :
                       (remaining_qty == 0 ? OrderStatus::FILLED : OrderStatus::OK));
@@ -362,21 +335,20 @@ add_result_t EngineSingleThreaded::add_order(const order_cmd_t& cmd)
             const auto available = ob_.available_market(cmd.side, config_.market_max_levels);
             if(available < cmd.qty)
             {
-                return add_result_t{ .status=OrderStatus::FOK_FAIL, .order_id=order_id, .trades={}, .filled_qty=0, .remaining_qty=cmd.qty};
+                return add_result_t{ .status=OrderStatus::FOK_FAIL, .order_id=order_id, .trades={}, .level_fills={}, .filled_qty=0, .remaining_qty=cmd.qty};
             }
         } 
         
-        // MARKET + GTC
-        if(cmd.time_in_force == TimeInForce::GTC && !config_.market_gtc_as_ioc)
+        // MARKET + GTC (GTD alike: nothing of a market order rests)
+        if((cmd.time_in_force == TimeInForce::GTC || cmd.time_in_force == TimeInForce::GTD) && !config_.market_gtc_as_ioc)
         {
-            return add_result_t{ .status=OrderStatus::REJECT, .order_id=order_id, .trades={}, .filled_qty=0, .remaining_qty=cmd.qty};
+            return add_result_t{ .status=OrderStatus::REJECT, .order_id=order_id, .trades={}, .level_fills={}, .filled_qty=0, .remaining_qty=cmd.qty};
         }
 
         bool empty_book = false;
-        trades = ob_.add_market(order_t{.id=cmd.order_id.value_or(order_id), .side=cmd.side, .price=0, .qty=cmd.qty, .seq_num=0}, 
-                                timestamp, config_.market_max_levels, empty_book);
-
-        for(const auto& trade:trades) {filled_qty += trade.qty;}
+        ob_.add_market(order_t{.id=cmd.order_id.value_or(order_id), .side=cmd.side, .price=0, .qty=cmd.qty, .owner=cmd.owner.value_or(NO_OWNER)}, 
+                       stamp, config_.market_max_levels, exec, empty_book);
+        filled_qty = exec.filled_qty;
         remaining_qty = cmd.qty - filled_qty;
 
         // State machine
@@ -388,59 +360,84 @@ add_result_t EngineSingleThreaded::add_order(const order_cmd_t& cmd)
         {
             status = (remaining_qty == 0 ? OrderStatus::FILLED : OrderStatus::FOK_FAIL);
         }
-        else // IOC or GTC(as IOC)
+        else // IOC or GTC/GTD(as IOC)
         {
             status = (remaining_qty == 0 ? OrderStatus::FILLED :
                       (filled_qty > 0 ? OrderStatus::PARTIAL : OrderStatus::OK));
         }
     }
 
+    // a resting GTD remainder is scheduled for removal at its expiry, O(1); it is the order the book rested last
+    if(cmd.time_in_force == TimeInForce::GTD && cmd.order_type == OrderType::LIMIT && remaining_qty > 0)
+    {
+        expiries_.schedule(order_id, ob_.last_rest(), cmd.expire_at);
+    }
+
     // timing calculation
     const auto t_end = std::chrono::high_resolution_clock::now();
     const auto duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t_end - t_start);
 
-    metrics_.add_orders++;
-    metrics_.trades += trades.size();
-    for(auto& trade: trades) { metrics_.traded_qty += trade.qty; }
+    counters_.on_add(exec.fills, static_cast<uint64_t>(filled_qty), static_cast<uint64_t>(duration_ns.count()));
 
-    metrics_.add_total_ns += duration_ns.count();
-    // find min and max latency
-    metrics_.add_min_ns = std::min(metrics_.add_min_ns, static_cast<uint64_t>(duration_ns.count()));
-    metrics_.add_max_ns = std::max(metrics_.add_max_ns, static_cast<uint64_t>(duration_ns.count()));
+    refresh_best();
 
-    // refresh best bid/ask (O(1) speed)
-    auto snapshot_moment = this->snapshot(1);
+    return add_result_t{ .status=status, .order_id=order_id, .trades=std::move(exec.trades), .level_fills=std::move(exec.levels),
+        .filled_qty=filled_qty, .remaining_qty=remaining_qty};
+}
 
-    if(!snapshot_moment.bids.empty())
-    {
-        metrics_.best_bid_px = snapshot_moment.bids[0].price;
-        metrics_.best_bid_qty = snapshot_moment.bids[0].qty;
-    }
-    else
-    {
-        metrics_.best_bid_px = 0;
-        metrics_.best_bid_qty = 0;
-    }
+// Run the hot paths (resting, matching, cancel, mass cancel) on a synthetic flow, then reset to a fresh state.
+// Freed level and index nodes go back to the memory resource's pools and the index keeps its buckets.
+template <class Level>
+void EngineSingleThreaded<Level>::warm_up(std::uint32_t orders)
+{
+    constexpr price_t base_px = 1000000;
+    constexpr int levels = 32;
+    EventPublisher* publisher = std::exchange(config_.publisher, nullptr);
+    IFillSink* fill_sink = std::exchange(config_.fill_sink, nullptr);
 
-    if(!snapshot_moment.asks.empty())
-    {
-        metrics_.best_ask_px = snapshot_moment.asks[0].price;
-        metrics_.best_ask_qty = snapshot_moment.asks[0].qty;
-    }
-    else
+    for(std::uint32_t i = 0; i < orders; i++)
     {
-        metrics_.best_ask_px = 0;
-        metrics_.best_ask_qty = 0;  
+        const Side side = (i % 2 == 0) ? Side::BUY : Side::SELL;
+        const auto offset = static_cast<price_t>(1 + (i / 2) % levels);
+        if(i % 8 == 7)
+        {
+            // aggressive order that takes the best level of the other side
+            match_order(order_cmd_t{.side=side, .order_type=OrderType::LIMIT, .time_in_force=TimeInForce::IOC,
+                .price=(side == Side::BUY) ? base_px + levels : base_px - levels, .qty=2});
+        }
+        else if(i % 8 == 5)
+        {
+            cancel_order(next_ - 3);
+        }
+        else
+        {
+            match_order(order_cmd_t{.side=side, .order_type=OrderType::LIMIT, .time_in_force=TimeInForce::GTC,
+                .price=(side == Side::BUY) ? base_px - offset : base_px + offset, .qty=1});
+        }
     }
-
-    return add_result_t{ .status=status, .order_id=order_id, .trades=std::move(trades), .filled_qty=filled_qty, .remaining_qty=remaining_qty};
+    ob_.mass_cancel(mass_cancel_cmd_t{.scope=MassCancelScope::SIDE});
+    expiries_.clear();
+
+    config_.publisher = publisher;
+    config_.fill_sink = fill_sink;
+    next_ = 1000;
+    seq_ = 0;
+    now_ = 0;
+    counters_.reset();
+    best_bid_ = snapshot_level_t{};
+    best_ask_ = snapshot_level_t{};
+    published_bid_ = snapshot_level_t{};
+    published_ask_ = snapshot_level_t{};
 }
 
 /// create a unique pointer of engine
 /// for future extension, can create different engine implementations based on config
 std::unique_ptr<IEngine> make_engine(const engine_config_t& config)
 {
-    return std::make_unique<EngineSingleThreaded>(config);
+    if (config.level_layout == LevelLayout::SOA) {
+        return std::make_unique<EngineSingleThreaded<SoaLevel>>(config);
+    }
+    return std::make_unique<EngineSingleThreaded<AosLevel>>(config);
 }
 
 } // namespace engine
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <libs/engine/engine.hpp>
+#include <libs/engine/latency_histogram.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace engine {
+
+/**
+ * @brief engine::EngineCounters holds the metrics of one engine so a monitoring thread can read them while the engine runs. The activity counters and the latency histogram share the writer's cache lines; the best bid/ask sit on their own line behind a seqlock and are rewritten only when the top of book changes, so a reader polling them does not pull the hot counters away from the matching thread. Every field has a single writer, the thread driving the engine.
+ *
+ */
+class EngineCounters {
+public:
+    void on_add(std::size_t trades, std::uint64_t traded_qty, std::uint64_t latency_ns) noexcept
+    {
+        concurrency::bump(add_orders_);
+        concurrency::bump(trades_, trades);
+        concurrency::bump(traded_qty_, traded_qty);
+        concurrency::bump(add_total_ns_, latency_ns);
+        if (latency_ns < add_min_ns_.load(std::memory_order_relaxed)) {add_min_ns_.store(latency_ns, std::memory_order_relaxed);}
+        if (latency_ns > add_max_ns_.load(std::memory_order_relaxed)) {add_max_ns_.store(latency_ns, std::memory_order_relaxed);}
+        add_latency_.record(latency_ns);
+    }
+
+    void on_cancel(std::uint64_t orders) noexcept { concurrency::bump(cancel_orders_, orders); }
+    void on_expire(std::uint64_t orders) noexcept { concurrency::bump(expired_orders_, orders); }
+
+    void on_trades(std::size_t trades, std::uint64_t traded_qty) noexcept
+    {
+        concurrency::bump(trades_, trades);
+        concurrency::bump(traded_qty_, traded_qty);
+    }
+
+    void set_top(const snapshot_level_t& bid, const snapshot_level_t& ask) noexcept
+    {
+        // odd sequence: update in progress, readers retry
+        const std::uint64_t seq = top_seq_.load(std::memory_order_relaxed);
+        top_seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        best_bid_px_.store(static_cast<std::uint64_t>(bid.price), std::memory_order_relaxed);
+        best_bid_qty_.store(static_cast<std::uint64_t>(bid.qty), std::memory_order_relaxed);
+        best_ask_px_.store(static_cast<std::uint64_t>(ask.price), std::memory_order_relaxed);
+        best_ask_qty_.store(static_cast<std::uint64_t>(ask.qty), std::memory_order_relaxed);
+        top_seq_.store(seq + 2, std::memory_order_release);
+    }
+
+    engine_metrics_t load() const noexcept
+    {
+        engine_metrics_t result{
+            .add_orders = add_orders_.load(std::memory_order_relaxed),
+            .cancel_orders = cancel_orders_.load(std::memory_order_relaxed),
+            .expired_orders = expired_orders_.load(std::memory_order_relaxed),
+            .trades = trades_.load(std::memory_order_relaxed),
+            .traded_qty = traded_qty_.load(std::memory_order_relaxed),
+            .add_min_ns = add_min_ns_.load(std::memory_order_relaxed),
+            .add_max_ns = add_max_ns_.load(std::memory_order_relaxed),
+            .add_total_ns = add_total_ns_.load(std::memory_order_relaxed),
+        };
+        while (true) {
+            const std::uint64_t seq = top_seq_.load(std::memory_order_acquire);
+            if ((seq & 1U) == 0) {
+                result.best_bid_px = best_bid_px_.load(std::memory_order_relaxed);
+                result.best_bid_qty = best_bid_qty_.load(std::memory_order_relaxed);
+                result.best_ask_px = best_ask_px_.load(std::memory_order_relaxed);
+                result.best_ask_qty = best_ask_qty_.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (top_seq_.load(std::memory_order_relaxed) == seq) {break;}
+            }
+        }
+        return result;
+    }
+
+    latency_histogram_t add_latency() const noexcept { return add_latency_.load(); }
+
+    /// writer thread only
+    void reset() noexcept
+    {
+        for (auto* counter : {&add_orders_, &cancel_orders_, &expired_orders_, &trades_, &traded_qty_, &add_max_ns_, &add_total_ns_}) {
+            counter->store(0, std::memory_order_relaxed);
+        }
+        add_min_ns_.store(engine_metrics_t{}.add_min_ns, std::memory_order_relaxed);
+        add_latency_.reset();
+        set_top(snapshot_level_t{}, snapshot_level_t{});
+    }
+
+private:
+    // activity, written on every command
+    alignas(64) std::atomic<std::uint64_t> add_orders_{0};
+    std::atomic<std::uint64_t> cancel_orders_{0};
+    std::atomic<std::uint64_t> expired_orders_{0};
+    std::atomic<std::uint64_t> trades_{0};
+    std::atomic<std::uint64_t> traded_qty_{0};
+    std::atomic<std::uint64_t> add_min_ns_{engine_metrics_t{}.add_min_ns};
+    std::atomic<std::uint64_t> add_max_ns_{0};
+    std::atomic<std::uint64_t> add_total_ns_{0};
+    LatencyHistogram add_latency_;
+
+    // top of book, written when it changes
+    alignas(64) std::atomic<std::uint64_t> top_seq_{0};
+    std::atomic<std::uint64_t> best_bid_px_{0};
+    std::atomic<std::uint64_t> best_bid_qty_{0};
+    std::atomic<std::uint64_t> best_ask_px_{0};
+    std::atomic<std::uint64_t> best_ask_qty_{0};
+};
+
+} // namespace engine
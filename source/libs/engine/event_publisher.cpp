@@ -0,0 +1,88 @@
+#include <libs/engine/event_publisher.hpp>
+
+namespace engine {
+
+// ------------File Sink---------
+FileEventSink::FileEventSink(const std::string& path, std::size_t buffer_bytes)
+    : file_(std::fopen(path.c_str(), "wb")), buffer_(buffer_bytes)
+{
+    if (file_ != nullptr) {
+        // large stdio buffer: one write syscall per buffer_bytes of events
+        std::setvbuf(file_, buffer_.data(), _IOFBF, buffer_.size());
+    }
+}
+
+FileEventSink::~FileEventSink()
+{
+    if (file_ != nullptr) {
+        std::fclose(file_);
+    }
+}
+
+void FileEventSink::on_events(std::span<const event_t> events)
+{
+    if (file_ == nullptr) {return;}
+    std::fwrite(events.data(), sizeof(event_t), events.size(), file_);
+}
+
+void FileEventSink::flush()
+{
+    if (file_ != nullptr) {std::fflush(file_);}
+}
+
+// ------------Publisher---------
+void EventPublisher::start()
+{
+    if (running_.exchange(true)) {return;} // already running
+    thread_ = std::thread([this] { run(); });
+}
+
+void EventPublisher::stop()
+{
+    if (!running_.exchange(false)) {return;}
+    thread_.join();
+}
+
+std::size_t EventPublisher::drain(std::vector<event_t>& batch)
+{
+    const std::size_t num = ring_.try_pop_n(batch.data(), batch.size());
+    if (num == 0) {return 0;}
+
+    const std::span<const event_t> events(batch.data(), num);
+    for (auto& sink : sinks_) {
+        sink->on_events(events);
+    }
+    concurrency::bump(delivered_, num);
+    concurrency::bump(batches_);
+    return num;
+}
+
+void EventPublisher::run()
+{
+    std::vector<event_t> batch(batch_size);
+    while (running_.load(std::memory_order_acquire)) {
+        if (drain(batch) == 0) {
+            std::this_thread::yield();
+        }
+    }
+    // the producer has stopped publishing, deliver what is left
+    while (drain(batch) != 0) {}
+    for (auto& sink : sinks_) {
+        sink->flush();
+    }
+}
+
+publisher_stats_t EventPublisher::stats() const noexcept
+{
+    return publisher_stats_t{
+        .published = published_.load(std::memory_order_relaxed),
+        .dropped = dropped_.load(std::memory_order_relaxed),
+        .delivered = delivered_.load(std::memory_order_relaxed),
+        .batches = batches_.load(std::memory_order_relaxed),
+        .occupancy = ring_.approx_size(),
+        .capacity = ring_.capacity(),
+        .ring = ring_.stats(),
+    };
+}
+
+}  // namespace engine
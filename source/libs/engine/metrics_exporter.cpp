@@ -0,0 +1,192 @@
+#include <libs/engine/metrics_exporter.hpp>
+#include <libs/engine/event_publisher.hpp>
+#include <fmt/format.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace engine {
+
+namespace {
+// label values escape backslash, double quote and newline
+std::string escape_label(const std::string& value)
+{
+    std::string result;
+    result.reserve(value.size());
+    for (const char c : value) {
+        switch (c) {
+        case '\\': result += "\\\\"; break;
+        case '"': result += "\\\""; break;
+        case '\n': result += "\\n"; break;
+        default: result += c; break;
+        }
+    }
+    return result;
+}
+
+void family(fmt::memory_buffer& out, const char* name, const char* type, const char* help)
+{
+    fmt::format_to(std::back_inserter(out), "# HELP {} {}\n# TYPE {} {}\n", name, help, name, type);
+}
+
+template <class Stats>
+using labelled_t = std::vector<std::pair<std::string, Stats>>; // escaped label value, stats read once
+
+// one family, one sample per source
+template <class Stats, class Value>
+void samples(fmt::memory_buffer& out, const labelled_t<Stats>& sources, const char* label, const char* name, const char* type, const char* help, Value&& value)
+{
+    if (sources.empty()) {return;}
+    family(out, name, type, help);
+    for (const auto& [source_name, stats] : sources) {
+        fmt::format_to(std::back_inserter(out), "{}{{{}=\"{}\"}} {}\n", name, label, source_name, value(stats));
+    }
+}
+} // namespace
+
+MetricsExporter::MetricsExporter(std::string path, std::chrono::milliseconds period)
+    : path_(std::move(path)), period_(period)
+{
+}
+
+void MetricsExporter::start()
+{
+    std::lock_guard lock(mutex_);
+    if (running_) {return;} // already running
+    running_ = true;
+    thread_ = std::thread([this] { run(); });
+}
+
+void MetricsExporter::stop()
+{
+    {
+        std::lock_guard lock(mutex_);
+        if (!running_) {return;}
+        running_ = false;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void MetricsExporter::run()
+{
+    std::unique_lock lock(mutex_);
+    while (running_) {
+        wake_.wait_for(lock, period_, [this] { return !running_; });
+        lock.unlock();
+        write_now(); // also the final dump after stop()
+        lock.lock();
+    }
+}
+
+std::string MetricsExporter::error() const
+{
+    std::lock_guard lock(mutex_);
+    return error_;
+}
+
+// ------------Text format---------
+std::string MetricsExporter::format() const
+{
+    fmt::memory_buffer out;
+
+    // read every source once, then format family by family
+    labelled_t<engine_metrics_t> engine_metrics;
+    labelled_t<latency_histogram_t> latency;
+    for (const auto& [name, source] : engines_) {
+        engine_metrics.emplace_back(escape_label(name), source->metrics());
+        latency.emplace_back(escape_label(name), source->add_latency());
+    }
+
+    samples(out, engine_metrics, "engine", "scopex_orders_added_total", "counter", "Orders passed to add_order.",
+            [](const engine_metrics_t& m) { return m.add_orders; });
+    samples(out, engine_metrics, "engine", "scopex_orders_cancelled_total", "counter", "Orders removed by cancel and mass cancel.",
+            [](const engine_metrics_t& m) { return m.cancel_orders; });
+    samples(out, engine_metrics, "engine", "scopex_orders_expired_total", "counter", "GTD orders removed at their expiry.",
+            [](const engine_metrics_t& m) { return m.expired_orders; });
+    samples(out, engine_metrics, "engine", "scopex_trades_total", "counter", "Trades executed.",
+            [](const engine_metrics_t& m) { return m.trades; });
+    samples(out, engine_metrics, "engine", "scopex_traded_qty_total", "counter", "Quantity traded.",
+            [](const engine_metrics_t& m) { return m.traded_qty; });
+    samples(out, engine_metrics, "engine", "scopex_best_bid_price", "gauge", "Best bid price, 0 when the side is empty.",
+            [](const engine_metrics_t& m) { return m.best_bid_px; });
+    samples(out, engine_metrics, "engine", "scopex_best_bid_qty", "gauge", "Quantity at the best bid.",
+            [](const engine_metrics_t& m) { return m.best_bid_qty; });
+    samples(out, engine_metrics, "engine", "scopex_best_ask_price", "gauge", "Best ask price, 0 when the side is empty.",
+            [](const engine_metrics_t& m) { return m.best_ask_px; });
+    samples(out, engine_metrics, "engine", "scopex_best_ask_qty", "gauge", "Quantity at the best ask.",
+            [](const engine_metrics_t& m) { return m.best_ask_qty; });
+    samples(out, engine_metrics, "engine", "scopex_add_latency_max_ns", "gauge", "Slowest add_order matching so far.",
+            [](const engine_metrics_t& m) { return m.add_max_ns; });
+
+    if (!latency.empty()) {
+        constexpr const char* name = "scopex_add_latency_ns";
+        family(out, name, "histogram", "add_order matching latency in nanoseconds.");
+        for (const auto& [label, histogram] : latency) {
+            std::uint64_t cumulative = 0;
+            for (std::size_t bucket = 0; bucket + 1 < latency_buckets; ++bucket) {
+                cumulative += histogram.counts[bucket];
+                fmt::format_to(std::back_inserter(out), "{}_bucket{{engine=\"{}\",le=\"{}\"}} {}\n", name, label, latency_histogram_t::upper_bound_ns(bucket), cumulative);
+            }
+            cumulative += histogram.counts[latency_buckets - 1];
+            fmt::format_to(std::back_inserter(out), "{}_bucket{{engine=\"{}\",le=\"+Inf\"}} {}\n", name, label, cumulative);
+            fmt::format_to(std::back_inserter(out), "{}_sum{{engine=\"{}\"}} {}\n{}_count{{engine=\"{}\"}} {}\n", name, label, histogram.sum_ns, name, label, cumulative);
+        }
+    }
+
+    labelled_t<publisher_stats_t> publisher_stats;
+    for (const auto& [name, source] : publishers_) {
+        publisher_stats.emplace_back(escape_label(name), source->stats());
+    }
+
+    samples(out, publisher_stats, "publisher", "scopex_events_published_total", "counter", "Events accepted into the publisher ring.",
+            [](const publisher_stats_t& s) { return s.published; });
+    samples(out, publisher_stats, "publisher", "scopex_events_dropped_total", "counter", "Events dropped because the publisher ring was full.",
+            [](const publisher_stats_t& s) { return s.dropped; });
+    samples(out, publisher_stats, "publisher", "scopex_events_delivered_total", "counter", "Events handed to the sinks.",
+            [](const publisher_stats_t& s) { return s.delivered; });
+    samples(out, publisher_stats, "publisher", "scopex_event_ring_occupancy", "gauge", "Events waiting in the publisher ring.",
+            [](const publisher_stats_t& s) { return s.occupancy; });
+    samples(out, publisher_stats, "publisher", "scopex_event_ring_high_water", "gauge", "Highest sampled occupancy of the publisher ring.",
+            [](const publisher_stats_t& s) { return s.ring.high_water; });
+    samples(out, publisher_stats, "publisher", "scopex_event_ring_capacity", "gauge", "Capacity of the publisher ring.",
+            [](const publisher_stats_t& s) { return s.capacity; });
+
+    return fmt::to_string(out);
+}
+
+// ------------File---------
+bool MetricsExporter::write_now()
+{
+    const std::string text = format();
+    const std::string temp_path = path_ + ".tmp";
+
+    std::string failure;
+    std::FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (file == nullptr) {
+        failure = fmt::format("open '{}': {}", temp_path, std::strerror(errno));
+    } else {
+        const bool written = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+        const bool closed = std::fclose(file) == 0;
+        if (!written || !closed) {
+            failure = fmt::format("write '{}' failed", temp_path);
+        } else if (std::rename(temp_path.c_str(), path_.c_str()) != 0) {
+            failure = fmt::format("rename to '{}': {}", path_, std::strerror(errno));
+        }
+    }
+
+    if (!failure.empty()) {
+        std::remove(temp_path.c_str());
+        failures_.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard lock(mutex_);
+        error_ = std::move(failure);
+        return false;
+    }
+    dumps_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace engine
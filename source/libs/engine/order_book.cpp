@@ -0,0 +1,494 @@
+#include "order_book.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace engine {
+
+// ------------order_t Book Implementation---------
+// capacity calculation
+template <class Level>
+qty_t OrderBook<Level>::available_to_buy_up_to(price_t price) const
+{
+    qty_t total = 0;
+    for (const auto& [ask_px, price_level] : asks_) {
+        if (ask_px > price) {break;}
+        total += price_level.total_qty();
+    }
+    return total;
+
+}
+
+template <class Level>
+qty_t OrderBook<Level>::available_to_sell_down_to(price_t price) const
+{
+    qty_t total = 0;
+    for (const auto& [bid_px, price_level] : bids_) {
+        if (bid_px < price) {break;}
+        total += price_level.total_qty();
+    }
+    return total;
+}
+
+template <class Level>
+qty_t OrderBook<Level>::available_market(Side side, std::uint16_t max_levels) const
+{
+    qty_t total = 0;
+    std::uint16_t levels = 0;
+    if (side == Side::BUY) {
+        for (const auto& [ask_px, price_level] : asks_) {
+            total += price_level.total_qty();
+            if (++levels >= max_levels) {break;}
+        }
+    } else {
+        for (const auto& [bid_px, price_level] : bids_) {
+            total += price_level.total_qty();
+            if (++levels >= max_levels) {break;}
+        }
+    }
+    return total;
+}
+
+// adding limit order
+template <class Level>
+void OrderBook<Level>::add_limit(order_t order, TimeInForce tif, stamp_t stamp, execution_t& exec)
+{
+    if (order.qty <= 0) {
+        return; // invalid qty
+    }
+
+    if (order.side == Side::BUY) {
+        // match against asks
+        for (auto it = asks_.begin(); it != asks_.end() && order.qty > 0 && it->first <= order.price;) {
+            match_level(order, it->second, it->first, exec, stamp);
+            if (it->second.empty()) {
+                it = asks_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        // remaining qty
+        if (order.qty > 0) {
+            if (tif == TimeInForce::GTC || tif == TimeInForce::GTD) {
+                rest(order);
+            }
+            // IOC/FOK unfilled portion is discarded
+        }
+    } else { // SELL
+        // match against bids
+        for (auto it = bids_.begin(); it != bids_.end() && order.qty > 0 && it->first >= order.price;) {
+            match_level(order, it->second, it->first, exec, stamp);
+            if (it->second.empty()) {
+                it = bids_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        // remaining qty
+        if (order.qty > 0) {
+            if (tif == TimeInForce::GTC || tif == TimeInForce::GTD) {
+                rest(order);
+            }
+            // IOC/FOK unfilled portion is discarded
+        }
+    }
+}
+
+// resting without matching
+template <class Level>
+void OrderBook<Level>::rest(const order_t& order)
+{
+    if (order.side == Side::BUY) {
+        // add to bids and get index price level iterator
+        auto [lv_it, _unused_bool] = bids_.try_emplace(order.price, &queue_memory_);
+        // adding into the level queue end at the same price level
+        const std::uint64_t slot = lv_it->second.push_back(order.id, order.qty, order.owner);
+        lv_it->second.touch(++version_);
+        // added only for Bid. it is able to find the location for price(lv_it) with O(1)
+        index_[order.id] = locate_t{ .side = Side::BUY, .generation = ++rests_, .bid_it = lv_it, .ask_it = typename AskBook::iterator{}, .slot = slot };
+    } else {
+        // add to asks and get index price level iterator
+        auto [lv_it, _unused_bool] = asks_.try_emplace(order.price, &queue_memory_);
+        // adding into the level queue end at the same price level
+        const std::uint64_t slot = lv_it->second.push_back(order.id, order.qty, order.owner);
+        lv_it->second.touch(++version_);
+        // added only for Ask. it is able to find the location for price(lv_it) with O(1)
+        index_[order.id] = locate_t{ .side = Side::SELL, .generation = ++rests_, .bid_it = typename BidBook::iterator{}, .ask_it = lv_it, .slot = slot };
+    }
+}
+
+// matching only, remaining qty is discarded
+template <class Level>
+void OrderBook<Level>::add_market(order_t order, stamp_t stamp, std::uint16_t max_levels, execution_t& exec, bool& empty_book)
+{
+    if (order.qty <= 0) {
+        return; // invalid qty
+    }
+    std::uint16_t level = 0;
+
+    if(order.side == Side::BUY)
+    {
+        while(order.qty > 0 && !asks_.empty())
+        {
+            auto ask_it = asks_.begin();
+            match_level(order, ask_it->second, ask_it->first, exec, stamp);
+            if(ask_it->second.empty()) {asks_.erase(ask_it);} // remove empty level
+            if(max_levels > 0 && ++level >= max_levels) {break;} // reached max levels
+        }
+        empty_book = asks_.empty();
+        // remaining qty is discarded for market orders
+    } 
+    else
+    {
+        while(order.qty > 0 && !bids_.empty())
+        {
+            auto bid_it = bids_.begin();
+            match_level(order, bid_it->second, bid_it->first, exec, stamp);
+            if(bid_it->second.empty()) {bids_.erase(bid_it);} // remove empty level
+            if(max_levels > 0 && ++level >= max_levels) {break;} // reached max levels
+        }
+        empty_book = bids_.empty();
+        // remaining qty is discarded for market orders
+    }
+}
+
+template <class Level>
+bool OrderBook<Level>::cancel(id_t order_id)
+{
+    qty_t cancelled_qty = 0;
+    return cancel(order_id, cancelled_qty);
+}
+
+template <class Level>
+bool OrderBook<Level>::cancel(id_t order_id, qty_t& cancelled_qty)
+{
+    auto price_it = index_.find(order_id);
+    if (price_it == index_.end()) {
+        return false; // not found
+    }
+    cancel_located(price_it, order_id, cancelled_qty);
+    return true;
+}
+
+template <class Level>
+bool OrderBook<Level>::cancel(id_t order_id, std::uint32_t generation, qty_t& cancelled_qty)
+{
+    auto price_it = index_.find(order_id);
+    if (price_it == index_.end() || price_it->second.generation != generation) {
+        return false; // not found, or the id rests again for a later order
+    }
+    cancel_located(price_it, order_id, cancelled_qty);
+    return true;
+}
+
+template <class Level>
+void OrderBook<Level>::cancel_located(typename Index::iterator price_it, id_t order_id, qty_t& cancelled_qty)
+{
+    // the level is found in O(1)
+    const auto& loc = price_it->second; // get locate info
+    if (loc.side == Side::BUY) {
+        cancelled_qty = cancel_in(bids_, loc.bid_it, order_id, loc.slot);
+    } else {
+        cancelled_qty = cancel_in(asks_, loc.ask_it, order_id, loc.slot);
+    }
+    index_.erase(price_it); // remove from index
+}
+
+// ERASE scans the level's contiguous ids and closes the gap; TOMBSTONE marks the slot dead in O(1)
+// and compacts the level once the dead share passes the ratio, which keeps the cost amortized O(1)
+template <class Level>
+template <class Book>
+qty_t OrderBook<Level>::cancel_in(Book& book, typename Book::iterator level_it, id_t order_id, std::uint64_t slot)
+{
+    auto& price_level = level_it->second;
+    qty_t removed_qty = 0;
+    if (cancel_mode_ == CancelMode::TOMBSTONE) {
+        removed_qty = price_level.tombstone(slot);
+        const std::size_t dead = price_level.dead();
+        if (dead >= compact_min_dead && static_cast<double>(dead) >= compact_dead_ratio_ * static_cast<double>(dead + price_level.size())) {
+            compact_level(price_level);
+        }
+    } else {
+        price_level.erase(order_id, removed_qty);
+    }
+    price_level.touch(++version_);
+    if (price_level.empty()) {
+        book.erase(level_it);
+    } // remove empty price level
+    return removed_qty;
+}
+
+template <class Level>
+std::size_t OrderBook<Level>::compact(std::size_t max_levels)
+{
+    std::size_t reclaimed = 0;
+    std::size_t levels = 0;
+    auto skip_clean = [](auto& it, auto end) {
+        while (it != end && it->second.dead() == 0) {++it;}
+    };
+    // best first on both sides, taking turns, so a small budget never starves the asks
+    auto bid_it = bids_.begin();
+    auto ask_it = asks_.begin();
+    bool bid_turn = true;
+    while (max_levels == 0 || levels < max_levels) {
+        skip_clean(bid_it, bids_.end());
+        skip_clean(ask_it, asks_.end());
+        const bool has_bid = bid_it != bids_.end();
+        const bool has_ask = ask_it != asks_.end();
+        if (!has_bid && !has_ask) {break;}
+        if (has_bid && (bid_turn || !has_ask)) {
+            reclaimed += compact_level((bid_it++)->second);
+        } else {
+            reclaimed += compact_level((ask_it++)->second);
+        }
+        bid_turn = !bid_turn;
+        ++levels;
+    }
+    return reclaimed;
+}
+
+template <class Level>
+mass_cancel_result_t OrderBook<Level>::mass_cancel(const mass_cancel_cmd_t& cmd)
+{
+    mass_cancel_result_t result;
+    const bool on_bids = !cmd.side.has_value() || *cmd.side == Side::BUY;
+    const bool on_asks = !cmd.side.has_value() || *cmd.side == Side::SELL;
+
+    switch (cmd.scope) {
+    case MassCancelScope::SIDE:
+        if (on_bids) {drop_levels(bids_, bids_.begin(), result);}
+        if (on_asks) {drop_levels(asks_, asks_.begin(), result);}
+        break;
+    case MassCancelScope::PRICE:
+        // both books are ordered from best to worst, so "past the price" is the tail from lower_bound
+        if (on_bids) {drop_levels(bids_, bids_.lower_bound(cmd.price), result);}
+        if (on_asks) {drop_levels(asks_, asks_.lower_bound(cmd.price), result);}
+        break;
+    case MassCancelScope::OWNER:
+        if (cmd.owner == NO_OWNER) {break;} // untagged orders are never selected
+        if (on_bids) {drop_owner(bids_, cmd.owner, result);}
+        if (on_asks) {drop_owner(asks_, cmd.owner, result);}
+        break;
+    }
+    return result;
+}
+
+// drop every level from first to the end of the book, with their index entries, in one sweep
+template <class Level>
+template <class Book>
+void OrderBook<Level>::drop_levels(Book& book, typename Book::iterator first, mass_cancel_result_t& result)
+{
+    for (auto it = first; it != book.end(); ++it) {
+        const Level& price_level = it->second;
+        price_level.for_each([this](id_t order_id, qty_t, owner_t) { index_.erase(order_id); });
+        result.cancelled += price_level.size();
+        result.cancelled_qty += price_level.total_qty();
+    }
+    if (first != book.end()) {++version_;}
+    book.erase(first, book.end());
+}
+
+// drop every order of one owner, level by level; empty levels are removed
+template <class Level>
+template <class Book>
+void OrderBook<Level>::drop_owner(Book& book, owner_t owner, mass_cancel_result_t& result)
+{
+    for (auto it = book.begin(); it != book.end();) {
+        auto& price_level = it->second;
+        const std::size_t removed = price_level.erase_if([&](id_t order_id, qty_t quantity, owner_t order_owner) {
+            if (order_owner != owner) {return false;}
+            index_.erase(order_id);
+            result.cancelled_qty += quantity;
+            return true;
+        }, [this](id_t order_id, std::uint64_t slot) { relocate(order_id, slot); });
+        if (removed > 0) {price_level.touch(++version_);}
+        result.cancelled += removed;
+
+        if (price_level.empty()) {
+            it = book.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// One ascending pass over the crossed price range [best ask, best bid] with the cumulative curves:
+// supply(p) = asks priced <= p, demand(p) = bids priced >= p. The clearing price maximizes min(demand, supply),
+// then minimizes |demand - supply|, then is the one closest to the mid of the best prices (the lower one on a tie).
+template <class Level>
+typename OrderBook<Level>::clearing_t OrderBook<Level>::clearing() const
+{
+    if (bids_.empty() || asks_.empty() || bids_.begin()->first < asks_.begin()->first) {
+        return {}; // not crossed
+    }
+    const price_t best_bid = bids_.begin()->first;
+    const price_t best_ask = asks_.begin()->first;
+    const price_t mid2 = best_bid + best_ask; // twice the mid, keeps the distance integral
+
+    // bids priced >= best ask, walked from the lowest up
+    const auto bid_end = bids_.upper_bound(best_ask);
+    qty_t demand = 0;
+    for (auto it = bids_.begin(); it != bid_end; ++it) {demand += it->second.total_qty();}
+    auto bid_it = std::make_reverse_iterator(bid_end);
+    const auto bid_stop = bids_.rend();
+    auto ask_it = asks_.begin();
+    const auto ask_stop = asks_.upper_bound(best_bid);
+    qty_t supply = 0;
+
+    clearing_t best{};
+    auto is_better = [&](price_t px, qty_t volume, qty_t imbalance) {
+        if (volume != best.volume) {return volume > best.volume;}
+        const qty_t abs_imb = imbalance < 0 ? -imbalance : imbalance;
+        const qty_t best_abs_imb = best.imbalance < 0 ? -best.imbalance : best.imbalance;
+        if (abs_imb != best_abs_imb) {return abs_imb < best_abs_imb;}
+        const price_t dist = px * 2 > mid2 ? px * 2 - mid2 : mid2 - px * 2;
+        const price_t best_dist = best.price * 2 > mid2 ? best.price * 2 - mid2 : mid2 - best.price * 2;
+        return dist < best_dist;
+    };
+
+    while (ask_it != ask_stop || bid_it != bid_stop) {
+        const price_t px = (ask_it == ask_stop) ? bid_it->first :
+                           (bid_it == bid_stop) ? ask_it->first : std::min(ask_it->first, bid_it->first);
+        if (ask_it != ask_stop && ask_it->first == px) {
+            supply += ask_it->second.total_qty();
+            ++ask_it;
+        }
+        const qty_t volume = std::min(demand, supply);
+        if (volume > 0 && is_better(px, volume, demand - supply)) {
+            best = clearing_t{.price = px, .volume = volume, .imbalance = demand - supply};
+        }
+        // bids at px no longer count for higher prices
+        if (bid_it != bid_stop && bid_it->first == px) {
+            demand -= bid_it->second.total_qty();
+            ++bid_it;
+        }
+    }
+    return best;
+}
+
+// execute the clearing volume in bulk: both sides are consumed from their best level in FIFO order, all at one price
+template <class Level>
+uncross_result_t OrderBook<Level>::uncross(stamp_t stamp)
+{
+    const clearing_t clear = clearing();
+    uncross_result_t result{.price = clear.price, .volume = clear.volume, .imbalance = clear.imbalance, .trades = {}};
+    if (clear.volume == 0) {return result;}
+
+    const std::uint64_t version = ++version_;
+    qty_t remaining = clear.volume;
+    auto bid_it = bids_.begin();
+    auto ask_it = asks_.begin();
+    while (remaining > 0) {
+        Level& bid_level = bid_it->second;
+        Level& ask_level = ask_it->second;
+        bid_level.touch(version);
+        ask_level.touch(version);
+        const qty_t trade_qty = std::min({remaining, bid_level.front_qty(), ask_level.front_qty()});
+        result.trades.push_back(trade_t{ .taker=bid_level.front_id(), .maker=ask_level.front_id(), .price=clear.price, .qty=trade_qty, .timestamp=stamp.timestamp, .seq=stamp.seq });
+        remaining -= trade_qty;
+
+        if (bid_level.fill_front(trade_qty) == 0) {
+            index_.erase(bid_level.front_id());
+            bid_level.pop_front();
+            if (bid_level.empty()) {bid_it = bids_.erase(bid_it);}
+        }
+        if (ask_level.fill_front(trade_qty) == 0) {
+            index_.erase(ask_level.front_id());
+            ask_level.pop_front();
+            if (ask_level.empty()) {ask_it = asks_.erase(ask_it);}
+        }
+    }
+    return result;
+}
+
+template <class Level>
+snapshot_t OrderBook<Level>::snapshot(int depth) const
+{
+    snapshot_t snap;
+    snap.bids.reserve(depth > 0 ? depth : 10);
+    snap.asks.reserve(depth > 0 ? depth : 10);
+
+    auto bit = bids_.begin();
+    auto ait = asks_.begin();
+
+    for(int i = 0; i < depth; i++)
+    {
+        if(bit != bids_.end())
+        {
+            snap.bids.push_back(snapshot_level_t{bit->first, bit->second.total_qty()});
+            ++bit;
+        }
+        if(ait != asks_.end())
+        {
+            snap.asks.push_back(snapshot_level_t{ait->first, ait->second.total_qty()});
+            ++ait;
+        }
+    }
+
+    return snap;
+}
+
+// Write the top levels of one side into out. A slot is skipped when it already holds the same price
+// and the level has not changed since since_version; a new level at that price always carries a newer version.
+template <class Level>
+template <class Book>
+std::size_t OrderBook<Level>::copy_levels(const Book& book, std::span<snapshot_level_t> out, std::uint64_t since_version, std::size_t& updated)
+{
+    std::size_t count = 0;
+    for (auto it = book.begin(); it != book.end() && count < out.size(); ++it, ++count) {
+        snapshot_level_t& slot = out[count];
+        if (since_version != 0 && slot.price == it->first && it->second.version() <= since_version) {
+            continue; // unchanged
+        }
+        slot = snapshot_level_t{it->first, it->second.total_qty()};
+        ++updated;
+    }
+    // clear stale slots so a later delta never trusts them
+    for (std::size_t i = count; i < out.size(); ++i) {
+        if (out[i].price != 0) {out[i] = snapshot_level_t{};}
+    }
+    return count;
+}
+
+template <class Level>
+snapshot_counts_t OrderBook<Level>::snapshot_into(std::span<snapshot_level_t> bids, std::span<snapshot_level_t> asks, std::uint64_t since_version) const
+{
+    snapshot_counts_t counts{.version = version_};
+    if (since_version != 0 && since_version == version_) {
+        // nothing changed, the caller's buffers are current
+        counts.bids = std::min(bids_.size(), bids.size());
+        counts.asks = std::min(asks_.size(), asks.size());
+        return counts;
+    }
+    counts.bids = copy_levels(bids_, bids, since_version, counts.updated);
+    counts.asks = copy_levels(asks_, asks, since_version, counts.updated);
+    return counts;
+}
+
+template <class Level>
+memory_stats_t OrderBook<Level>::memory_stats() const
+{
+    memory_stats_t stats{
+        .bid_levels = bids_.size(),
+        .ask_levels = asks_.size(),
+        .index_entries = index_.size(),
+        .index_buckets = index_.bucket_count(),
+        .levels = level_memory_.usage(),
+        .queues = queue_memory_.usage(),
+        .index = index_memory_.usage(),
+    };
+    auto count_levels = [&stats](const auto& book) {
+        for (const auto& [price, price_level] : book) {
+            stats.resting_orders += price_level.size();
+            stats.queue_slots += price_level.capacity();
+            stats.tombstones += price_level.dead();
+        }
+    };
+    count_levels(bids_);
+    count_levels(asks_);
+    return stats;
+}
+
+template class OrderBook<AosLevel>;
+template class OrderBook<SoaLevel>;
+
+} // namespace engine
@@ -0,0 +1,509 @@
+#pragma once
+
+#include <libs/engine/engine.hpp>
+#include "counting_resource.hpp"
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+namespace engine {
+
+/**
+ * @brief engine::stamp_t is the engine time and sequence number of the command being matched, copied onto each trade it produces.
+ *
+ */
+struct stamp_t {
+    std::uint64_t timestamp{}; ///< engine clock reading
+    std::uint64_t seq{}; ///< command sequence number
+};
+
+/**
+ * @brief engine::execution_t collects what matching one taker order produced. report selects whether maker fills are kept as trades, aggregated into one level_fill_t per level, or both; sink, if set, sees every maker fill either way. The filled quantity and the number of maker fills are summed as matching goes, so the engine never walks the trades again.
+ *
+ */
+struct execution_t {
+    FillReport report{FillReport::TRADES}; ///< what is collected
+    IFillSink* sink{nullptr}; ///< optional: every maker fill
+    std::vector<trade_t> trades; ///< per maker fill (TRADES, BOTH)
+    std::vector<level_fill_t> levels; ///< per price level (LEVELS, BOTH)
+    qty_t filled_qty{0}; ///< total quantity filled
+    std::uint64_t fills{0}; ///< maker fills, whatever is collected
+};
+
+// ------------Resting order storage---------
+
+/**
+ * @brief engine::resting_order_t is the compact record kept for an order resting in the book. Side and price are implied by the level that holds it, and time priority is implied by its position in the level queue, so only the id and the open quantity are stored.
+ *
+ */
+struct resting_order_t {
+    id_t id{}; ///< unique order identifier
+    qty_t qty{}; ///< open quantity
+};
+
+static_assert(sizeof(resting_order_t) == 16, "resting_order_t should stay 4 per cache line");
+
+/**
+ * @brief engine::level_base_t holds the bookkeeping shared by both level layouts: the logical head of the FIFO queue, the aggregated open quantity, and the owner tags. Owner tags are kept in their own cold array because matching never reads them. All level storage comes from the memory resource the book hands in.
+ *
+ * Every order gets a slot number when it joins the queue. Slot numbers survive dropping the consumed prefix, so CancelMode::TOMBSTONE can find an order in O(1) and mark it dead (open quantity 0) in place. A tombstone never stays at the front: it is skipped as soon as it gets there, so matching only ever sees live orders. Compaction removes the tombstones in between and reports every order whose slot number changed.
+ *
+ */
+class level_base_t {
+public:
+    explicit level_base_t(std::pmr::memory_resource* resource) : owners_(resource) {}
+
+    qty_t total_qty() const noexcept { return total_qty_; } ///< aggregated open quantity of the level
+    std::uint64_t version() const noexcept { return version_; } ///< book version of the last change to this level
+    void touch(std::uint64_t book_version) noexcept { version_ = book_version; }
+    std::size_t dead() const noexcept { return dead_; } ///< tombstones still holding a slot
+
+protected:
+    // consumed entries are left in front of head_ and dropped in bulk, so pop_front is O(1) amortized
+    static constexpr std::size_t compact_min_head = 64;
+
+    std::pmr::vector<owner_t> owners_;
+    std::size_t head_{0};
+    std::size_t dead_{0};
+    std::uint64_t base_{0}; // slot number of storage position 0
+    qty_t total_qty_{0};
+    std::uint64_t version_{0};
+};
+
+/**
+ * @brief engine::AosLevel stores a price level as one contiguous array of resting_order_t records (array of structures).
+ *
+ */
+class AosLevel : public level_base_t {
+public:
+    explicit AosLevel(std::pmr::memory_resource* resource) : level_base_t(resource), orders_(resource) {}
+
+    bool empty() const noexcept { return head_ == orders_.size(); }
+    std::size_t size() const noexcept { return orders_.size() - head_ - dead_; } ///< live orders
+    std::size_t capacity() const noexcept { return orders_.capacity(); } ///< allocated order slots, including consumed ones
+
+    id_t front_id() const noexcept { return orders_[head_].id; }
+    qty_t front_qty() const noexcept { return orders_[head_].qty; }
+
+    // returns the slot number of the new order
+    std::uint64_t push_back(id_t order_id, qty_t quantity, owner_t owner_tag)
+    {
+        orders_.push_back(resting_order_t{.id=order_id, .qty=quantity});
+        owners_.push_back(owner_tag);
+        total_qty_ += quantity;
+        return base_ + orders_.size() - 1;
+    }
+
+    // reduce the front order by a fill, returns its remaining quantity
+    qty_t fill_front(qty_t quantity) noexcept
+    {
+        total_qty_ -= quantity;
+        return orders_[head_].qty -= quantity;
+    }
+
+    void pop_front()
+    {
+        total_qty_ -= orders_[head_].qty;
+        ++head_;
+        trim_front();
+    }
+
+    // find an order by id and remove it, keeping FIFO order of the others
+    bool erase(id_t order_id, qty_t& removed_qty)
+    {
+        for (std::size_t i = head_; i < orders_.size(); ++i) {
+            if (orders_[i].id == order_id) {
+                removed_qty = orders_[i].qty;
+                total_qty_ -= removed_qty;
+                orders_.erase(orders_.begin() + static_cast<std::ptrdiff_t>(i));
+                owners_.erase(owners_.begin() + static_cast<std::ptrdiff_t>(i));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // mark the order in slot dead without moving anything, returns its open quantity
+    qty_t tombstone(std::uint64_t slot)
+    {
+        const std::size_t pos = slot - base_;
+        const qty_t removed_qty = orders_[pos].qty;
+        total_qty_ -= removed_qty;
+        orders_[pos].qty = 0;
+        ++dead_;
+        if (pos == head_) {trim_front();}
+        return removed_qty;
+    }
+
+    // remove every order for which pred(id, qty, owner) holds, together with the tombstones and the consumed prefix;
+    // moved(id, slot) is called for each kept order whose slot number changed. Returns the number of orders removed
+    template <class Pred, class Moved>
+    std::size_t erase_if(Pred pred, Moved moved)
+    {
+        const std::size_t first = head_;
+        base_ += first;
+        std::size_t out = 0;
+        std::size_t removed = 0;
+        for (std::size_t i = first; i < orders_.size(); ++i) {
+            if (orders_[i].qty == 0) {continue;} // tombstone
+            if (pred(orders_[i].id, orders_[i].qty, owners_[i])) {
+                total_qty_ -= orders_[i].qty;
+                ++removed;
+                continue;
+            }
+            if (out != i) {
+                orders_[out] = orders_[i];
+                owners_[out] = owners_[i];
+            }
+            if (out != i - first) {moved(orders_[out].id, base_ + out);}
+            ++out;
+        }
+        orders_.resize(out);
+        owners_.resize(out);
+        head_ = 0;
+        dead_ = 0;
+        return removed;
+    }
+
+    // drop every tombstone, returns the number of slots reclaimed
+    template <class Moved>
+    std::size_t compact(Moved moved)
+    {
+        const std::size_t reclaimed = dead_;
+        erase_if([](id_t, qty_t, owner_t) { return false; }, moved);
+        return reclaimed;
+    }
+
+    // visit every live order as fn(id, qty, owner) in FIFO order
+    template <class Fn>
+    void for_each(Fn fn) const
+    {
+        for (std::size_t i = head_; i < orders_.size(); ++i) {
+            if (orders_[i].qty != 0) {fn(orders_[i].id, orders_[i].qty, owners_[i]);}
+        }
+    }
+
+private:
+    std::pmr::vector<resting_order_t> orders_;
+
+    // skip tombstones that reached the front, then drop the consumed prefix once it is large
+    void trim_front()
+    {
+        while (head_ < orders_.size() && orders_[head_].qty == 0) {
+            ++head_;
+            --dead_;
+        }
+        if (head_ == orders_.size()) {
+            base_ += head_;
+            orders_.clear();
+            owners_.clear();
+            head_ = 0;
+        } else if (head_ >= compact_min_head && head_ * 2 >= orders_.size()) {
+            orders_.erase(orders_.begin(), orders_.begin() + static_cast<std::ptrdiff_t>(head_));
+            owners_.erase(owners_.begin(), owners_.begin() + static_cast<std::ptrdiff_t>(head_));
+            base_ += head_;
+            head_ = 0;
+        }
+    }
+};
+
+/**
+ * @brief engine::SoaLevel stores a price level as parallel id and quantity arrays (structure of arrays), so matching and aggregation stream through contiguous quantities, 8 per cache line.
+ *
+ */
+class SoaLevel : public level_base_t {
+public:
+    explicit SoaLevel(std::pmr::memory_resource* resource) : level_base_t(resource), ids_(resource), qtys_(resource) {}
+
+    bool empty() const noexcept { return head_ == qtys_.size(); }
+    std::size_t size() const noexcept { return qtys_.size() - head_ - dead_; } ///< live orders
+    std::size_t capacity() const noexcept { return qtys_.capacity(); } ///< allocated order slots, including consumed ones
+
+    id_t front_id() const noexcept { return ids_[head_]; }
+    qty_t front_qty() const noexcept { return qtys_[head_]; }
+
+    // returns the slot number of the new order
+    std::uint64_t push_back(id_t order_id, qty_t quantity, owner_t owner_tag)
+    {
+        ids_.push_back(order_id);
+        qtys_.push_back(quantity);
+        owners_.push_back(owner_tag);
+        total_qty_ += quantity;
+        return base_ + qtys_.size() - 1;
+    }
+
+    // reduce the front order by a fill, returns its remaining quantity
+    qty_t fill_front(qty_t quantity) noexcept
+    {
+        total_qty_ -= quantity;
+        return qtys_[head_] -= quantity;
+    }
+
+    void pop_front()
+    {
+        total_qty_ -= qtys_[head_];
+        ++head_;
+        trim_front();
+    }
+
+    // find an order by id and remove it, keeping FIFO order of the others
+    bool erase(id_t order_id, qty_t& removed_qty)
+    {
+        for (std::size_t i = head_; i < ids_.size(); ++i) {
+            if (ids_[i] == order_id) {
+                removed_qty = qtys_[i];
+                total_qty_ -= removed_qty;
+                const auto pos = static_cast<std::ptrdiff_t>(i);
+                ids_.erase(ids_.begin() + pos);
+                qtys_.erase(qtys_.begin() + pos);
+                owners_.erase(owners_.begin() + pos);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // mark the order in slot dead without moving anything, returns its open quantity
+    qty_t tombstone(std::uint64_t slot)
+    {
+        const std::size_t pos = slot - base_;
+        const qty_t removed_qty = qtys_[pos];
+        total_qty_ -= removed_qty;
+        qtys_[pos] = 0;
+        ++dead_;
+        if (pos == head_) {trim_front();}
+        return removed_qty;
+    }
+
+    // remove every order for which pred(id, qty, owner) holds, together with the tombstones and the consumed prefix;
+    // moved(id, slot) is called for each kept order whose slot number changed. Returns the number of orders removed
+    template <class Pred, class Moved>
+    std::size_t erase_if(Pred pred, Moved moved)
+    {
+        const std::size_t first = head_;
+        base_ += first;
+        std::size_t out = 0;
+        std::size_t removed = 0;
+        for (std::size_t i = first; i < qtys_.size(); ++i) {
+            if (qtys_[i] == 0) {continue;} // tombstone
+            if (pred(ids_[i], qtys_[i], owners_[i])) {
+                total_qty_ -= qtys_[i];
+                ++removed;
+                continue;
+            }
+            if (out != i) {
+                ids_[out] = ids_[i];
+                qtys_[out] = qtys_[i];
+                owners_[out] = owners_[i];
+            }
+            if (out != i - first) {moved(ids_[out], base_ + out);}
+            ++out;
+        }
+        ids_.resize(out);
+        qtys_.resize(out);
+        owners_.resize(out);
+        head_ = 0;
+        dead_ = 0;
+        return removed;
+    }
+
+    // drop every tombstone, returns the number of slots reclaimed
+    template <class Moved>
+    std::size_t compact(Moved moved)
+    {
+        const std::size_t reclaimed = dead_;
+        erase_if([](id_t, qty_t, owner_t) { return false; }, moved);
+        return reclaimed;
+    }
+
+    // visit every live order as fn(id, qty, owner) in FIFO order
+    template <class Fn>
+    void for_each(Fn fn) const
+    {
+        for (std::size_t i = head_; i < qtys_.size(); ++i) {
+            if (qtys_[i] != 0) {fn(ids_[i], qtys_[i], owners_[i]);}
+        }
+    }
+
+private:
+    std::pmr::vector<id_t> ids_;
+    std::pmr::vector<qty_t> qtys_;
+
+    // skip tombstones that reached the front, then drop the consumed prefix once it is large
+    void trim_front()
+    {
+        while (head_ < qtys_.size() && qtys_[head_] == 0) {
+            ++head_;
+            --dead_;
+        }
+        if (head_ == qtys_.size()) {
+            base_ += head_;
+            ids_.clear();
+            qtys_.clear();
+            owners_.clear();
+            head_ = 0;
+        } else if (head_ >= compact_min_head && head_ * 2 >= qtys_.size()) {
+            const auto count = static_cast<std::ptrdiff_t>(head_);
+            ids_.erase(ids_.begin(), ids_.begin() + count);
+            qtys_.erase(qtys_.begin(), qtys_.begin() + count);
+            owners_.erase(owners_.begin(), owners_.begin() + count);
+            base_ += head_;
+            head_ = 0;
+        }
+    }
+};
+
+// ------------order_t Book---------
+/**
+ * @brief engine::OrderBook keeps both sides of one instrument as price-ordered maps of levels, plus an id index for cancels. Level is the storage layout of a price level (AosLevel or SoaLevel). Level map nodes, level queues and the index each allocate through their own CountingResource on top of the upstream resource, which is what memory_stats() reports. With CancelMode::TOMBSTONE a cancel marks the order dead through the slot kept in the index, and a level is compacted once compact_dead_ratio of its slots are dead, or by compact() when the caller is idle.
+ *
+ */
+template <class Level>
+class OrderBook {
+public:
+    explicit OrderBook(std::pmr::memory_resource* upstream = std::pmr::get_default_resource(),
+                       CancelMode cancel_mode = CancelMode::ERASE, double compact_dead_ratio = 0.5)
+        : cancel_mode_(cancel_mode), compact_dead_ratio_(compact_dead_ratio),
+          level_memory_(upstream), queue_memory_(upstream), index_memory_(upstream),
+          bids_(&level_memory_), asks_(&level_memory_), index_(&index_memory_) {}
+
+    OrderBook(const OrderBook&) = delete;
+    OrderBook& operator=(const OrderBook&) = delete;
+
+    // only use side, price, qty, id, owner from order
+    void add_limit(order_t order, TimeInForce tif, stamp_t stamp, execution_t& exec);
+    void add_market(order_t order, stamp_t stamp, std::uint16_t max_levels, execution_t& exec, bool& empty_book);
+    bool cancel(id_t order_id);
+    bool cancel(id_t order_id, qty_t& cancelled_qty);
+    // only the order that rested with this generation; a reused id that rests again has another one
+    bool cancel(id_t order_id, std::uint32_t generation, qty_t& cancelled_qty);
+    // generation of the order rest() placed last
+    std::uint32_t last_rest() const noexcept { return rests_; }
+    mass_cancel_result_t mass_cancel(const mass_cancel_cmd_t& cmd);
+    // add to the book without matching (auction collection); the book may become crossed
+    void rest(const order_t& order);
+    uncross_result_t uncross(stamp_t stamp);
+
+    snapshot_t snapshot(int depth) const;
+    // since_version == 0 writes every level; otherwise only levels changed after since_version
+    snapshot_counts_t snapshot_into(std::span<snapshot_level_t> bids, std::span<snapshot_level_t> asks, std::uint64_t since_version) const;
+
+    // for FOK (Fill-Or-Kill) check
+    qty_t available_to_buy_up_to(price_t price) const;
+    qty_t available_to_sell_down_to(price_t price) const;
+    qty_t available_market(Side side, std::uint16_t max_levels) const;
+
+    memory_stats_t memory_stats() const;
+    // compact up to max_levels levels holding tombstones (0 = all), returns the slots reclaimed
+    std::size_t compact(std::size_t max_levels);
+    void reserve(std::size_t orders) { index_.reserve(orders); }
+
+private:
+    using BidBook = std::pmr::map<price_t, Level, std::greater<>>; // Bid price type
+    using AskBook = std::pmr::map<price_t, Level, std::less<> >;   // Ask price type
+
+    /**
+     * @brief locate_t points from an order id to the price level holding it. Map iterators stay valid until their level is erased, so the level is found in O(1); the order is then found by a scan over the level's contiguous ids, or directly by its slot with CancelMode::TOMBSTONE.
+     *
+     */
+    struct locate_t {
+        Side side; ///< side of the order (BUY or SELL)
+        std::uint32_t generation; ///< rest() count when the order rested, tells apart orders that reuse an id (fits the padding after side)
+        typename BidBook::iterator bid_it; ///< point to price node (iterator) in bid book
+        typename AskBook::iterator ask_it; ///< point to price node (iterator) in ask book
+        std::uint64_t slot; ///< slot number of the order in its level, kept current by compaction
+    };
+
+    // levels with fewer tombstones are never compacted by a cancel
+    static constexpr std::size_t compact_min_dead = 8;
+
+    CancelMode cancel_mode_;
+    double compact_dead_ratio_;
+
+    // declared before the containers that allocate from them
+    CountingResource level_memory_; // level map nodes of both sides
+    CountingResource queue_memory_; // order storage inside the levels
+    CountingResource index_memory_; // id index nodes and buckets
+
+    BidBook bids_;
+    AskBook asks_;
+    using Index = std::pmr::unordered_map<id_t, locate_t>;
+    Index index_; // order id -> price level
+    std::uint64_t version_{0}; // bumped on every change, stamped on the changed level
+    std::uint32_t rests_{0}; // orders rested so far, wraps
+
+    /**
+     * @brief clearing_t is the auction price chosen by clearing(), with its executable volume and imbalance.
+     *
+     */
+    struct clearing_t {
+        price_t price{0}; ///< clearing price, 0 when the book is not crossed
+        qty_t volume{0}; ///< min(demand, supply) at price
+        qty_t imbalance{0}; ///< demand - supply at price
+    };
+    clearing_t clearing() const;
+
+    template <class Book>
+    static std::size_t copy_levels(const Book& book, std::span<snapshot_level_t> out, std::uint64_t since_version, std::size_t& updated);
+
+    template <class Book>
+    void drop_levels(Book& book, typename Book::iterator first, mass_cancel_result_t& result);
+
+    template <class Book>
+    void drop_owner(Book& book, owner_t owner, mass_cancel_result_t& result);
+
+    void cancel_located(typename Index::iterator price_it, id_t order_id, qty_t& cancelled_qty);
+
+    template <class Book>
+    qty_t cancel_in(Book& book, typename Book::iterator level_it, id_t order_id, std::uint64_t slot);
+
+    // keep the index slot of an order that compaction moved; only tombstone cancels read it
+    void relocate(id_t order_id, std::uint64_t slot)
+    {
+        if (cancel_mode_ == CancelMode::TOMBSTONE) {index_.find(order_id)->second.slot = slot;}
+    }
+
+    std::size_t compact_level(Level& level)
+    {
+        return level.compact([this](id_t order_id, std::uint64_t slot) { relocate(order_id, slot); });
+    }
+
+    void match_level(order_t& in_order, Level& level, price_t level_px, execution_t& exec, stamp_t stamp)
+    {
+        level.touch(++version_);
+        const qty_t start_qty = in_order.qty;
+        const bool keep_trades = exec.report != FillReport::LEVELS;
+        std::uint32_t makers = 0;
+        // tombstones never sit at the front, pop_front skips them
+        while (in_order.qty > 0 && !level.empty()) {
+            // pick up the top order in the same price level
+            const qty_t trade_qty = std::min(in_order.qty, level.front_qty());
+            if (keep_trades || exec.sink != nullptr) {
+                const trade_t trade{ .taker=in_order.id, .maker=level.front_id(), .price=level_px, .qty=trade_qty, .timestamp=stamp.timestamp, .seq=stamp.seq };
+                if (keep_trades) {exec.trades.push_back(trade);}
+                if (exec.sink != nullptr) {exec.sink->on_fill(trade);}
+            }
+            ++makers;
+            // update in order quantity. Later can be decided whether it has to be added in order list
+            in_order.qty -= trade_qty;
+            if (level.fill_front(trade_qty) == 0) {
+                index_.erase(level.front_id());
+                level.pop_front();
+            }
+        }
+        if (makers == 0) {return;}
+        exec.filled_qty += start_qty - in_order.qty;
+        exec.fills += makers;
+        if (exec.report != FillReport::TRADES) {
+            exec.levels.push_back(level_fill_t{ .price=level_px, .qty=start_qty - in_order.qty, .makers=makers });
+        }
+    }
+};
+
+extern template class OrderBook<AosLevel>;
+extern template class OrderBook<SoaLevel>;
+
+} // namespace engine
@@ -0,0 +1,209 @@
+#include <libs/engine/replica.hpp>
+#include <libs/engine/clock.hpp>
+#include <libs/concurrency/single_writer.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace engine {
+
+namespace {
+// commands that leave the book as it was are not forwarded
+bool changed_book(OrderStatus status)
+{
+    return status != OrderStatus::BAD_INPUT && status != OrderStatus::REJECT &&
+           status != OrderStatus::FOK_FAIL && status != OrderStatus::EMPTY_BOOK;
+}
+
+engine_config_t replica_config(engine_config_t config)
+{
+    config.publisher = nullptr;
+    config.memory_resource = nullptr; // an arena is single-threaded and belongs to the primary
+    config.warmup_orders = 0;
+    config.clock = ClockSource::CALLER; // runs on the primary's engine time, carried by every command
+    config.fill_sink = nullptr; // maker fills are reported once, by the primary
+    config.fill_report = FillReport::LEVELS; // its results are dropped, so keep the least
+    return config;
+}
+} // namespace
+
+// the clock is calibrated here rather than on the first forward
+ReplicatedEngine::ReplicatedEngine(const engine_config_t& config, std::size_t capacity_pow2)
+    : primary_(make_engine(config)), replica_(make_engine(replica_config(config))), commands_(capacity_pow2)
+{
+    TscClock::instance();
+}
+
+void ReplicatedEngine::start()
+{
+    if (running_.exchange(true)) {return;} // already running
+    thread_ = std::thread([this] { run(); });
+}
+
+void ReplicatedEngine::stop()
+{
+    if (running_.exchange(false)) {thread_.join();}
+    apply_pending(); // the spill queue never reaches the replica thread once it is gone
+}
+
+// ------------Matching thread---------
+add_result_t ReplicatedEngine::add_order(const order_cmd_t& cmd)
+{
+    auto result = primary_->add_order(cmd);
+    if (changed_book(result.status)) {
+        replica_cmd_t forwarded{.op = ReplicaOp::ADD, .order = cmd};
+        forwarded.order.order_id = result.order_id;
+        forwarded.order.timestamp = primary_->engine_time();
+        forwarded.order.trace = nullptr; // the stamps belong to the primary's caller
+        forward(forwarded);
+    }
+    return result;
+}
+
+bool ReplicatedEngine::cancel_order(id_t order_id)
+{
+    const bool is_ok = primary_->cancel_order(order_id);
+    if (is_ok) {forward(replica_cmd_t{.op = ReplicaOp::CANCEL, .cancel_id = order_id});}
+    return is_ok;
+}
+
+mass_cancel_result_t ReplicatedEngine::mass_cancel(const mass_cancel_cmd_t& cmd)
+{
+    auto result = primary_->mass_cancel(cmd);
+    if (result.cancelled > 0) {forward(replica_cmd_t{.op = ReplicaOp::MASS_CANCEL, .mass = cmd});}
+    return result;
+}
+
+mass_cancel_result_t ReplicatedEngine::expire_orders(std::uint64_t now)
+{
+    auto result = primary_->expire_orders(now);
+    if (result.cancelled > 0) {forward(replica_cmd_t{.op = ReplicaOp::EXPIRE, .engine_time = now});}
+    return result;
+}
+
+uncross_result_t ReplicatedEngine::uncross()
+{
+    auto result = primary_->uncross();
+    if (result.volume > 0) {forward(replica_cmd_t{.op = ReplicaOp::UNCROSS});}
+    return result;
+}
+
+uncross_result_t ReplicatedEngine::set_matching_mode(MatchingMode mode)
+{
+    auto result = primary_->set_matching_mode(mode);
+    forward(replica_cmd_t{.op = ReplicaOp::SET_MODE, .mode = mode});
+    return result;
+}
+
+// never waits: a full ring parks the command in the spill queue, behind any already parked
+void ReplicatedEngine::forward(replica_cmd_t cmd)
+{
+    cmd.engine_time = std::max(cmd.engine_time, primary_->engine_time());
+    cmd.sent_ticks = TscClock::ticks();
+    concurrency::bump(forwarded_, 1, std::memory_order_release); // counted before the push, so applied never passes it
+    drain_spill();
+    if (spill_head_ == spill_.size() && commands_.push(cmd)) {return;}
+    spill_.push_back(cmd);
+    concurrency::bump(spilled_);
+    backlog_.store(spill_.size() - spill_head_, std::memory_order_relaxed);
+}
+
+// hand parked commands to the ring in order, as many as fit
+void ReplicatedEngine::drain_spill()
+{
+    if (spill_head_ == spill_.size()) {return;}
+    while (spill_head_ < spill_.size() && commands_.push(spill_[spill_head_])) {++spill_head_;}
+    if (spill_head_ == spill_.size()) {
+        spill_.clear(); // keeps its capacity for the next burst
+        spill_head_ = 0;
+    } else if (spill_head_ >= spill_.size() / 2) {
+        spill_.erase(spill_.begin(), spill_.begin() + static_cast<std::ptrdiff_t>(spill_head_));
+        spill_head_ = 0;
+    }
+    backlog_.store(spill_.size() - spill_head_, std::memory_order_relaxed);
+}
+
+// no replica thread: the ring, then the spill queue, applied on the matching thread
+void ReplicatedEngine::apply_pending()
+{
+    std::vector<replica_cmd_t> batch(batch_size);
+    std::size_t num = 0;
+    while ((num = commands_.try_pop_n(batch.data(), batch.size())) > 0) {apply_batch(batch.data(), num);}
+    if (spill_head_ < spill_.size()) {apply_batch(spill_.data() + spill_head_, spill_.size() - spill_head_);}
+    spill_.clear();
+    spill_head_ = 0;
+    backlog_.store(0, std::memory_order_relaxed);
+}
+
+void ReplicatedEngine::sync()
+{
+    const std::uint64_t target = forwarded_.load(std::memory_order_relaxed);
+    while (applied_.load(std::memory_order_acquire) < target) {
+        drain_spill();
+        if (!running_.load(std::memory_order_acquire)) {
+            apply_pending();
+            break;
+        }
+        std::this_thread::yield();
+    }
+}
+
+// ------------Any thread---------
+replica_stats_t ReplicatedEngine::replica_stats() const
+{
+    const double ns_per_tick = TscClock::instance().ns_per_tick();
+    // applied first: forwarded is read later, so lag_commands() never underflows
+    const std::uint64_t applied = applied_.load(std::memory_order_acquire);
+    return replica_stats_t{
+        .forwarded = forwarded_.load(std::memory_order_acquire),
+        .applied = applied,
+        .last_lag_ns = static_cast<std::uint64_t>(static_cast<double>(last_lag_ticks_.load(std::memory_order_relaxed)) * ns_per_tick),
+        .max_lag_ns = static_cast<std::uint64_t>(static_cast<double>(max_lag_ticks_.load(std::memory_order_relaxed)) * ns_per_tick),
+        .spilled = spilled_.load(std::memory_order_relaxed),
+        .backlog = backlog_.load(std::memory_order_relaxed),
+    };
+}
+
+// ------------Replica thread---------
+void ReplicatedEngine::apply(const replica_cmd_t& cmd)
+{
+    replica_->expire_orders(cmd.engine_time); // what the primary had expired by the time of the command
+    switch (cmd.op) {
+    case ReplicaOp::ADD: replica_->add_order(cmd.order); break;
+    case ReplicaOp::CANCEL: replica_->cancel_order(cmd.cancel_id); break;
+    case ReplicaOp::MASS_CANCEL: replica_->mass_cancel(cmd.mass); break;
+    case ReplicaOp::UNCROSS: replica_->uncross(); break;
+    case ReplicaOp::SET_MODE: replica_->set_matching_mode(cmd.mode); break;
+    case ReplicaOp::EXPIRE: break; // done above
+    }
+}
+
+// a batch is applied under one exclusive lock, so readers see whole batches and take the lock rarely
+void ReplicatedEngine::run()
+{
+    std::vector<replica_cmd_t> batch(batch_size);
+    while (true) {
+        const std::size_t num = commands_.try_pop_n(batch.data(), batch.size());
+        if (num == 0) {
+            // the matching thread calls stop() after its last forward, so an empty ring is final once stopped
+            if (!running_.load(std::memory_order_acquire) && commands_.approx_size() == 0) {break;}
+            std::this_thread::yield();
+            continue;
+        }
+        apply_batch(batch.data(), num);
+    }
+}
+
+// the consumer side of the ring: the replica thread, or the matching thread while there is none
+void ReplicatedEngine::apply_batch(const replica_cmd_t* batch, std::size_t num)
+{
+    {
+        std::unique_lock lock(replica_mutex_);
+        for (std::size_t i = 0; i < num; ++i) {apply(batch[i]);}
+    }
+    const std::uint64_t lag = TscClock::ticks() - batch[0].sent_ticks;
+    last_lag_ticks_.store(lag, std::memory_order_relaxed);
+    if (lag > max_lag_ticks_.load(std::memory_order_relaxed)) {max_lag_ticks_.store(lag, std::memory_order_relaxed);}
+    concurrency::bump(applied_, num, std::memory_order_release); // one consumer at a time
+}
+
+}  // namespace engine
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <libs/engine/engine.hpp>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+namespace engine {
+
+/**
+ * @brief engine::TimingWheel tracks the expiry times of GTD orders as a hierarchical timing wheel over the whole 64-bit engine time line: 11 levels of 64 slots, where level l keeps deadlines that agree with the current time above bit 6(l+1) and its slot is bits 6l..6l+5 of the deadline. schedule() links an entry into the level of the highest bit in which its deadline differs from the current time, O(1). advance() finds the next occupied slot through one 64-bit occupancy mask per level, fires a level 0 slot as a batch and cascades a higher one towards level 0, so a time jump of any size costs one step per occupied slot rather than one per tick. Entries are not unlinked when their order fills or is cancelled first. Each entry carries the generation the book gave the order when it rested, and the engine cancels only the order that rested with it, so an entry whose order left the book fires harmlessly even after its id was reused. Entries come from a pooled free list, so a steady flow of GTD orders schedules without allocating.
+ *
+ */
+class TimingWheel {
+public:
+    static constexpr unsigned slot_bits = 6;
+    static constexpr std::size_t slots = std::size_t{1} << slot_bits;
+    static constexpr std::size_t levels = 11; // 66 bits cover every uint64_t deadline
+
+    explicit TimingWheel(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : entries_(resource) { heads_.fill(npos); }
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    std::uint64_t now() const noexcept { return now_; } ///< time of the last advance
+    std::size_t size() const noexcept { return size_; } ///< entries waiting, including those whose order already left the book
+
+    // a deadline at or before now() fires on the next advance
+    void schedule(id_t order_id, std::uint32_t generation, std::uint64_t deadline)
+    {
+        std::uint32_t entry = free_;
+        if (entry != npos) {
+            free_ = entries_[entry].next;
+            entries_[entry] = entry_t{.order_id = order_id, .deadline = deadline, .generation = generation};
+        } else {
+            entry = static_cast<std::uint32_t>(entries_.size());
+            entries_.push_back(entry_t{.order_id = order_id, .deadline = deadline, .generation = generation});
+        }
+        link(entry);
+        ++size_;
+    }
+
+    // move time forward to now and call fire(order_id, generation) for every entry due at or before it; time never goes back
+    template <class Fire>
+    std::size_t advance(std::uint64_t now, Fire fire)
+    {
+        std::size_t fired = 0;
+        std::size_t level = 0;
+        std::size_t slot = 0;
+        std::uint64_t start = 0;
+        while (next_slot(level, slot, start) && start <= now) {
+            now_ = start;
+            std::uint32_t entry = std::exchange(heads_[level * slots + slot], npos);
+            occupied_[level] &= ~(std::uint64_t{1} << slot);
+            while (entry != npos) {
+                const std::uint32_t next = entries_[entry].next;
+                if (entries_[entry].deadline <= now) {
+                    fire(entries_[entry].order_id, entries_[entry].generation);
+                    release(entry);
+                    ++fired;
+                } else {
+                    link(entry); // lands on a lower level, relative to the slot start
+                }
+                entry = next;
+            }
+        }
+        if (now > now_) {now_ = now;}
+        return fired;
+    }
+
+    void clear() noexcept
+    {
+        heads_.fill(npos);
+        occupied_.fill(0);
+        entries_.clear();
+        free_ = npos;
+        size_ = 0;
+        now_ = 0;
+    }
+
+private:
+    static constexpr std::uint32_t npos = ~std::uint32_t{0};
+
+    struct entry_t {
+        id_t order_id{0}; ///< order to expire
+        std::uint64_t deadline{0}; ///< engine time it expires at
+        std::uint32_t next{npos}; ///< next entry in the same slot or in the free list
+        std::uint32_t generation{0}; ///< OrderBook generation of the order when it rested
+    };
+
+    std::array<std::uint32_t, levels * slots> heads_{}; // first entry per slot
+    std::array<std::uint64_t, levels> occupied_{}; // bit s set: slot s of the level holds entries
+    std::pmr::vector<entry_t> entries_;
+    std::uint32_t free_{npos};
+    std::size_t size_{0};
+    std::uint64_t now_{0};
+
+    void link(std::uint32_t entry) noexcept
+    {
+        const std::uint64_t key = entries_[entry].deadline > now_ ? entries_[entry].deadline : now_;
+        const std::uint64_t diff = key ^ now_;
+        const std::size_t level = diff == 0 ? 0 : static_cast<std::size_t>(63 - std::countl_zero(diff)) / slot_bits;
+        const std::size_t slot = (key >> (level * slot_bits)) & (slots - 1);
+        entries_[entry].next = heads_[level * slots + slot];
+        heads_[level * slots + slot] = entry;
+        occupied_[level] |= std::uint64_t{1} << slot;
+    }
+
+    void release(std::uint32_t entry) noexcept
+    {
+        entries_[entry].next = free_;
+        free_ = entry;
+        --size_;
+    }
+
+    // earliest occupied slot and the time it starts; the lowest occupied level always holds the earliest one
+    bool next_slot(std::size_t& level, std::size_t& slot, std::uint64_t& start) const noexcept
+    {
+        for (level = 0; level < levels; ++level) {
+            const unsigned shift = static_cast<unsigned>(level) * slot_bits;
+            const std::uint64_t pending = occupied_[level] & (~std::uint64_t{0} << ((now_ >> shift) & (slots - 1)));
+            if (pending == 0) {continue;}
+            slot = static_cast<std::size_t>(std::countr_zero(pending));
+            const unsigned above = shift + slot_bits;
+            const std::uint64_t base = above >= 64 ? 0 : (now_ >> above) << above;
+            start = base | (static_cast<std::uint64_t>(slot) << shift);
+            return true;
+        }
+        return false;
+    }
+};
+
+} // namespace engine
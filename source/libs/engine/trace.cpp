@@ -0,0 +1,98 @@
+#include <libs/engine/trace.hpp>
+
+namespace engine {
+
+trace_stats_t& trace_stats_t::operator+=(const trace_stats_t& other) noexcept
+{
+    traced += other.traced;
+    dumped += other.dumped;
+    auto add = [](latency_histogram_t& into, const latency_histogram_t& from) {
+        for (std::size_t i = 0; i < latency_buckets; ++i) {into.counts[i] += from.counts[i];}
+        into.sum_ns += from.sum_ns;
+    };
+    for (std::size_t s = 0; s < trace_stages; ++s) {add(stage[s], other.stage[s]);}
+    add(total, other.total);
+    return *this;
+}
+
+// ------------Recorder---------
+TraceRecorder::TraceRecorder(const std::string& dump_path, std::uint32_t sample_every)
+    : clock_(TscClock::instance()), sample_every_(sample_every == 0 ? 1 : sample_every), until_sample_(sample_every_)
+{
+    if (dump_path.empty()) {return;}
+    dump_ = std::fopen(dump_path.c_str(), "wb");
+    if (dump_ == nullptr) {return;}
+    const trace_file_header_t header{.sample_every = sample_every_};
+    std::fwrite(&header, sizeof(header), 1, dump_);
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    if (dump_ != nullptr) {
+        std::fclose(dump_);
+    }
+}
+
+void TraceRecorder::record(const trace_t& trace, id_t order_id, OrderStatus status, uint32_t source) noexcept
+{
+    const double ns_per_tick = clock_.ns_per_tick();
+    auto span_ns = [ns_per_tick](std::uint64_t from, std::uint64_t to) {
+        return to <= from ? 0 : static_cast<std::uint64_t>(static_cast<double>(to - from) * ns_per_tick);
+    };
+
+    // each reached stage is timed from the previous reached one
+    std::uint64_t first = 0;
+    std::uint64_t previous = 0;
+    for (std::size_t s = 0; s < trace_stages; ++s) {
+        const std::uint64_t ticks = trace.ticks[s];
+        if (ticks == 0) {continue;}
+        if (previous != 0) {stages_[s].record(span_ns(previous, ticks));}
+        if (first == 0) {first = ticks;}
+        previous = ticks;
+    }
+    if (first == 0) {return;} // nothing stamped
+    total_.record(span_ns(first, previous));
+    concurrency::bump(traced_);
+
+    if (dump_ == nullptr || --until_sample_ != 0) {return;}
+    until_sample_ = sample_every_;
+    trace_record_t raw{.order_id = order_id, .source = source, .status = static_cast<uint8_t>(status)};
+    for (std::size_t s = 0; s < trace_stages; ++s) {
+        raw.stage_ns[s] = trace.ticks[s] == 0 ? 0 : clock_.to_ns(trace.ticks[s]);
+    }
+    std::fwrite(&raw, sizeof(raw), 1, dump_);
+    concurrency::bump(dumped_);
+}
+
+trace_stats_t TraceRecorder::stats() const noexcept
+{
+    trace_stats_t result{
+        .traced = traced_.load(std::memory_order_relaxed),
+        .dumped = dumped_.load(std::memory_order_relaxed),
+        .total = total_.load(),
+    };
+    for (std::size_t s = 0; s < trace_stages; ++s) {
+        result.stage[s] = stages_[s].load();
+    }
+    return result;
+}
+
+void TraceRecorder::flush() noexcept
+{
+    if (dump_ != nullptr) {std::fflush(dump_);}
+}
+
+const char* TraceRecorder::stage_name(TraceStage stage) noexcept
+{
+    switch (stage) {
+    case TraceStage::INGRESS: return "ingress";
+    case TraceStage::ENQUEUE: return "enqueue";
+    case TraceStage::DEQUEUE: return "dequeue";
+    case TraceStage::MATCH_START: return "match_start";
+    case TraceStage::MATCH_END: return "match_end";
+    case TraceStage::PUBLISH: return "publish";
+    }
+    return "unknown";
+}
+
+}  // namespace engine
@@ -0,0 +1,113 @@
+#include "libs/concurrency/shm_spsc_ring.hpp"
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Cross-process counterpart of bench_spsc_throughput: a gateway process (child) and an engine
+// process (parent) connected by shared-memory rings.
+//   throughput: the child streams N messages on one ring, the parent drains them in batches
+//   latency:    the parent pings on a second ring, the child echoes on a third; one way = round trip / 2
+// usage: bench_shm_spsc [n_messages] [ping_rounds]
+// build: g++ -O2 -std=c++20 -Iinclude tests/source/concurrency/bench_shm_spsc.cpp -o bench_shm_spsc
+
+using namespace std::chrono;
+using concurrency::ShmMode;
+using concurrency::ShmSpscRing;
+
+namespace {
+struct msg_t {
+  std::uint64_t seq;
+  std::uint64_t payload[3];
+};
+
+// spin first, then yield so both processes still progress when they share a core
+constexpr int spins_before_yield = 1000;
+
+template <class Ring>
+void push_spin(Ring& ring, const msg_t& m) {
+  for (int spins = 0; !ring.push(m);) {
+    if (++spins >= spins_before_yield) { std::this_thread::yield(); spins = 0; }
+  }
+}
+
+template <class Ring>
+msg_t pop_spin(Ring& ring) {
+  msg_t m{};
+  for (int spins = 0; !ring.pop(m);) {
+    if (++spins >= spins_before_yield) { std::this_thread::yield(); spins = 0; }
+  }
+  return m;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::uint64_t n = argc > 1 ? std::stoull(argv[1]) : 5'000'000;
+  const std::uint64_t rounds = argc > 2 ? std::stoull(argv[2]) : 100'000;
+  const std::string base = "/scopex_bench_" + std::to_string(getpid());
+
+  // the parent creates every ring before forking, so the child can attach at once
+  ShmSpscRing<msg_t> stream(base + "_stream", ShmMode::CREATE, 1u << 16); // child -> parent
+  ShmSpscRing<msg_t> ping(base + "_ping", ShmMode::CREATE, 1u << 4);      // parent -> child
+  ShmSpscRing<msg_t> pong(base + "_pong", ShmMode::CREATE, 1u << 4);      // child -> parent
+  if (!stream.is_open() || !ping.is_open() || !pong.is_open()) {
+    std::fprintf(stderr, "cannot create rings: %s %s %s\n", stream.error().c_str(), ping.error().c_str(), pong.error().c_str());
+    return 1;
+  }
+
+  const pid_t child = fork();
+  if (child < 0) { std::perror("fork"); return 1; }
+  if (child == 0) {
+    // a separate process would attach the same way; the inherited mappings are not used
+    ShmSpscRing<msg_t> out(base + "_stream", ShmMode::ATTACH);
+    ShmSpscRing<msg_t> in(base + "_ping", ShmMode::ATTACH);
+    ShmSpscRing<msg_t> back(base + "_pong", ShmMode::ATTACH);
+    if (!out.is_open() || !in.is_open() || !back.is_open()) { _exit(2); }
+    for (std::uint64_t i = 0; i < n;) {
+      if (out.push(msg_t{i, {i, i, i}})) { ++i; } else { std::this_thread::yield(); }
+    }
+    for (std::uint64_t i = 0; i < rounds; ++i) { push_spin(back, pop_spin(in)); }
+    _exit(0);
+  }
+
+  // ---- throughput ----
+  std::vector<msg_t> batch(256);
+  std::uint64_t got = 0;
+  bool ordered = true;
+  const auto start = steady_clock::now();
+  while (got < n) {
+    const std::size_t num = stream.try_pop_n(batch.data(), batch.size());
+    if (num == 0) { std::this_thread::yield(); continue; }
+    for (std::size_t i = 0; i < num; ++i) { ordered = ordered && batch[i].seq == got + i; }
+    got += num;
+  }
+  const auto dt_us = duration_cast<microseconds>(steady_clock::now() - start).count();
+  std::printf("throughput: handled=%llu time=%lld ms throughput=%.2f Mmsg/s ordered=%s\n", (unsigned long long)n,
+              (long long)(dt_us / 1000), dt_us == 0 ? 0.0 : static_cast<double>(n) / static_cast<double>(dt_us), ordered ? "yes" : "NO");
+
+  // ---- latency ----
+  std::vector<std::uint64_t> rtt_ns;
+  rtt_ns.reserve(rounds);
+  for (std::uint64_t i = 0; i < rounds; ++i) {
+    const auto t0 = steady_clock::now();
+    push_spin(ping, msg_t{i, {}});
+    const msg_t echo = pop_spin(pong);
+    const auto t1 = steady_clock::now();
+    if (echo.seq != i) { std::fprintf(stderr, "echo out of order at %llu\n", (unsigned long long)i); break; }
+    rtt_ns.push_back(static_cast<std::uint64_t>(duration_cast<nanoseconds>(t1 - t0).count()));
+  }
+  int status = 0;
+  waitpid(child, &status, 0);
+  if (rtt_ns.empty()) { return WIFEXITED(status) ? WEXITSTATUS(status) : 1; }
+
+  std::sort(rtt_ns.begin(), rtt_ns.end());
+  auto pct = [&](double p) { return rtt_ns[static_cast<std::size_t>(p * static_cast<double>(rtt_ns.size() - 1))] / 2; };
+  std::printf("one-way latency ns (rtt/2): rounds=%zu p50=%llu p90=%llu p99=%llu p99.9=%llu max=%llu\n", rtt_ns.size(),
+              (unsigned long long)pct(0.50), (unsigned long long)pct(0.90), (unsigned long long)pct(0.99),
+              (unsigned long long)pct(0.999), (unsigned long long)(rtt_ns.back() / 2));
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
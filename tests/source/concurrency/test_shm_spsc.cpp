@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include "libs/concurrency/shm_spsc_ring.hpp"
+#include <cstdint>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+using concurrency::ShmMode;
+using concurrency::ShmSpscRing;
+
+namespace {
+struct msg_t {
+  std::uint64_t seq;
+  std::int64_t price;
+  std::int64_t qty;
+};
+
+std::string unique_name(const char* tag) {
+  return "/scopex_test_" + std::string(tag) + "_" + std::to_string(getpid());
+}
+}  // namespace
+
+TEST(ShmSpscRing, CreateAndAttachShareTheRing) {
+  const auto name = unique_name("share");
+  ShmSpscRing<msg_t> producer(name, ShmMode::CREATE, 1u << 4);
+  ASSERT_TRUE(producer.is_open()) << producer.error();
+  ShmSpscRing<msg_t> consumer(name, ShmMode::ATTACH);
+  ASSERT_TRUE(consumer.is_open()) << consumer.error();
+  EXPECT_EQ(consumer.capacity(), 16u);
+
+  // two mappings of one segment: only the shared indices connect them
+  for (std::uint64_t i = 0; i < 16; ++i) {
+    ASSERT_TRUE(producer.push(msg_t{i, 100 + static_cast<std::int64_t>(i), 1}));
+  }
+  EXPECT_FALSE(producer.push(msg_t{99, 0, 0})) << "push should fail when full";
+  EXPECT_EQ(consumer.approx_size(), 16u);
+
+  msg_t out[8]{};
+  ASSERT_EQ(consumer.try_pop_n(out, 8), 8u);
+  EXPECT_EQ(out[7].seq, 7u);
+  for (std::uint64_t i = 16; i < 24; ++i) {
+    ASSERT_TRUE(producer.push(msg_t{i, 0, 0})); // wraps around
+  }
+  msg_t one{};
+  for (std::uint64_t i = 8; i < 24; ++i) {
+    ASSERT_TRUE(consumer.pop(one));
+    EXPECT_EQ(one.seq, i);
+  }
+  EXPECT_FALSE(consumer.pop(one));
+}
+
+TEST(ShmSpscRing, AttachChecksTheSegment) {
+  const auto name = unique_name("check");
+  ShmSpscRing<msg_t> missing(name, ShmMode::ATTACH);
+  EXPECT_FALSE(missing.is_open());
+  EXPECT_FALSE(missing.error().empty());
+
+  ShmSpscRing<msg_t> created(name, ShmMode::CREATE, 1u << 3);
+  ASSERT_TRUE(created.is_open()) << created.error();
+  ShmSpscRing<msg_t> again(name, ShmMode::CREATE, 1u << 3);
+  EXPECT_FALSE(again.is_open()) << "CREATE must not take over an existing segment";
+  ShmSpscRing<std::uint32_t> wrong_type(name, ShmMode::ATTACH);
+  EXPECT_FALSE(wrong_type.is_open());
+  EXPECT_NE(wrong_type.error().find("size"), std::string::npos) << wrong_type.error();
+
+  ShmSpscRing<msg_t> bad_capacity(unique_name("cap"), ShmMode::CREATE, 12);
+  EXPECT_FALSE(bad_capacity.is_open());
+}
+
+TEST(ShmSpscRing, CreatorUnlinksTheName) {
+  const auto name = unique_name("unlink");
+  {
+    ShmSpscRing<msg_t> created(name, ShmMode::CREATE, 1u << 3);
+    ASSERT_TRUE(created.is_open()) << created.error();
+  }
+  ShmSpscRing<msg_t> attach(name, ShmMode::ATTACH);
+  EXPECT_FALSE(attach.is_open());
+  EXPECT_FALSE(ShmSpscRing<msg_t>::remove(name));
+}
+
+TEST(ShmSpscRing, CrossProcessFifo) {
+  constexpr std::uint64_t N = 200000;
+  const auto name = unique_name("fifo");
+  ShmSpscRing<msg_t> consumer(name, ShmMode::CREATE, 1u << 10);
+  ASSERT_TRUE(consumer.is_open()) << consumer.error();
+
+  const pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    ShmSpscRing<msg_t> producer(name, ShmMode::ATTACH);
+    if (!producer.is_open()) {_exit(2);}
+    for (std::uint64_t i = 0; i < N;) {
+      if (producer.push(msg_t{i, static_cast<std::int64_t>(i) * 3, 1})) {++i;} else {std::this_thread::yield();}
+    }
+    _exit(0);
+  }
+
+  std::uint64_t expected = 0;
+  msg_t batch[64]{};
+  while (expected < N) {
+    const std::size_t num = consumer.try_pop_n(batch, 64);
+    if (num == 0) {std::this_thread::yield(); continue;}
+    for (std::size_t i = 0; i < num; ++i, ++expected) {
+      ASSERT_EQ(batch[i].seq, expected);
+      ASSERT_EQ(batch[i].price, static_cast<std::int64_t>(expected) * 3);
+    }
+  }
+  int status = 0;
+  ASSERT_EQ(waitpid(child, &status, 0), child);
+  EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
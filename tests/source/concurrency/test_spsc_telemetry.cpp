@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include "libs/concurrency/spsc_ring.hpp"
+
+#include <thread>
+
+using concurrency::SpscRing;
+
+TEST(SpscTelemetry, NoTelemetryAddsNoState) {
+  using plain_t = SpscRing<int>;
+  using monitored_t = SpscRing<int, true>;
+  EXPECT_EQ(sizeof(plain_t), sizeof(SpscRing<int, false>));
+  EXPECT_LT(sizeof(plain_t), sizeof(monitored_t));
+}
+
+TEST(SpscTelemetry, CountsFullAndEmpty) {
+  constexpr std::size_t CAP = 1u << 4;
+  SpscRing<int, true> q(CAP);
+  int v = 0;
+  EXPECT_FALSE(q.pop(v));
+  for (int i = 0; i < 20; ++i) q.push(i);
+
+  int out[8];
+  EXPECT_EQ(q.try_pop_n(out, 8), 8u);
+  EXPECT_TRUE(q.pop(v));
+
+  auto stats = q.stats();
+  EXPECT_EQ(stats.pushes, 16u);
+  EXPECT_EQ(stats.push_full, 4u);
+  EXPECT_EQ(stats.pops, 9u);
+  EXPECT_EQ(stats.pop_empty, 1u);
+  EXPECT_EQ(stats.high_water, CAP);
+  EXPECT_EQ(stats.capacity, CAP);
+  EXPECT_EQ(stats.samples(), 0u); // refused pushes count in push_full only, not as occupancy samples
+}
+
+TEST(SpscTelemetry, SamplesOccupancyEveryPeriod) {
+  using ring_t = SpscRing<int, true>;
+  ring_t q(1u << 10);
+  // keep 3 elements in flight: occupancy is 4 right after each push
+  for (int i = 0; i < 3; ++i) q.push(i);
+  int v = 0;
+  for (std::size_t i = 3; i < 3 + 10 * ring_t::sample_period; ++i) {
+    q.push(static_cast<int>(i));
+    q.pop(v);
+  }
+
+  auto stats = q.stats();
+  EXPECT_EQ(stats.samples(), 10u);
+  EXPECT_EQ(stats.occupancy[0], stats.samples());
+  EXPECT_EQ(stats.high_water, 4u);
+  EXPECT_EQ(stats.push_full, 0u);
+}
+
+TEST(SpscTelemetry, ReadableWhileRunning) {
+  using ring_t = SpscRing<int, true>;
+  constexpr int N = 200000;
+  ring_t q(1u << 8);
+  std::thread producer([&] {
+    for (int i = 0; i < N; ++i) {
+      while (!q.push(i)) std::this_thread::yield();
+    }
+  });
+  std::thread consumer([&] {
+    int v = 0;
+    for (int got = 0; got < N;) {
+      if (q.pop(v)) { ++got; } else { std::this_thread::yield(); }
+    }
+  });
+  // a monitoring thread sees counters that never run backwards
+  std::uint64_t last_pushes = 0;
+  std::uint64_t last_pops = 0;
+  for (int i = 0; i < 1000; ++i) {
+    auto stats = q.stats();
+    EXPECT_GE(stats.pushes, last_pushes);
+    EXPECT_GE(stats.pops, last_pops);
+    EXPECT_LE(stats.high_water, stats.capacity);
+    EXPECT_LE(q.approx_size(), q.capacity());
+    last_pushes = stats.pushes;
+    last_pops = stats.pops;
+  }
+  producer.join();
+  consumer.join();
+
+  auto stats = q.stats();
+  EXPECT_EQ(stats.pushes, static_cast<std::uint64_t>(N));
+  EXPECT_EQ(stats.pops, static_cast<std::uint64_t>(N));
+  EXPECT_EQ(stats.samples(), N / ring_t::sample_period);
+}
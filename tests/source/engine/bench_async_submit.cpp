@@ -0,0 +1,39 @@
+#include "libs/engine/async_engine.hpp"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace std::chrono;
+using namespace engine;
+
+namespace {
+// one "session": awaits its orders back to back, alternately resting a bid and hitting it
+detached_task_t session(AsyncEngine& eng, int orders, long long& filled) {
+  for (int i = 0; i < orders; ++i) {
+    const bool rest = (i % 2 == 0);
+    auto result = co_await eng.submit({.side=rest ? Side::BUY : Side::SELL, .order_type=OrderType::LIMIT,
+                                       .time_in_force=rest ? TimeInForce::GTC : TimeInForce::IOC, .price=1000, .qty=1});
+    filled += result.filled_qty;
+  }
+}
+}  // namespace
+
+int main() {
+  constexpr int sessions = 4096;     // coroutines in flight
+  constexpr int per_session = 1000;
+  AsyncEngine eng({true, 0}, 1u << 12);
+  eng.start();
+
+  long long filled = 0;
+  auto t0 = steady_clock::now();
+  for (int s = 0; s < sessions; ++s) { session(eng, per_session, filled); }
+  eng.drain();
+  auto t1 = steady_clock::now();
+  eng.stop();
+
+  const double total = static_cast<double>(sessions) * per_session;
+  const double ns = static_cast<double>(duration_cast<nanoseconds>(t1 - t0).count());
+  std::printf("awaits=%.0f  in_flight=%d  time=%.1f ms  ns_per_await=%.1f  filled=%lld\n",
+              total, sessions, ns / 1e6, ns / total, filled);
+  return 0;
+}
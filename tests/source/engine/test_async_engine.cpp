@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include <libs/engine/engine.hpp>
+#include <libs/engine/async_engine.hpp>
+#include <thread>
+#include <vector>
+#include "test_flows.hpp"
+
+using namespace engine;
+
+namespace {
+detached_task_t submit_one(AsyncEngine& eng, order_cmd_t cmd, add_result_t& out) {
+  out = co_await eng.submit(cmd);
+}
+
+detached_task_t submit_chain(AsyncEngine& eng, const std::vector<order_cmd_t>& flow, std::vector<add_result_t>& out,
+                             std::thread::id& resumed_on) {
+  for (const auto& cmd : flow) {
+    out.push_back(co_await eng.submit(cmd));
+    resumed_on = std::this_thread::get_id();
+  }
+}
+}  // namespace
+
+TEST(AsyncEngine, ManyInFlightMatchSynchronousEngine) {
+  const auto flow = test::random_flow(5000, 3, 700);
+  AsyncEngine async_eng({true, 0}, 256); // small ring: most submissions wait in the submitter queue
+  async_eng.start();
+
+  std::vector<add_result_t> results(flow.size());
+  for (std::size_t i = 0; i < flow.size(); ++i) {
+    submit_one(async_eng, flow[i], results[i]);
+  }
+  EXPECT_EQ(async_eng.in_flight(), flow.size());
+  async_eng.drain();
+  async_eng.stop();
+
+  auto sync_eng = make_engine({true, 0});
+  for (std::size_t i = 0; i < flow.size(); ++i) {
+    ASSERT_EQ(results[i], sync_eng->add_order(flow[i])) << "command " << i;
+  }
+  EXPECT_EQ(async_eng.engine().metrics().trades, sync_eng->metrics().trades);
+}
+
+TEST(AsyncEngine, ResumesOnPollingThread) {
+  const auto flow = test::random_flow(500, 3, 700);
+  AsyncEngine async_eng;
+  async_eng.start();
+
+  std::vector<add_result_t> results;
+  std::thread::id resumed_on{};
+  submit_chain(async_eng, flow, results, resumed_on);
+  async_eng.drain();
+  async_eng.stop();
+
+  EXPECT_EQ(results.size(), flow.size());
+  EXPECT_EQ(resumed_on, std::this_thread::get_id());
+  EXPECT_EQ(async_eng.in_flight(), 0u);
+}
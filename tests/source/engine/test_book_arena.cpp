@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include <libs/engine/engine.hpp>
+#include <libs/engine/book_arena.hpp>
+#include <vector>
+#include "test_flows.hpp"
+
+using namespace engine;
+
+TEST(BookArena, SameResultsAsDefaultHeap) {
+  for (auto layout : {LevelLayout::AOS, LevelLayout::SOA}) {
+    BookArena arena(book_arena_options_t{.initial_bytes = 64U << 10});
+    auto heap_eng = make_engine({.market_gtc_as_ioc=true, .market_max_levels=0, .level_layout=layout});
+    auto arena_eng = make_engine({.market_gtc_as_ioc=true, .market_max_levels=0, .level_layout=layout, .memory_resource=&arena});
+
+    for (const auto& cmd : test::random_flow(5000, 7, 1000)) {
+      ASSERT_EQ(heap_eng->add_order(cmd), arena_eng->add_order(cmd));
+    }
+    const auto heap_snap = heap_eng->snapshot(10);
+    const auto arena_snap = arena_eng->snapshot(10);
+    EXPECT_EQ(heap_snap.bids, arena_snap.bids);
+    EXPECT_EQ(heap_snap.asks, arena_snap.asks);
+    EXPECT_GT(arena.pooled_bytes(), 0u);
+    // the counting hook sits on top of the arena
+    EXPECT_EQ(arena_eng->memory_stats().total_bytes(), arena.pooled_bytes() + arena.large_bytes());
+  }
+}
+
+TEST(BookArena, LargeBlocksBypassPools) {
+  BookArena arena(book_arena_options_t{.initial_bytes = 4096, .max_pooled_block = 256});
+  void* small = arena.allocate(64);
+  void* large = arena.allocate(1024);
+  EXPECT_EQ(arena.pooled_bytes(), 64u);
+  EXPECT_EQ(arena.large_bytes(), 1024u);
+  arena.deallocate(large, 1024);
+  arena.deallocate(small, 64);
+  EXPECT_EQ(arena.pooled_bytes(), 0u);
+  EXPECT_EQ(arena.large_bytes(), 0u);
+}
+
+TEST(BookArena, EngineTeardownReturnsEverything) {
+  BookArena arena;
+  {
+    auto eng = make_engine({.market_gtc_as_ioc=true, .market_max_levels=0, .memory_resource=&arena});
+    for (const auto& cmd : test::random_flow(2000, 7, 1000)) {
+      eng->add_order(cmd);
+    }
+    EXPECT_GT(arena.pooled_bytes(), 0u);
+  }
+  EXPECT_EQ(arena.pooled_bytes(), 0u);
+  arena.release();
+}
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include <libs/engine/engine.hpp>
+#include <libs/engine/book_scheduler.hpp>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace engine;
+
+namespace {
+struct book_cmd_t {
+  std::uint64_t seq{0}; // per-book submit order
+  order_cmd_t order{};
+};
+
+struct book_state_t {
+  std::unique_ptr<IEngine> engine = make_engine();
+  std::uint64_t next_seq{0};
+  bool in_order{true};
+  std::vector<std::size_t> workers_seen;
+};
+
+// skewed flow: book 0 takes most of the commands
+std::vector<std::pair<std::size_t, order_cmd_t>> skewed_flow(std::size_t books, std::size_t count) {
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<int> side(0, 1), level(-5, 5), qty(1, 20), pick(0, 99);
+  std::uniform_int_distribution<std::size_t> cold(1, books - 1);
+  std::vector<std::pair<std::size_t, order_cmd_t>> flow;
+  for (std::size_t i = 0; i < count; ++i) {
+    const std::size_t book = pick(rng) < 80 ? 0 : cold(rng);
+    flow.emplace_back(book, order_cmd_t{.side=side(rng) == 0 ? Side::BUY : Side::SELL, .order_type=OrderType::LIMIT,
+                                        .time_in_force=TimeInForce::GTC, .price=1000 + level(rng), .qty=qty(rng)});
+  }
+  return flow;
+}
+}  // namespace
+
+TEST(BookScheduler, KeepsEveryBookInSubmitOrder) {
+  constexpr std::size_t books = 12;
+  const auto flow = skewed_flow(books, 60000);
+
+  std::vector<book_state_t> states(books);
+  BookScheduler<book_cmd_t> scheduler(3, books, [&](std::size_t, std::size_t book, book_cmd_t& cmd) {
+    book_state_t& state = states[book]; // single writer: a book runs on one worker at a time
+    state.in_order = state.in_order && cmd.seq == state.next_seq;
+    ++state.next_seq;
+    state.engine->add_order(cmd.order);
+  }, 1U << 6, 32);
+  for (std::size_t i = 0; i < books; ++i) {ASSERT_EQ(scheduler.add_book(), i);}
+  EXPECT_EQ(scheduler.add_book(), BookScheduler<book_cmd_t>::npos);
+
+  scheduler.start();
+  std::vector<std::uint64_t> seqs(books, 0);
+  for (const auto& [book, order] : flow) {scheduler.submit(book, book_cmd_t{.seq = seqs[book]++, .order = order});}
+  scheduler.stop();
+
+  // the same flow on one thread gives the same books
+  std::vector<std::unique_ptr<IEngine>> reference;
+  for (std::size_t i = 0; i < books; ++i) {reference.push_back(make_engine());}
+  for (const auto& [book, order] : flow) {reference[book]->add_order(order);}
+
+  const auto stats = scheduler.stats();
+  for (std::size_t i = 0; i < books; ++i) {
+    EXPECT_TRUE(states[i].in_order) << "book " << i;
+    EXPECT_EQ(states[i].next_seq, seqs[i]);
+    EXPECT_EQ(stats.books[i].commands, seqs[i]);
+    EXPECT_EQ(stats.books[i].backlog, 0u);
+    EXPECT_EQ(states[i].engine->snapshot(20).bids, reference[i]->snapshot(20).bids);
+    EXPECT_EQ(states[i].engine->snapshot(20).asks, reference[i]->snapshot(20).asks);
+  }
+  EXPECT_EQ(stats.commands(), flow.size());
+}
+
+TEST(BookScheduler, IdleWorkersStealWholeBooks) {
+  // every book is homed on worker 0 and queued before the workers start
+  constexpr std::size_t workers = 4;
+  constexpr std::size_t books = 16;
+  constexpr std::size_t per_book = 4000;
+  std::vector<std::unique_ptr<IEngine>> engines;
+  std::vector<std::vector<std::size_t>> ran_on(books);
+  BookScheduler<order_cmd_t> scheduler(workers, books, [&](std::size_t worker, std::size_t book, order_cmd_t& cmd) {
+    engines[book]->add_order(cmd);
+    if (ran_on[book].empty() || ran_on[book].back() != worker) {ran_on[book].push_back(worker);}
+  }, 1U << 13, 64);
+  for (std::size_t i = 0; i < books; ++i) {
+    engines.push_back(make_engine());
+    scheduler.add_book();
+  }
+  for (std::size_t n = 0; n < per_book; ++n) {
+    for (std::size_t book = 0; book < books; book += workers) {
+      scheduler.submit(book, order_cmd_t{.side=n % 2 == 0 ? Side::BUY : Side::SELL, .price=1000 + static_cast<price_t>(n % 7), .qty=1});
+    }
+  }
+  scheduler.start();
+  scheduler.stop();
+
+  const auto stats = scheduler.stats();
+  EXPECT_EQ(stats.commands(), per_book * books / workers);
+  std::uint64_t steals = 0;
+  std::size_t busy_workers = 0;
+  for (const auto& worker : stats.workers) {
+    steals += worker.steals;
+    busy_workers += worker.commands > 0 ? 1 : 0;
+  }
+  EXPECT_GT(steals, 0u);
+  EXPECT_GT(busy_workers, 1u);
+  std::uint64_t migrations = 0;
+  for (std::size_t book = 0; book < books; ++book) {
+    migrations += stats.books[book].migrations;
+    EXPECT_EQ(stats.books[book].commands, book % workers == 0 ? per_book : 0u);
+  }
+  EXPECT_GT(migrations, 0u);
+}
+
+TEST(BookScheduler, SubmitWaitsForAFullBook) {
+  std::vector<std::uint64_t> seen;
+  BookScheduler<std::uint64_t> scheduler(2, 1, [&](std::size_t, std::size_t, std::uint64_t& value) { seen.push_back(value); }, 1U << 2, 2);
+  scheduler.add_book();
+  scheduler.start();
+  for (std::uint64_t i = 0; i < 10000; ++i) {scheduler.submit(0, i);}
+  scheduler.stop();
+  ASSERT_EQ(seen.size(), 10000u);
+  for (std::uint64_t i = 0; i < seen.size(); ++i) {ASSERT_EQ(seen[i], i);}
+}
+
+TEST(BookScheduler, ImbalanceOfTheLoadSpread) {
+  scheduler_stats_t even{.workers = {{.commands = 50}, {.commands = 50}}, .books = {}};
+  EXPECT_DOUBLE_EQ(even.imbalance(), 1.0);
+  scheduler_stats_t skewed{.workers = {{.commands = 90}, {.commands = 10}, {.commands = 0}, {.commands = 0}}, .books = {}};
+  EXPECT_DOUBLE_EQ(skewed.imbalance(), 3.6);
+  EXPECT_EQ(skewed.commands(), 100u);
+  EXPECT_DOUBLE_EQ(scheduler_stats_t{}.imbalance(), 1.0);
+}
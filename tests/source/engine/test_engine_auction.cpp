@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <libs/engine/engine.hpp>
+#include "test_flows.hpp"
+
+using namespace engine;
+
+namespace {
+std::unique_ptr<IEngine> auction_engine(LevelLayout layout = LevelLayout::AOS) {
+  return make_engine({.market_gtc_as_ioc=true, .market_max_levels=0, .level_layout=layout, .matching_mode=MatchingMode::AUCTION});
+}
+}  // namespace
+
+TEST(Auction, CollectsWithoutMatching) {
+  auto eng = auction_engine();
+  EXPECT_EQ(eng->matching_mode(), MatchingMode::AUCTION);
+  auto buy = eng->add_order(test::limit(Side::BUY, 105, 10));
+  auto sell = eng->add_order(test::limit(Side::SELL, 100, 10));
+  EXPECT_EQ(buy.status, OrderStatus::OK);
+  EXPECT_TRUE(sell.trades.empty());
+  EXPECT_EQ(sell.remaining_qty, 10);
+
+  auto snap = eng->snapshot(1); // crossed until the uncross
+  EXPECT_EQ(snap.bids[0].price, 105);
+  EXPECT_EQ(snap.asks[0].price, 100);
+
+  // only GTC limit orders take part in the collection
+  EXPECT_EQ(eng->add_order({.side=Side::BUY, .order_type=OrderType::LIMIT, .time_in_force=TimeInForce::IOC, .price=105, .qty=1}).status, OrderStatus::REJECT);
+  EXPECT_EQ(eng->add_order({.side=Side::BUY, .order_type=OrderType::MARKET, .time_in_force=TimeInForce::IOC, .qty=1}).status, OrderStatus::REJECT);
+}
+
+TEST(Auction, UncrossMaximizesVolume) {
+  for (auto layout : {LevelLayout::AOS, LevelLayout::SOA}) {
+    auto eng = auction_engine(layout);
+    const engine::id_t b102 = eng->add_order(test::limit(Side::BUY, 102, 30)).order_id;
+    const engine::id_t b101 = eng->add_order(test::limit(Side::BUY, 101, 20)).order_id;
+    eng->add_order(test::limit(Side::BUY, 100, 10));
+    const engine::id_t a99 = eng->add_order(test::limit(Side::SELL, 99, 10)).order_id;
+    const engine::id_t a100 = eng->add_order(test::limit(Side::SELL, 100, 20)).order_id;
+    const engine::id_t a101 = eng->add_order(test::limit(Side::SELL, 101, 30)).order_id;
+    eng->add_order(test::limit(Side::SELL, 103, 10));
+
+    // demand/supply: 99: 60/10, 100: 60/30, 101: 50/60, 102: 30/60
+    const auto result = eng->uncross();
+    EXPECT_EQ(result.price, 101);
+    EXPECT_EQ(result.volume, 50);
+    EXPECT_EQ(result.imbalance, -10);
+    ASSERT_EQ(result.trades.size(), 3u);
+    EXPECT_EQ(result.trades[0], (trade_t{.taker=b102, .maker=a99, .price=101, .qty=10, .timestamp=result.trades[0].timestamp, .seq=result.trades[0].seq}));
+    EXPECT_EQ(result.trades[1].maker, a100);
+    EXPECT_EQ(result.trades[2].taker, b101);
+    EXPECT_EQ(result.trades[2].maker, a101);
+    EXPECT_EQ(result.trades[2].qty, 20);
+
+    auto snap = eng->snapshot(2);
+    EXPECT_EQ(snap.bids[0], (snapshot_level_t{100, 10}));
+    EXPECT_EQ(snap.asks[0], (snapshot_level_t{101, 10}));
+    EXPECT_EQ(eng->metrics().traded_qty, 50u);
+    EXPECT_EQ(eng->uncross().volume, 0); // nothing crosses any more
+  }
+}
+
+TEST(Auction, TieGoesToPriceNearestMid) {
+  auto eng = auction_engine();
+  eng->add_order(test::limit(Side::BUY, 104, 10));
+  eng->add_order(test::limit(Side::SELL, 100, 10));
+  // same volume and imbalance at 100 and 104, mid is 102: equal distance, the lower price wins
+  EXPECT_EQ(eng->uncross().price, 100);
+
+  eng->add_order(test::limit(Side::BUY, 104, 10));
+  eng->add_order(test::limit(Side::SELL, 102, 5));
+  eng->add_order(test::limit(Side::SELL, 100, 5));
+  // 100: 10/5, 102: 10/10, 104: 10/10 -> 102 and 104 tie on volume and imbalance, 102 is the mid
+  EXPECT_EQ(eng->uncross().price, 102);
+}
+
+TEST(Auction, OpeningAuctionThenContinuous) {
+  auto eng = auction_engine();
+  eng->add_order(test::limit(Side::BUY, 101, 5));
+  eng->add_order(test::limit(Side::SELL, 100, 3));
+
+  const auto opening = eng->set_matching_mode(MatchingMode::CONTINUOUS);
+  EXPECT_EQ(opening.volume, 3);
+  EXPECT_EQ(eng->matching_mode(), MatchingMode::CONTINUOUS);
+
+  // continuous matching from now on
+  auto result = eng->add_order(test::limit(Side::SELL, 101, 2));
+  EXPECT_EQ(result.status, OrderStatus::FILLED);
+  EXPECT_TRUE(eng->snapshot(1).bids.empty());
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <libs/engine/engine.hpp>
+#include <libs/engine/clock.hpp>
+#include <chrono>
+#include "test_flows.hpp"
+
+using namespace engine;
+
+namespace {
+std::uint64_t steady_ns() {
+  return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+}  // namespace
+
+TEST(EngineClock, SequenceIsTheDefault) {
+  auto eng = make_engine();
+  eng->add_order(test::limit(Side::SELL, 100, 5));
+  eng->add_order(test::limit(Side::SELL, 101, 5));
+  auto r = eng->add_order(test::limit(Side::BUY, 101, 10, {.timestamp=777}));
+  ASSERT_EQ(r.trades.size(), 2u);
+  for (const auto& trade : r.trades) {
+    EXPECT_EQ(trade.seq, 3u);
+    EXPECT_EQ(trade.timestamp, 3u);
+  }
+}
+
+TEST(EngineClock, CallerTimestampsForReplay) {
+  auto eng = make_engine({.clock=ClockSource::CALLER});
+  eng->add_order(test::limit(Side::SELL, 100, 5, {.timestamp=5000}));
+  auto r = eng->add_order(test::limit(Side::BUY, 100, 5, {.timestamp=4000})); // taken as given, even out of order
+  ASSERT_EQ(r.trades.size(), 1u);
+  EXPECT_EQ(r.trades[0].timestamp, 4000u);
+  EXPECT_EQ(r.trades[0].seq, 2u);
+
+  eng->set_matching_mode(MatchingMode::AUCTION);
+  eng->add_order(test::limit(Side::SELL, 100, 5, {.timestamp=6000}));
+  eng->add_order(test::limit(Side::BUY, 100, 5, {.timestamp=7000}));
+  auto u = eng->uncross();
+  ASSERT_EQ(u.trades.size(), 1u);
+  EXPECT_EQ(u.trades[0].timestamp, 7000u); // no caller timestamp of its own: the last command's
+  EXPECT_EQ(u.trades[0].seq, 5u);
+}
+
+TEST(EngineClock, TscFollowsSteadyClock) {
+  const auto& clock = TscClock::instance();
+  EXPECT_GT(clock.ns_per_tick(), 0.0);
+
+  auto eng = make_engine({.clock=ClockSource::TSC});
+  const std::uint64_t before = steady_ns();
+  eng->add_order(test::limit(Side::SELL, 100, 5));
+  auto first = eng->add_order(test::limit(Side::BUY, 100, 2));
+  auto second = eng->add_order(test::limit(Side::BUY, 100, 3));
+  const std::uint64_t after = steady_ns();
+
+  ASSERT_EQ(first.trades.size(), 1u);
+  ASSERT_EQ(second.trades.size(), 1u);
+  EXPECT_EQ(first.trades[0].seq, 2u);
+  EXPECT_EQ(second.trades[0].seq, 3u);
+  EXPECT_LE(first.trades[0].timestamp, second.trades[0].timestamp);
+  // calibration error is far below a millisecond
+  constexpr std::uint64_t slack_ns = 1000000;
+  EXPECT_GE(first.trades[0].timestamp + slack_ns, before);
+  EXPECT_LE(second.trades[0].timestamp, after + slack_ns);
+}
+
+TEST(EngineClock, TscTicksBeforeCalibrationDoNotWrap) {
+  const auto& clock = TscClock::instance();
+  const std::uint64_t now = clock.now_ns();
+  const std::uint64_t earlier = clock.to_ns(TscClock::ticks() - 1000);
+  EXPECT_LE(earlier, now + 1000000);
+  EXPECT_LE(clock.to_ns(0), now); // the counter at reset: before the calibration base
+}
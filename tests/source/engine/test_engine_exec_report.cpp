@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <libs/engine/engine.hpp>
+#include <libs/engine/event_publisher.hpp>
+#include <libs/engine/replica.hpp>
+#include <memory>
+#include <random>
+#include <vector>
+#include "test_flows.hpp"
+
+using namespace engine;
+
+namespace {
+struct recording_sink_t final : IFillSink {
+  std::vector<trade_t> fills;
+  void on_fill(const trade_t& fill) override { fills.push_back(fill); }
+};
+
+// three ask levels of four makers each: 100 x 4x2, 101 x 4x3, 102 x 4x5
+void stack_asks(IEngine& eng) {
+  for (price_t px = 100; px <= 102; ++px) {
+    for (int i = 0; i < 4; ++i) {eng.add_order(test::limit(Side::SELL, px, px == 100 ? 2 : (px == 101 ? 3 : 5)));}
+  }
+}
+
+// the per-level view of a list of trades
+std::vector<level_fill_t> aggregate(const std::vector<trade_t>& trades) {
+  std::vector<level_fill_t> levels;
+  for (const auto& trade : trades) {
+    if (levels.empty() || levels.back().price != trade.price) {levels.push_back(level_fill_t{.price=trade.price});}
+    levels.back().qty += trade.qty;
+    levels.back().makers++;
+  }
+  return levels;
+}
+}  // namespace
+
+TEST(EngineExecReport, SweepIsOneFillPerLevel) {
+  recording_sink_t sink;
+  auto eng = make_engine({.fill_report=FillReport::LEVELS, .fill_sink=&sink});
+  stack_asks(*eng);
+
+  const auto sweep = eng->add_order(test::limit(Side::BUY, 102, 25, {.tif=TimeInForce::IOC}));
+  EXPECT_EQ(sweep.status, OrderStatus::FILLED);
+  EXPECT_EQ(sweep.filled_qty, 25);
+  EXPECT_TRUE(sweep.trades.empty());
+  ASSERT_EQ(sweep.level_fills.size(), 3u);
+  EXPECT_EQ(sweep.level_fills[0], (level_fill_t{.price=100, .qty=8, .makers=4}));
+  EXPECT_EQ(sweep.level_fills[1], (level_fill_t{.price=101, .qty=12, .makers=4}));
+  EXPECT_EQ(sweep.level_fills[2], (level_fill_t{.price=102, .qty=5, .makers=1}));
+
+  // the maker side is still there, one fill per maker
+  ASSERT_EQ(sink.fills.size(), 9u);
+  EXPECT_EQ(aggregate(sink.fills), sweep.level_fills);
+  EXPECT_EQ(sink.fills.back().taker, sweep.order_id);
+  EXPECT_EQ(eng->metrics().trades, 9u);
+  EXPECT_EQ(eng->metrics().traded_qty, 25u);
+
+  const auto market = eng->add_order(order_cmd_t{.side=Side::BUY, .order_type=OrderType::MARKET, .time_in_force=TimeInForce::IOC, .qty=7});
+  EXPECT_EQ(market.level_fills, (std::vector<level_fill_t>{{.price=102, .qty=7, .makers=2}}));
+  EXPECT_EQ(sink.fills.size(), 11u);
+}
+
+TEST(EngineExecReport, EveryModeMatchesTheSame) {
+  std::mt19937 rng(5);
+  std::uniform_int_distribution<int> side(0, 1), level(-6, 6), qty(1, 30), tif(0, 2);
+  recording_sink_t sink;
+  auto trades = make_engine();
+  auto levels = make_engine({.level_layout=LevelLayout::SOA, .fill_report=FillReport::LEVELS});
+  auto both = make_engine({.fill_report=FillReport::BOTH, .fill_sink=&sink});
+
+  std::vector<trade_t> all_trades;
+  for (int i = 0; i < 5000; ++i) {
+    const auto cmd = test::limit(side(rng) == 0 ? Side::BUY : Side::SELL, 1000 + level(rng), qty(rng), {.tif=static_cast<TimeInForce>(tif(rng))});
+    const auto by_trade = trades->add_order(cmd);
+    const auto by_level = levels->add_order(cmd);
+    const auto by_both = both->add_order(cmd);
+    ASSERT_EQ(by_level.status, by_trade.status);
+    ASSERT_EQ(by_level.filled_qty, by_trade.filled_qty);
+    ASSERT_EQ(by_level.remaining_qty, by_trade.remaining_qty);
+    ASSERT_TRUE(by_trade.level_fills.empty());
+    ASSERT_TRUE(by_level.trades.empty());
+    ASSERT_EQ(by_level.level_fills, aggregate(by_trade.trades));
+    ASSERT_EQ(by_both.trades, by_trade.trades);
+    ASSERT_EQ(by_both.level_fills, by_level.level_fills);
+    all_trades.insert(all_trades.end(), by_trade.trades.begin(), by_trade.trades.end());
+  }
+  EXPECT_EQ(sink.fills, all_trades);
+  EXPECT_EQ(levels->metrics().trades, trades->metrics().trades);
+  EXPECT_EQ(levels->metrics().traded_qty, trades->metrics().traded_qty);
+  EXPECT_EQ(levels->snapshot(20).asks, trades->snapshot(20).asks);
+  EXPECT_EQ(levels->snapshot(20).bids, trades->snapshot(20).bids);
+}
+
+TEST(EngineExecReport, WarmUpNeverReachesTheSink) {
+  recording_sink_t sink;
+  auto eng = make_engine({.warmup_orders=4096, .fill_report=FillReport::LEVELS, .fill_sink=&sink});
+  EXPECT_TRUE(sink.fills.empty());
+  eng->add_order(test::limit(Side::SELL, 100, 1));
+  eng->add_order(test::limit(Side::BUY, 100, 1));
+  EXPECT_EQ(sink.fills.size(), 1u);
+}
+
+TEST(EngineExecReport, PublishesLevelFillsInsteadOfTrades) {
+  EventPublisher publisher(1u << 10);
+  std::vector<event_t> seen; // written by the publisher thread, read after stop()
+  publisher.add_sink(std::make_shared<CallbackEventSink>([&](std::span<const event_t> events) {
+    seen.insert(seen.end(), events.begin(), events.end());
+  }));
+  publisher.start();
+
+  auto published = make_engine({.publisher=&publisher, .fill_report=FillReport::LEVELS});
+  stack_asks(*published);
+  const auto sweep = published->add_order(test::limit(Side::BUY, 101, 20, {.tif=TimeInForce::IOC}));
+  publisher.stop();
+
+  std::vector<event_t> sweep_events;
+  for (const auto& event : seen) {
+    if (event.type == EventType::TRADE) {ADD_FAILURE() << "no TRADE events with FillReport::LEVELS";}
+    if (event.type == EventType::LEVEL_FILL) {sweep_events.push_back(event);}
+  }
+  ASSERT_EQ(sweep_events.size(), 2u);
+  EXPECT_EQ(sweep_events[0].order_id, sweep.order_id);
+  EXPECT_EQ(sweep_events[0].price, 100);
+  EXPECT_EQ(sweep_events[0].qty, 8);
+  EXPECT_EQ(sweep_events[0].aux, 4u);
+  EXPECT_EQ(sweep_events[1].price, 101);
+  EXPECT_EQ(sweep_events[1].qty, 12);
+  EXPECT_EQ(seen.back().type, EventType::TOP_OF_BOOK);
+}
+
+TEST(EngineExecReport, ReplicaDoesNotReportFillsTwice) {
+  recording_sink_t sink;
+  ReplicatedEngine eng({.fill_report=FillReport::LEVELS, .fill_sink=&sink});
+  eng.start();
+  stack_asks(eng);
+  const auto sweep = eng.add_order(test::limit(Side::BUY, 102, 25, {.tif=TimeInForce::IOC}));
+  eng.sync();
+  EXPECT_EQ(sweep.level_fills.size(), 3u);
+  EXPECT_EQ(sink.fills.size(), 9u);
+  EXPECT_EQ(eng.replica_snapshot(5).asks, eng.snapshot(5).asks);
+  eng.stop();
+}
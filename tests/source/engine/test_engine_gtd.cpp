@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+#include <libs/engine/engine.hpp>
+#include <libs/engine/event_publisher.hpp>
+#include <libs/engine/replica.hpp>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+#include "test_flows.hpp"
+
+using namespace engine;
+
+TEST(EngineGtd, ExpiresBeforeTheFirstCommandAtItsTime) {
+  auto eng = make_engine({.clock=ClockSource::CALLER});
+  const auto order = eng->add_order(test::limit(Side::BUY, 100, 5, {.tif=TimeInForce::GTD, .timestamp=10, .expire_at=1000}));
+  EXPECT_EQ(order.status, OrderStatus::OK);
+  EXPECT_EQ(order.remaining_qty, 5);
+
+  eng->add_order(test::limit(Side::BUY, 90, 1, {.timestamp=999}));
+  EXPECT_EQ(eng->snapshot(1).bids[0], (snapshot_level_t{.price=100, .qty=5}));
+
+  // at 1000 the GTD bid is gone before the sell could trade against it
+  const auto sell = eng->add_order(test::limit(Side::SELL, 100, 5, {.timestamp=1000}));
+  EXPECT_TRUE(sell.trades.empty());
+  EXPECT_EQ(eng->snapshot(1).bids[0], (snapshot_level_t{.price=90, .qty=1}));
+  EXPECT_EQ(eng->metrics().expired_orders, 1u);
+  EXPECT_EQ(eng->metrics().cancel_orders, 0u);
+}
+
+TEST(EngineGtd, NeedsAnExpiryInTheFuture) {
+  auto eng = make_engine({.clock=ClockSource::CALLER});
+  EXPECT_EQ(eng->add_order(test::limit(Side::BUY, 100, 5, {.tif=TimeInForce::GTD, .timestamp=10, .expire_at=0})).status, OrderStatus::BAD_INPUT);
+  EXPECT_EQ(eng->add_order(test::limit(Side::BUY, 100, 5, {.tif=TimeInForce::GTD, .timestamp=10, .expire_at=10})).status, OrderStatus::REJECT);
+  EXPECT_EQ(eng->add_order(test::limit(Side::BUY, 100, 5, {.tif=TimeInForce::GTD, .timestamp=10, .expire_at=11})).status, OrderStatus::OK);
+  EXPECT_EQ(eng->memory_stats().resting_orders, 1u);
+}
+
+TEST(EngineGtd, SkipsOrdersThatLeftBeforeTheirExpiry) {
+  for (auto mode : {CancelMode::ERASE, CancelMode::TOMBSTONE}) {
+    auto eng = make_engine({.cancel_mode=mode, .clock=ClockSource::CALLER});
+    const auto filled = eng->add_order(test::limit(Side::SELL, 100, 5, {.tif=TimeInForce::GTD, .timestamp=1, .expire_at=50}));
+    const auto cancelled = eng->add_order(test::limit(Side::SELL, 101, 5, {.tif=TimeInForce::GTD, .timestamp=2, .expire_at=50}));
+    const auto partial = eng->add_order(test::limit(Side::SELL, 102, 5, {.tif=TimeInForce::GTD, .timestamp=3, .expire_at=60}));
+    eng->add_order(test::limit(Side::BUY, 100, 5, {.timestamp=4}));
+    EXPECT_TRUE(eng->cancel_order(cancelled.order_id));
+    eng->add_order(test::limit(Side::BUY, 102, 2, {.timestamp=5}));
+
+    EXPECT_EQ(eng->expire_orders(49), mass_cancel_result_t{});
+    EXPECT_EQ(eng->expire_orders(59), mass_cancel_result_t{}); // the filled and the cancelled order are gone already
+    EXPECT_EQ(eng->expire_orders(60), (mass_cancel_result_t{.cancelled=1, .cancelled_qty=3}));
+    EXPECT_FALSE(eng->cancel_order(partial.order_id));
+    EXPECT_FALSE(eng->cancel_order(filled.order_id));
+    EXPECT_EQ(eng->memory_stats().resting_orders, 0u);
+  }
+}
+
+TEST(EngineGtd, ReusedIdKeepsItsOwnExpiry) {
+  for (auto mode : {CancelMode::ERASE, CancelMode::TOMBSTONE}) {
+    auto eng = make_engine({.cancel_mode=mode, .clock=ClockSource::CALLER});
+    auto filled = test::limit(Side::SELL, 100, 5, {.tif=TimeInForce::GTD, .timestamp=1, .expire_at=50});
+    filled.order_id = 7;
+    auto cancelled = test::limit(Side::SELL, 103, 5, {.tif=TimeInForce::GTD, .timestamp=2, .expire_at=50});
+    cancelled.order_id = 9;
+    eng->add_order(filled);
+    eng->add_order(cancelled);
+    eng->add_order(test::limit(Side::BUY, 100, 5, {.timestamp=3}));
+    EXPECT_TRUE(eng->cancel_order(9));
+
+    // both ids come back: 7 without an expiry, 9 with a later one
+    auto reused_gtc = test::limit(Side::SELL, 101, 3, {.timestamp=4});
+    reused_gtc.order_id = 7;
+    auto reused_gtd = test::limit(Side::SELL, 102, 4, {.tif=TimeInForce::GTD, .timestamp=5, .expire_at=90});
+    reused_gtd.order_id = 9;
+    eng->add_order(reused_gtc);
+    eng->add_order(reused_gtd);
+
+    EXPECT_EQ(eng->expire_orders(50), mass_cancel_result_t{});
+    EXPECT_EQ(eng->memory_stats().resting_orders, 2u);
+    EXPECT_EQ(eng->expire_orders(90), (mass_cancel_result_t{.cancelled=1, .cancelled_qty=4}));
+    EXPECT_TRUE(eng->cancel_order(7));
+    EXPECT_EQ(eng->metrics().expired_orders, 1u);
+  }
+}
+
+TEST(EngineGtd, AuctionOrdersExpireToo) {
+  auto eng = make_engine({.matching_mode=MatchingMode::AUCTION, .clock=ClockSource::CALLER});
+  EXPECT_EQ(eng->add_order(test::limit(Side::BUY, 101, 5, {.tif=TimeInForce::GTD, .timestamp=1, .expire_at=100})).status, OrderStatus::OK);
+  eng->add_order(test::limit(Side::SELL, 100, 5, {.timestamp=2}));
+  EXPECT_EQ(eng->expire_orders(100).cancelled, 1u);
+  EXPECT_EQ(eng->uncross().volume, 0);
+}
+
+TEST(EngineGtd, EveryDeadlineFiresExactlyOnceAcrossTimeJumps) {
+  // deadlines spread over every level of the wheel, time moved in steps from one tick to 2^50
+  std::mt19937_64 rng(11);
+  for (auto layout : {LevelLayout::AOS, LevelLayout::SOA}) {
+    auto eng = make_engine({.level_layout=layout, .cancel_mode=CancelMode::TOMBSTONE, .clock=ClockSource::CALLER});
+    std::vector<std::uint64_t> deadlines;
+    for (int i = 0; i < 3000; ++i) {
+      const unsigned bits = 1 + static_cast<unsigned>(rng() % 52);
+      const std::uint64_t deadline = 2 + rng() % (std::uint64_t{1} << bits);
+      deadlines.push_back(deadline);
+      ASSERT_EQ(eng->add_order(test::limit(i % 2 == 0 ? Side::BUY : Side::SELL, i % 2 == 0 ? 100 - i % 7 : 200 + i % 7, 1, {.tif=TimeInForce::GTD, .timestamp=1, .expire_at=deadline})).status, OrderStatus::OK);
+    }
+    deadlines.push_back(~std::uint64_t{0}); // the far end of the time line
+    eng->add_order(test::limit(Side::BUY, 1, 1, {.tif=TimeInForce::GTD, .timestamp=1, .expire_at=deadlines.back()}));
+    std::sort(deadlines.begin(), deadlines.end());
+
+    std::uint64_t now = 1;
+    std::uint64_t expired = 0;
+    while (now < (std::uint64_t{1} << 53)) {
+      now += 1 + rng() % (std::uint64_t{1} << (rng() % 50));
+      expired += eng->expire_orders(now).cancelled;
+      const auto due = static_cast<std::uint64_t>(std::upper_bound(deadlines.begin(), deadlines.end(), now) - deadlines.begin());
+      ASSERT_EQ(expired, due) << "at " << now;
+      ASSERT_EQ(eng->memory_stats().resting_orders, deadlines.size() - due);
+    }
+    EXPECT_EQ(eng->expire_orders(~std::uint64_t{0}).cancelled, 1u);
+    EXPECT_EQ(eng->metrics().expired_orders, deadlines.size());
+  }
+}
+
+TEST(EngineGtd, PublishesExpiredOrders) {
+  EventPublisher publisher(1u << 10);
+  std::vector<event_t> seen; // written by the publisher thread, read after stop()
+  publisher.add_sink(std::make_shared<CallbackEventSink>([&](std::span<const event_t> events) {
+    seen.insert(seen.end(), events.begin(), events.end());
+  }));
+  publisher.start();
+
+  auto eng = make_engine({.publisher=&publisher, .clock=ClockSource::CALLER});
+  const auto order = eng->add_order(test::limit(Side::SELL, 101, 5, {.tif=TimeInForce::GTD, .timestamp=1, .expire_at=20}));
+  eng->expire_orders(25);
+  publisher.stop();
+
+  // ORDER, TOP(ask) | EXPIRE, TOP(ask)
+  ASSERT_EQ(seen.size(), 4u);
+  EXPECT_EQ(seen[2].type, EventType::EXPIRE);
+  EXPECT_EQ(seen[2].order_id, order.order_id);
+  EXPECT_EQ(seen[2].qty, 5);
+  EXPECT_EQ(seen[2].timestamp, 25u);
+  EXPECT_EQ(seen[3].type, EventType::TOP_OF_BOOK);
+  EXPECT_EQ(seen[3].qty, 0);
+}
+
+TEST(EngineGtd, ReplicaExpiresWithThePrimary) {
+  ReplicatedEngine eng({.clock=ClockSource::CALLER});
+  eng.start();
+  eng.add_order(test::limit(Side::BUY, 100, 5, {.tif=TimeInForce::GTD, .timestamp=1, .expire_at=50}));
+  eng.add_order(test::limit(Side::BUY, 99, 5, {.tif=TimeInForce::GTD, .timestamp=2, .expire_at=80}));
+  eng.add_order(test::limit(Side::SELL, 110, 5, {.timestamp=60})); // expires the first bid on both books
+  eng.sync();
+  EXPECT_EQ(eng.replica_snapshot(5).bids, eng.snapshot(5).bids);
+  EXPECT_EQ(eng.snapshot(5).bids.size(), 1u);
+
+  eng.expire_orders(80);
+  eng.sync();
+  EXPECT_TRUE(eng.snapshot(5).bids.empty());
+  EXPECT_TRUE(eng.replica_snapshot(5).bids.empty());
+  eng.stop();
+}
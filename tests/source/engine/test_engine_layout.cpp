@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <libs/engine/engine.hpp>
+#include <random>
+#include <vector>
+
+using namespace engine;
+
+class LevelLayoutTest : public ::testing::TestWithParam<LevelLayout> {
+protected:
+  std::unique_ptr<IEngine> make() const {
+    return make_engine({.market_gtc_as_ioc=true, .market_max_levels=0, .level_layout=GetParam()});
+  }
+};
+
+TEST_P(LevelLayoutTest, FifoAcrossFrontCompaction) {
+  auto eng = make();
+  // long queue so the consumed prefix is compacted several times
+  for (int i = 0; i < 300; ++i) {
+    eng->add_order({.order_id=static_cast<engine::id_t>(i + 1), .side=Side::SELL, .price=100, .qty=2});
+  }
+  ASSERT_TRUE(eng->cancel_order(150));
+
+  auto r = eng->add_order({.side=Side::BUY, .order_type=OrderType::MARKET, .time_in_force=TimeInForce::IOC, .qty=401});
+  ASSERT_EQ(r.trades.size(), 201u);
+  EXPECT_EQ(r.trades.front().maker, 1u);
+  EXPECT_EQ(r.trades[148].maker, 149u);
+  EXPECT_EQ(r.trades[149].maker, 151u); // cancelled order skipped, FIFO preserved
+  EXPECT_EQ(r.trades.back().qty, 1);
+
+  auto s = eng->snapshot(1);
+  ASSERT_EQ(s.asks.size(), 1u);
+  EXPECT_EQ(s.asks[0].qty, 98 * 2 + 1);
+  EXPECT_TRUE(eng->cancel_order(202)); // partially filled head is still indexed
+  EXPECT_EQ(eng->snapshot(1).asks[0].qty, 98 * 2);
+}
+
+INSTANTIATE_TEST_SUITE_P(Layouts, LevelLayoutTest, ::testing::Values(LevelLayout::AOS, LevelLayout::SOA));
+
+TEST(LevelLayout, AosAndSoaProduceSameTrades) {
+  auto aos = make_engine({.level_layout=LevelLayout::AOS});
+  auto soa = make_engine({.level_layout=LevelLayout::SOA});
+
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int> side(0, 1), px(-5, 5), qty(1, 50), op(0, 9);
+  std::vector<engine::id_t> live;
+  for (int i = 0; i < 20000; ++i) {
+    if (op(rng) == 0 && !live.empty()) {
+      const engine::id_t victim = live[static_cast<std::size_t>(qty(rng)) % live.size()];
+      EXPECT_EQ(aos->cancel_order(victim), soa->cancel_order(victim));
+      continue;
+    }
+    order_cmd_t cmd{.side=side(rng) == 0 ? Side::BUY : Side::SELL, .price=1000 + px(rng), .qty=qty(rng)};
+    auto ra = aos->add_order(cmd);
+    auto rs = soa->add_order(cmd);
+    ASSERT_EQ(ra.order_id, rs.order_id);
+    ASSERT_EQ(ra.trades.size(), rs.trades.size());
+    for (std::size_t t = 0; t < ra.trades.size(); ++t) {
+      EXPECT_EQ(ra.trades[t].maker, rs.trades[t].maker);
+      EXPECT_EQ(ra.trades[t].qty, rs.trades[t].qty);
+    }
+    if (ra.remaining_qty > 0) live.push_back(ra.order_id);
+  }
+  auto sa = aos->snapshot(20);
+  auto ss = soa->snapshot(20);
+  ASSERT_EQ(sa.bids.size(), ss.bids.size());
+  for (std::size_t i = 0; i < sa.bids.size(); ++i) EXPECT_EQ(sa.bids[i].qty, ss.bids[i].qty);
+}
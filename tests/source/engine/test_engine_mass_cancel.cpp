@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <libs/engine/engine.hpp>
+#include "test_flows.hpp"
+
+using namespace engine;
+
+TEST(MassCancel, WholeSide) {
+  auto eng = make_engine({true, 0});
+  eng->add_order(test::limit(Side::BUY, 100, 10));
+  eng->add_order(test::limit(Side::BUY, 99, 20));
+  eng->add_order(test::limit(Side::SELL, 105, 5));
+
+  auto r = eng->mass_cancel({.scope=MassCancelScope::SIDE, .side=Side::BUY});
+  EXPECT_EQ(r.cancelled, 2u);
+  EXPECT_EQ(r.cancelled_qty, 30);
+
+  auto s = eng->snapshot(5);
+  EXPECT_TRUE(s.bids.empty());
+  ASSERT_EQ(s.asks.size(), 1u);
+  EXPECT_FALSE(eng->cancel_order(1000)); // index entry is gone too
+  EXPECT_EQ(eng->metrics().cancel_orders, 2u);
+}
+
+TEST(MassCancel, LevelsPastPrice) {
+  auto eng = make_engine({true, 0});
+  eng->add_order(test::limit(Side::BUY, 100, 1));
+  eng->add_order(test::limit(Side::BUY, 99, 2));
+  eng->add_order(test::limit(Side::BUY, 98, 3));
+  eng->add_order(test::limit(Side::SELL, 101, 4));
+  eng->add_order(test::limit(Side::SELL, 102, 5));
+
+  auto r = eng->mass_cancel({.scope=MassCancelScope::PRICE, .side=Side::BUY, .price=99});
+  EXPECT_EQ(r.cancelled, 2u);
+  EXPECT_EQ(r.cancelled_qty, 5);
+
+  r = eng->mass_cancel({.scope=MassCancelScope::PRICE, .side=Side::SELL, .price=102});
+  EXPECT_EQ(r.cancelled, 1u);
+
+  auto s = eng->snapshot(5);
+  ASSERT_EQ(s.bids.size(), 1u);
+  EXPECT_EQ(s.bids[0].price, 100);
+  ASSERT_EQ(s.asks.size(), 1u);
+  EXPECT_EQ(s.asks[0].price, 101);
+}
+
+TEST(MassCancel, OwnerKeepsOthersCancelable) {
+  auto eng = make_engine({true, 0});
+  eng->add_order(test::limit(Side::BUY, 100, 10, {.owner=7}));  // 1000
+  eng->add_order(test::limit(Side::BUY, 100, 20));     // 1001
+  eng->add_order(test::limit(Side::BUY, 100, 30, {.owner=7}));  // 1002
+  eng->add_order(test::limit(Side::SELL, 110, 40, {.owner=7})); // 1003
+
+  auto r = eng->mass_cancel({.scope=MassCancelScope::OWNER, .owner=7});
+  EXPECT_EQ(r.cancelled, 3u);
+  EXPECT_EQ(r.cancelled_qty, 80);
+
+  auto s = eng->snapshot(5);
+  ASSERT_EQ(s.bids.size(), 1u);
+  EXPECT_EQ(s.bids[0].qty, 20);
+  EXPECT_TRUE(s.asks.empty());
+
+  // the survivor is still reachable through the index
+  EXPECT_TRUE(eng->cancel_order(1001));
+  EXPECT_TRUE(eng->snapshot(5).bids.empty());
+}
+
+TEST(MassCancel, OwnerZeroIsReserved) {
+  auto eng = make_engine({true, 0});
+  const auto rejected = eng->add_order(test::limit(Side::BUY, 100, 10, {.owner=NO_OWNER}));
+  EXPECT_EQ(rejected.status, OrderStatus::BAD_INPUT);
+  EXPECT_EQ(rejected.remaining_qty, 10);
+  EXPECT_TRUE(eng->snapshot(5).bids.empty());
+
+  // untagged orders are not the owner NO_OWNER either
+  eng->add_order(test::limit(Side::BUY, 100, 20));
+  eng->add_order(test::limit(Side::SELL, 110, 30));
+  auto r = eng->mass_cancel({.scope=MassCancelScope::OWNER, .owner=NO_OWNER});
+  EXPECT_EQ(r.cancelled, 0u);
+  EXPECT_EQ(r.cancelled_qty, 0);
+  EXPECT_EQ(eng->snapshot(5).bids.size(), 1u);
+  EXPECT_EQ(eng->snapshot(5).asks.size(), 1u);
+}
@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include <libs/engine/engine.hpp>
+#include "test_flows.hpp"
+
+using namespace engine;
+
+TEST(MemoryStats, EmptyEngineHoldsNoLevels) {
+  auto eng = make_engine({true, 0});
+  const auto stats = eng->memory_stats();
+  EXPECT_EQ(stats.bid_levels, 0u);
+  EXPECT_EQ(stats.ask_levels, 0u);
+  EXPECT_EQ(stats.resting_orders, 0u);
+  EXPECT_EQ(stats.levels.bytes_in_use, 0u);
+  EXPECT_EQ(stats.queues.bytes_in_use, 0u);
+  EXPECT_EQ(stats.bytes_per_order(), 0.0);
+}
+
+TEST(MemoryStats, CountsLiveStructures) {
+  for (auto layout : {LevelLayout::AOS, LevelLayout::SOA}) {
+    auto eng = make_engine({.market_gtc_as_ioc=true, .market_max_levels=0, .level_layout=layout});
+    eng->add_order(test::limit(Side::BUY, 100, 1));
+    eng->add_order(test::limit(Side::BUY, 100, 2));
+    eng->add_order(test::limit(Side::BUY, 99, 3));
+    eng->add_order(test::limit(Side::SELL, 105, 4));
+
+    const auto stats = eng->memory_stats();
+    EXPECT_EQ(stats.bid_levels, 2u);
+    EXPECT_EQ(stats.ask_levels, 1u);
+    EXPECT_EQ(stats.resting_orders, 4u);
+    EXPECT_EQ(stats.index_entries, 4u);
+    EXPECT_GE(stats.queue_slots, stats.resting_orders);
+    EXPECT_GT(stats.index_buckets, 0u);
+    EXPECT_GT(stats.levels.bytes_in_use, 0u);
+    EXPECT_GT(stats.queues.bytes_in_use, 0u);
+    EXPECT_GT(stats.index.bytes_in_use, 0u);
+    EXPECT_GT(stats.bytes_per_order(), 0.0);
+  }
+}
+
+TEST(MemoryStats, ReleasedWhenBookEmpties) {
+  auto eng = make_engine({true, 0});
+  for (price_t px = 100; px < 110; ++px) {
+    eng->add_order(test::limit(Side::SELL, px, 10));
+  }
+  const auto full = eng->memory_stats();
+  EXPECT_EQ(full.ask_levels, 10u);
+
+  // a sweep removes every level, their queues and index entries
+  eng->add_order({.side=Side::BUY, .order_type=OrderType::LIMIT, .time_in_force=TimeInForce::IOC, .price=200, .qty=100});
+  const auto empty = eng->memory_stats();
+  EXPECT_EQ(empty.ask_levels, 0u);
+  EXPECT_EQ(empty.index_entries, 0u);
+  EXPECT_EQ(empty.levels.bytes_in_use, 0u);
+  EXPECT_EQ(empty.queues.bytes_in_use, 0u);
+  EXPECT_EQ(empty.levels.allocations, empty.levels.deallocations);
+  EXPECT_EQ(empty.levels.peak_bytes, full.levels.peak_bytes);
+}
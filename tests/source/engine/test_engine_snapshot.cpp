@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include <libs/engine/engine.hpp>
+#include <array>
+#include "test_flows.hpp"
+
+using namespace engine;
+
+TEST(SnapshotInto, MatchesSnapshot) {
+  auto eng = make_engine({true, 0});
+  eng->add_order(test::limit(Side::BUY, 100, 1));
+  eng->add_order(test::limit(Side::BUY, 99, 2));
+  eng->add_order(test::limit(Side::BUY, 98, 3));
+  eng->add_order(test::limit(Side::SELL, 101, 4));
+
+  std::array<snapshot_level_t, 2> bids{};
+  std::array<snapshot_level_t, 4> asks{};
+  auto counts = eng->snapshot_into(bids, asks);
+  EXPECT_EQ(counts.bids, 2u);
+  EXPECT_EQ(counts.asks, 1u);
+
+  auto snap = eng->snapshot(2);
+  for (std::size_t i = 0; i < counts.bids; ++i) {
+    EXPECT_EQ(bids[i].price, snap.bids[i].price);
+    EXPECT_EQ(bids[i].qty, snap.bids[i].qty);
+  }
+  EXPECT_EQ(asks[0].price, 101);
+  EXPECT_EQ(asks[1].price, 0); // unused slots are cleared
+}
+
+TEST(SnapshotInto, DeltaRewritesOnlyChangedLevels) {
+  auto eng = make_engine({true, 0});
+  eng->add_order(test::limit(Side::BUY, 100, 1));
+  eng->add_order(test::limit(Side::BUY, 99, 2));
+  eng->add_order(test::limit(Side::SELL, 105, 4));
+
+  fixed_snapshot_t<5> depth;
+  auto counts = depth.refresh(*eng);
+  EXPECT_EQ(counts.updated, 3u);
+
+  counts = depth.refresh(*eng);
+  EXPECT_EQ(counts.updated, 0u); // nothing changed
+  EXPECT_EQ(counts.bids, 2u);
+
+  eng->add_order(test::limit(Side::BUY, 99, 5)); // one level changes
+  counts = depth.refresh(*eng);
+  EXPECT_EQ(counts.updated, 1u);
+  EXPECT_EQ(depth.bids[1].qty, 7);
+
+  eng->add_order(test::limit(Side::BUY, 101, 3)); // new best shifts every bid slot
+  counts = depth.refresh(*eng);
+  EXPECT_EQ(counts.updated, 3u);
+  EXPECT_EQ(counts.bids, 3u);
+  EXPECT_EQ(depth.bids[0].price, 101);
+  EXPECT_EQ(depth.bids[2].price, 99);
+  EXPECT_EQ(depth.asks[0].qty, 4);
+
+  ASSERT_TRUE(eng->cancel_order(1003));
+  eng->add_order(test::limit(Side::SELL, 100, 4)); // takes out 101 and 100, 99 remains
+  counts = depth.refresh(*eng);
+  EXPECT_EQ(counts.bids, 1u);
+  EXPECT_EQ(depth.bids[0].price, 99);
+  EXPECT_EQ(depth.bids[0].qty, 2);
+  EXPECT_EQ(depth.bids[1].price, 0);
+
+  auto snap = eng->snapshot(5);
+  ASSERT_EQ(snap.asks.size(), counts.asks);
+  for (std::size_t i = 0; i < counts.asks; ++i) EXPECT_EQ(depth.asks[i].qty, snap.asks[i].qty);
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <libs/engine/engine.hpp>
+#include <random>
+#include <vector>
+
+using namespace engine;
+
+class TombstoneTest : public ::testing::TestWithParam<LevelLayout> {
+protected:
+  std::unique_ptr<IEngine> make(CancelMode mode) const {
+    return make_engine({.market_gtc_as_ioc=true, .market_max_levels=0, .level_layout=GetParam(), .cancel_mode=mode});
+  }
+};
+
+TEST_P(TombstoneTest, MatchingSkipsCancelledOrders) {
+  auto eng = make(CancelMode::TOMBSTONE);
+  for (int i = 0; i < 300; ++i) {
+    eng->add_order({.order_id=static_cast<engine::id_t>(i + 1), .side=Side::SELL, .price=100, .qty=2});
+  }
+  // front, middle and back; only 3 dead slots, so no compaction
+  ASSERT_TRUE(eng->cancel_order(1));
+  ASSERT_TRUE(eng->cancel_order(150));
+  ASSERT_TRUE(eng->cancel_order(300));
+  EXPECT_FALSE(eng->cancel_order(150));
+  EXPECT_EQ(eng->snapshot(1).asks[0].qty, 297 * 2);
+  EXPECT_EQ(eng->memory_stats().resting_orders, 297u);
+  EXPECT_EQ(eng->memory_stats().tombstones, 2u); // the front one was skipped at once
+
+  auto r = eng->add_order({.side=Side::BUY, .order_type=OrderType::MARKET, .time_in_force=TimeInForce::IOC, .qty=1000});
+  ASSERT_EQ(r.trades.size(), 297u);
+  EXPECT_EQ(r.trades.front().maker, 2u);
+  EXPECT_EQ(r.trades[147].maker, 149u);
+  EXPECT_EQ(r.trades[148].maker, 151u);
+  EXPECT_EQ(r.trades.back().maker, 299u);
+  EXPECT_EQ(r.filled_qty, 297 * 2);
+  EXPECT_TRUE(eng->snapshot(1).asks.empty());
+  EXPECT_EQ(eng->memory_stats().tombstones, 0u);
+}
+
+TEST_P(TombstoneTest, DeadRatioTriggersCompaction) {
+  auto eng = make(CancelMode::TOMBSTONE);
+  for (int i = 0; i < 100; ++i) {
+    eng->add_order({.order_id=static_cast<engine::id_t>(i + 1), .side=Side::BUY, .price=100, .qty=1});
+  }
+  // every odd order past the front: the 50th cancel makes half the slots dead
+  for (int i = 2; i < 100; i += 2) {
+    ASSERT_TRUE(eng->cancel_order(static_cast<engine::id_t>(i + 1)));
+  }
+  EXPECT_EQ(eng->memory_stats().tombstones, 49u);
+  ASSERT_TRUE(eng->cancel_order(100));
+  EXPECT_EQ(eng->memory_stats().tombstones, 0u);
+  EXPECT_EQ(eng->memory_stats().resting_orders, 50u);
+
+  // slots moved by the compaction still cancel the right order
+  ASSERT_TRUE(eng->cancel_order(50));
+  auto r = eng->add_order({.side=Side::SELL, .order_type=OrderType::MARKET, .time_in_force=TimeInForce::IOC, .qty=100});
+  ASSERT_EQ(r.trades.size(), 49u);
+  EXPECT_EQ(r.trades[24].maker, 48u);
+  EXPECT_EQ(r.trades[25].maker, 52u);
+}
+
+TEST_P(TombstoneTest, IdleCompactionReclaimsSlots) {
+  auto eng = make(CancelMode::TOMBSTONE);
+  for (int i = 0; i < 20; ++i) {
+    eng->add_order({.order_id=static_cast<engine::id_t>(i + 1), .side=Side::BUY, .price=100 - i % 2, .qty=1});
+    eng->add_order({.order_id=static_cast<engine::id_t>(i + 101), .side=Side::SELL, .price=110, .qty=1});
+  }
+  for (engine::id_t id : {3u, 5u, 4u, 6u, 104u, 105u}) {
+    ASSERT_TRUE(eng->cancel_order(id));
+  }
+  EXPECT_EQ(eng->memory_stats().tombstones, 6u);
+  const auto before = eng->snapshot(5);
+
+  EXPECT_EQ(eng->compact(1), 2u); // best bid level only
+  EXPECT_EQ(eng->memory_stats().tombstones, 4u);
+  EXPECT_EQ(eng->compact(0), 4u);
+  EXPECT_EQ(eng->memory_stats().tombstones, 0u);
+  EXPECT_EQ(eng->compact(0), 0u);
+
+  const auto after = eng->snapshot(5);
+  EXPECT_EQ(before.bids, after.bids);
+  EXPECT_EQ(before.asks, after.asks);
+  EXPECT_TRUE(eng->cancel_order(20));
+  EXPECT_TRUE(eng->cancel_order(120));
+  EXPECT_EQ(eng->memory_stats().resting_orders, 32u);
+}
+
+TEST_P(TombstoneTest, IdleCompactionTakesTurnsBetweenSides) {
+  auto eng = make(CancelMode::TOMBSTONE);
+  // three bid levels with two tombstones each, one ask level with three; the level fronts stay live
+  for (engine::id_t id = 1; id <= 12; ++id) {
+    eng->add_order({.order_id=id, .side=Side::BUY, .price=100 - static_cast<engine::price_t>((id - 1) / 4), .qty=1});
+  }
+  for (engine::id_t id = 101; id <= 105; ++id) {
+    eng->add_order({.order_id=id, .side=Side::SELL, .price=110, .qty=1});
+  }
+  for (engine::id_t id : {2u, 3u, 6u, 7u, 10u, 11u, 102u, 103u, 104u}) {
+    ASSERT_TRUE(eng->cancel_order(id));
+  }
+  EXPECT_EQ(eng->compact(2), 5u); // best bid level, then the ask level
+  EXPECT_EQ(eng->compact(1), 2u);
+  EXPECT_EQ(eng->compact(0), 2u);
+  EXPECT_EQ(eng->memory_stats().tombstones, 0u);
+}
+
+TEST_P(TombstoneTest, SameResultsAsErase) {
+  auto erase = make(CancelMode::ERASE);
+  auto tomb = make(CancelMode::TOMBSTONE);
+
+  std::mt19937 rng(11);
+  std::uniform_int_distribution<int> side(0, 1), px(-3, 3), qty(1, 20), op(0, 19);
+  std::vector<engine::id_t> live;
+  for (int i = 0; i < 20000; ++i) {
+    const int action = op(rng);
+    if (action < 8 && !live.empty()) {
+      const std::size_t pick = static_cast<std::size_t>(rng()) % live.size();
+      const engine::id_t victim = live[pick];
+      live[pick] = live.back();
+      live.pop_back();
+      ASSERT_EQ(erase->cancel_order(victim), tomb->cancel_order(victim));
+      continue;
+    }
+    if (action == 8) {
+      const mass_cancel_cmd_t cmd{.scope=MassCancelScope::OWNER, .owner=static_cast<owner_t>(1 + qty(rng) % 4)};
+      ASSERT_EQ(erase->mass_cancel(cmd), tomb->mass_cancel(cmd));
+      continue;
+    }
+    const order_cmd_t cmd{.side=side(rng) == 0 ? Side::BUY : Side::SELL, .price=1000 + px(rng), .qty=qty(rng),
+                          .owner=static_cast<owner_t>(1 + qty(rng) % 4)};
+    const auto re = erase->add_order(cmd);
+    ASSERT_EQ(re, tomb->add_order(cmd));
+    if (re.remaining_qty > 0) {live.push_back(re.order_id);}
+    if (i % 1000 == 0) {tomb->compact(2);}
+  }
+  const auto se = erase->snapshot(10);
+  const auto st = tomb->snapshot(10);
+  EXPECT_EQ(se.bids, st.bids);
+  EXPECT_EQ(se.asks, st.asks);
+  EXPECT_EQ(erase->memory_stats().resting_orders, tomb->memory_stats().resting_orders);
+  EXPECT_EQ(erase->memory_stats().index_entries, tomb->memory_stats().index_entries);
+}
+
+INSTANTIATE_TEST_SUITE_P(Layouts, TombstoneTest, ::testing::Values(LevelLayout::AOS, LevelLayout::SOA));
@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+#include <libs/engine/engine.hpp>
+#include <libs/engine/book_arena.hpp>
+#include <vector>
+#include "test_flows.hpp"
+
+using namespace engine;
+
+TEST(EngineWarmup, ResetsToFreshState) {
+  auto eng = make_engine({.market_gtc_as_ioc=true, .market_max_levels=0, .reserve_orders=4096, .warmup_orders=2000});
+  const auto metrics = eng->metrics();
+  EXPECT_EQ(metrics.add_orders, 0u);
+  EXPECT_EQ(metrics.cancel_orders, 0u);
+  EXPECT_EQ(metrics.trades, 0u);
+
+  const auto stats = eng->memory_stats();
+  EXPECT_EQ(stats.bid_levels + stats.ask_levels, 0u);
+  EXPECT_EQ(stats.index_entries, 0u);
+  EXPECT_GE(stats.index_buckets, 4096u); // pre-sized index survives the reset
+  EXPECT_TRUE(eng->snapshot(5).bids.empty());
+}
+
+TEST(EngineWarmup, SameResultsAsColdEngine) {
+  BookArena arena(book_arena_options_t{.initial_bytes = 1U << 20, .prefault = true});
+  auto cold = make_engine({true, 0});
+  auto warm = make_engine({.market_gtc_as_ioc=true, .market_max_levels=0, .memory_resource=&arena, .reserve_orders=1024, .warmup_orders=1000});
+  for (const auto& cmd : test::random_flow(3000, 11, 500)) {
+    ASSERT_EQ(cold->add_order(cmd), warm->add_order(cmd)); // same ids and timestamps
+  }
+  EXPECT_EQ(cold->metrics().trades, warm->metrics().trades);
+}
+
+TEST(EngineWarmup, HugePagesFallBackGracefully) {
+  BookArena arena(book_arena_options_t{.initial_bytes = 1U << 20, .huge_pages = true, .prefault = true});
+  EXPECT_GE(arena.reserved_bytes(), 1U << 20);
+  void* block = arena.allocate(128);
+  EXPECT_NE(block, nullptr);
+  arena.deallocate(block, 128);
+}
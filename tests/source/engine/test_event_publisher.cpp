@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include <libs/engine/engine.hpp>
+#include <libs/engine/event_publisher.hpp>
+#include <memory>
+#include <vector>
+
+using namespace engine;
+
+TEST(EventPublisher, DeliversEngineEventsInOrder) {
+  EventPublisher publisher(1u << 10);
+  std::vector<event_t> seen; // written by the publisher thread, read after stop()
+  publisher.add_sink(std::make_shared<CallbackEventSink>([&](std::span<const event_t> events) {
+    seen.insert(seen.end(), events.begin(), events.end());
+  }));
+  publisher.start();
+
+  auto eng = make_engine({.market_gtc_as_ioc=true, .market_max_levels=0, .publisher=&publisher});
+  eng->add_order({.side=Side::SELL, .price=101, .qty=5});
+  eng->add_order({.side=Side::BUY, .price=101, .qty=3});
+  eng->cancel_order(1000);
+  publisher.stop();
+
+  // ORDER, TOP(ask) | TRADE, ORDER, TOP(ask) | CANCEL, TOP(ask)
+  ASSERT_EQ(seen.size(), 7u);
+  EXPECT_EQ(seen[0].type, EventType::ORDER);
+  EXPECT_EQ(seen[1].type, EventType::TOP_OF_BOOK);
+  EXPECT_EQ(seen[1].price, 101);
+  EXPECT_EQ(seen[1].qty, 5);
+  EXPECT_EQ(seen[2].type, EventType::TRADE);
+  EXPECT_EQ(seen[2].order_id, 1001u);
+  EXPECT_EQ(seen[2].aux, 1000u);
+  EXPECT_EQ(seen[2].qty, 3);
+  EXPECT_EQ(seen[3].type, EventType::ORDER);
+  EXPECT_EQ(seen[3].code, static_cast<uint8_t>(OrderStatus::FILLED));
+  EXPECT_EQ(seen[4].qty, 2);
+  EXPECT_EQ(seen[5].type, EventType::CANCEL);
+  EXPECT_EQ(seen[5].code, 1);
+  EXPECT_EQ(seen[6].type, EventType::TOP_OF_BOOK);
+  EXPECT_EQ(seen[6].qty, 0);
+  for (std::size_t i = 0; i < seen.size(); ++i) EXPECT_EQ(seen[i].seq, i);
+
+  auto stats = publisher.stats();
+  EXPECT_EQ(stats.published, 7u);
+  EXPECT_EQ(stats.delivered, 7u);
+  EXPECT_EQ(stats.dropped, 0u);
+  EXPECT_EQ(stats.occupancy, 0u);
+}
+
+TEST(EventPublisher, FullRingDropsInsteadOfBlocking) {
+  EventPublisher publisher(1u << 4); // not started: nothing drains the ring
+  for (int i = 0; i < 20; ++i) publisher.publish(event_t{});
+
+  auto stats = publisher.stats();
+  EXPECT_EQ(stats.published, 16u);
+  EXPECT_EQ(stats.dropped, 4u);
+  EXPECT_EQ(stats.occupancy, 16u);
+  EXPECT_EQ(stats.capacity, 16u);
+  EXPECT_EQ(stats.ring.push_full, 4u);
+  EXPECT_EQ(stats.ring.high_water, 16u);
+}
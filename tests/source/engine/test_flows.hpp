@@ -0,0 +1,38 @@
+#pragma once
+
+#include <libs/engine/engine.hpp>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace engine::test {
+// the fields a test sets on a limit order beyond side, price and quantity
+struct limit_opts_t {
+  TimeInForce tif{TimeInForce::GTC};
+  std::uint64_t timestamp{0};
+  std::uint64_t expire_at{0};
+  std::optional<owner_t> owner = std::nullopt;
+};
+
+inline order_cmd_t limit(Side side, price_t price, qty_t qty, limit_opts_t opts = {}) {
+  return {.side=side, .order_type=OrderType::LIMIT, .time_in_force=opts.tif, .price=price, .qty=qty,
+          .timestamp=opts.timestamp, .expire_at=opts.expire_at, .owner=opts.owner};
+}
+
+// a seeded stream of limit orders, mixed sides and time-in-force, within five ticks of mid
+inline std::vector<order_cmd_t> random_flow(std::size_t count, std::uint32_t seed, price_t mid) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> side(0, 1);
+  std::uniform_int_distribution<int> tif(0, 2);
+  std::uniform_int_distribution<int> level(-5, 5);
+  std::uniform_int_distribution<int> qty(1, 100);
+  std::vector<order_cmd_t> flow;
+  flow.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    flow.push_back({.side=side(rng) == 0 ? Side::BUY : Side::SELL, .order_type=OrderType::LIMIT,
+                    .time_in_force=static_cast<TimeInForce>(tif(rng)), .price=mid + level(rng), .qty=qty(rng)});
+  }
+  return flow;
+}
+}  // namespace engine::test
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <libs/engine/engine.hpp>
+#include <libs/engine/event_publisher.hpp>
+#include <libs/engine/metrics_exporter.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace engine;
+
+namespace {
+std::string read_file(const std::string& path) {
+  std::ifstream in(path);
+  std::stringstream text;
+  text << in.rdbuf();
+  return text.str();
+}
+} // namespace
+
+TEST(EngineMetrics, HistogramMatchesCounters) {
+  auto eng = make_engine();
+  for (int i = 0; i < 100; ++i) {
+    eng->add_order({.side=(i % 2 == 0) ? Side::BUY : Side::SELL, .order_type=OrderType::LIMIT,
+                    .time_in_force=TimeInForce::GTC, .price=1000 + (i % 7) - 3, .qty=5});
+  }
+  const auto metrics = eng->metrics();
+  const auto latency = eng->add_latency();
+  EXPECT_EQ(latency.count(), metrics.add_orders);
+  EXPECT_EQ(latency.sum_ns, metrics.add_total_ns);
+  EXPECT_LE(metrics.add_min_ns, metrics.add_max_ns);
+  EXPECT_EQ(metrics.best_bid_px, static_cast<std::uint64_t>(eng->snapshot(1).bids[0].price));
+}
+
+TEST(EngineMetrics, ReadableWhileMatching) {
+  // the only resting order is a bid of price p and quantity p - 900: a torn top of book breaks that
+  auto eng = make_engine();
+  std::atomic<bool> done{false};
+  std::thread matcher([&] {
+    for (int i = 0; i < 20000; ++i) {
+      const price_t price = 1000 + (i % 50);
+      const auto result = eng->add_order({.side=Side::BUY, .order_type=OrderType::LIMIT, .time_in_force=TimeInForce::GTC, .price=price, .qty=price - 900});
+      eng->cancel_order(result.order_id);
+    }
+    done.store(true);
+  });
+  std::uint64_t last_adds = 0;
+  while (!done.load()) {
+    const auto metrics = eng->metrics();
+    if (metrics.best_bid_px != 0) {
+      EXPECT_EQ(metrics.best_bid_qty, metrics.best_bid_px - 900);
+    }
+    EXPECT_GE(metrics.add_orders, last_adds);
+    last_adds = metrics.add_orders;
+  }
+  matcher.join();
+  EXPECT_EQ(eng->metrics().add_orders, 20000u);
+  EXPECT_EQ(eng->metrics().cancel_orders, 20000u);
+}
+
+TEST(MetricsExporter, PrometheusText) {
+  auto eng = make_engine();
+  eng->add_order({.side=Side::SELL, .order_type=OrderType::LIMIT, .time_in_force=TimeInForce::GTC, .price=1010, .qty=7});
+  eng->add_order({.side=Side::BUY, .order_type=OrderType::LIMIT, .time_in_force=TimeInForce::GTC, .price=1010, .qty=3});
+  EventPublisher publisher(1u << 4);
+  publisher.publish(event_t{});
+
+  MetricsExporter exporter("unused.prom");
+  exporter.add_engine("XYZ \"a\"", *eng);
+  exporter.add_publisher("events", publisher);
+  const std::string text = exporter.format();
+
+  EXPECT_NE(text.find("# TYPE scopex_orders_added_total counter\nscopex_orders_added_total{engine=\"XYZ \\\"a\\\"\"} 2\n"), std::string::npos);
+  EXPECT_NE(text.find("scopex_trades_total{engine=\"XYZ \\\"a\\\"\"} 1\n"), std::string::npos);
+  EXPECT_NE(text.find("scopex_best_ask_qty{engine=\"XYZ \\\"a\\\"\"} 4\n"), std::string::npos);
+  EXPECT_NE(text.find("# TYPE scopex_add_latency_ns histogram\n"), std::string::npos);
+  EXPECT_NE(text.find("scopex_add_latency_ns_bucket{engine=\"XYZ \\\"a\\\"\",le=\"+Inf\"} 2\n"), std::string::npos);
+  EXPECT_NE(text.find("scopex_add_latency_ns_count{engine=\"XYZ \\\"a\\\"\"} 2\n"), std::string::npos);
+  EXPECT_NE(text.find("scopex_events_published_total{publisher=\"events\"} 1\n"), std::string::npos);
+  EXPECT_NE(text.find("scopex_event_ring_capacity{publisher=\"events\"} 16\n"), std::string::npos);
+}
+
+TEST(MetricsExporter, PeriodicFileDump) {
+  const std::string path = ::testing::TempDir() + "scopex_metrics_test.prom";
+  std::remove(path.c_str());
+  auto eng = make_engine();
+  {
+    MetricsExporter exporter(path, std::chrono::milliseconds(5));
+    exporter.add_engine("main", *eng);
+    exporter.start();
+    for (int i = 0; i < 50; ++i) {
+      eng->add_order({.side=Side::BUY, .order_type=OrderType::LIMIT, .time_in_force=TimeInForce::GTC, .price=1000, .qty=1});
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    exporter.stop();
+    EXPECT_GE(exporter.dumps(), 2u);
+    EXPECT_EQ(exporter.failures(), 0u);
+  }
+  // stop() writes a final dump with everything counted
+  EXPECT_NE(read_file(path).find("scopex_orders_added_total{engine=\"main\"} 50\n"), std::string::npos);
+  std::remove(path.c_str());
+}
+
+TEST(MetricsExporter, UnwritablePathReportsError) {
+  auto eng = make_engine();
+  MetricsExporter exporter("/nonexistent-dir/metrics.prom");
+  exporter.add_engine("main", *eng);
+  EXPECT_FALSE(exporter.write_now());
+  EXPECT_EQ(exporter.failures(), 1u);
+  EXPECT_NE(exporter.error().find("/nonexistent-dir/metrics.prom.tmp"), std::string::npos);
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <libs/engine/engine.hpp>
+#include <libs/engine/replica.hpp>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace engine;
+
+namespace {
+// adds of every kind, cancels of random ids and the odd mass cancel
+void drive(IEngine& eng, std::size_t count) {
+  std::mt19937 rng(5);
+  std::uniform_int_distribution<int> side(0, 1), tif(0, 2), level(-6, 6), qty(1, 50), op(0, 9);
+  for (std::size_t i = 0; i < count; ++i) {
+    const int action = op(rng);
+    if (action < 2) {
+      eng.cancel_order(1000 + static_cast<engine::id_t>(rng() % (i + 1)));
+    } else if (action == 2 && i % 50 == 0) {
+      eng.mass_cancel({.scope=MassCancelScope::PRICE, .side=Side::BUY, .price=995});
+    } else {
+      eng.add_order({.side=side(rng) == 0 ? Side::BUY : Side::SELL,
+                     .order_type=(action == 3) ? OrderType::MARKET : OrderType::LIMIT,
+                     .time_in_force=static_cast<TimeInForce>(tif(rng)), .price=1000 + level(rng), .qty=qty(rng)});
+    }
+  }
+}
+}  // namespace
+
+TEST(ReplicatedEngine, ReplicaConvergesToPrimary) {
+  for (auto mode : {CancelMode::ERASE, CancelMode::TOMBSTONE}) {
+    ReplicatedEngine eng({.level_layout=LevelLayout::SOA, .cancel_mode=mode}, 1U << 6); // small ring: commands spill
+    eng.start();
+    drive(eng, 20000);
+    eng.sync();
+
+    const auto primary = eng.snapshot(100);
+    const auto replica = eng.replica_snapshot(100);
+    EXPECT_EQ(primary.bids, replica.bids);
+    EXPECT_EQ(primary.asks, replica.asks);
+    const auto stats = eng.replica_stats();
+    EXPECT_GT(stats.forwarded, 0u);
+    EXPECT_EQ(stats.lag_commands(), 0u);
+    EXPECT_EQ(stats.backlog, 0u);
+    EXPECT_EQ(eng.read([](const IEngine& r) { return r.memory_stats().resting_orders; }), eng.memory_stats().resting_orders);
+    eng.stop();
+  }
+}
+
+TEST(ReplicatedEngine, ReadersRunAlongsideMatching) {
+  ReplicatedEngine eng;
+  eng.start();
+  std::atomic<bool> done{false};
+  std::size_t reads = 0;
+  std::thread reader([&] {
+    while (!done.load(std::memory_order_acquire)) {
+      const auto snap = eng.replica_snapshot(1000); // deep read, never on the matching thread
+      for (std::size_t i = 1; i < snap.bids.size(); ++i) {ASSERT_GT(snap.bids[i - 1].price, snap.bids[i].price);}
+      ++reads;
+    }
+  });
+  drive(eng, 20000);
+  eng.sync();
+  done.store(true, std::memory_order_release);
+  reader.join();
+  EXPECT_GT(reads, 0u);
+  EXPECT_EQ(eng.snapshot(100).bids, eng.replica_snapshot(100).bids);
+  eng.stop();
+}
+
+TEST(ReplicatedEngine, LongReadNeverStallsMatching) {
+  ReplicatedEngine eng({}, 1U << 4);
+  eng.start();
+  std::atomic<bool> holding{false};
+  std::atomic<bool> release{false};
+  std::thread reader([&] {
+    eng.read([&](const IEngine&) {
+      holding.store(true, std::memory_order_release);
+      while (!release.load(std::memory_order_acquire)) {std::this_thread::yield();}
+      return 0;
+    });
+  });
+  while (!holding.load(std::memory_order_acquire)) {std::this_thread::yield();}
+
+  drive(eng, 5000); // the replica is locked out for all of it, far more than the ring holds
+  auto stats = eng.replica_stats();
+  EXPECT_GT(stats.spilled, 0u);
+  EXPECT_GT(stats.backlog, 0u);
+  EXPECT_GT(stats.lag_commands(), stats.backlog);
+
+  release.store(true, std::memory_order_release);
+  reader.join();
+  eng.sync();
+  stats = eng.replica_stats();
+  EXPECT_EQ(stats.backlog, 0u);
+  EXPECT_EQ(stats.lag_commands(), 0u);
+  EXPECT_EQ(eng.replica_snapshot(100).bids, eng.snapshot(100).bids);
+  EXPECT_EQ(eng.replica_snapshot(100).asks, eng.snapshot(100).asks);
+  eng.stop();
+}
+
+TEST(ReplicatedEngine, AuctionAndRejectedCommands) {
+  ReplicatedEngine eng;
+  eng.start();
+  eng.set_matching_mode(MatchingMode::AUCTION);
+  eng.add_order({.side=Side::BUY, .price=102, .qty=10});
+  eng.add_order({.side=Side::SELL, .price=99, .qty=6});
+  EXPECT_EQ(eng.add_order({.side=Side::SELL, .order_type=OrderType::MARKET, .time_in_force=TimeInForce::IOC, .qty=1}).status, OrderStatus::REJECT);
+  EXPECT_EQ(eng.add_order({.side=Side::SELL, .price=99, .qty=0}).status, OrderStatus::BAD_INPUT);
+  eng.set_matching_mode(MatchingMode::CONTINUOUS);
+  eng.sync();
+
+  EXPECT_EQ(eng.replica_stats().forwarded, 4u); // two modes and two resting orders
+  EXPECT_EQ(eng.read([](const IEngine& r) { return r.matching_mode(); }), MatchingMode::CONTINUOUS);
+  const auto replica = eng.replica_snapshot(5);
+  ASSERT_EQ(replica.bids.size(), 1u);
+  EXPECT_EQ(replica.bids[0], (snapshot_level_t{102, 4}));
+  EXPECT_TRUE(replica.asks.empty());
+  eng.stop();
+}
+
+TEST(ReplicatedEngine, ForwardsWithoutAReplicaThread) {
+  ReplicatedEngine eng({}, 1U << 4); // fills after 16 forwards
+  drive(eng, 2000); // never started: everything past the ring spills
+  EXPECT_GT(eng.replica_stats().spilled, 0u);
+  EXPECT_EQ(eng.replica_stats().backlog, eng.replica_stats().forwarded - 16);
+  eng.start();
+  drive(eng, 2000);
+  eng.stop();
+  drive(eng, 2000); // stopped again
+  eng.start();
+  eng.sync();
+  EXPECT_EQ(eng.replica_snapshot(100).bids, eng.snapshot(100).bids);
+  EXPECT_EQ(eng.replica_snapshot(100).asks, eng.snapshot(100).asks);
+  eng.stop();
+}
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <libs/engine/engine.hpp>
+#include <libs/engine/async_engine.hpp>
+#include <libs/engine/event_publisher.hpp>
+#include <libs/engine/replica.hpp>
+#include <libs/engine/trace.hpp>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include "test_flows.hpp"
+
+using namespace engine;
+
+namespace {
+detached_task_t traced_submit(AsyncEngine& eng, order_cmd_t cmd, TraceRecorder& recorder) {
+  trace_t trace;
+  cmd.trace = &trace;
+  const auto result = co_await eng.submit(cmd);
+  recorder.record(trace, result.order_id, result.status);
+}
+} // namespace
+
+TEST(Trace, EngineStampsMatchAndPublish) {
+  EventPublisher publisher(1u << 8);
+  auto eng = make_engine({.publisher=&publisher});
+  trace_t trace;
+  auto cmd = test::limit(Side::BUY, 1000, 5);
+  cmd.trace = &trace;
+  eng->add_order(cmd);
+
+  EXPECT_FALSE(trace.reached(TraceStage::INGRESS));
+  EXPECT_FALSE(trace.reached(TraceStage::DEQUEUE));
+  ASSERT_TRUE(trace.reached(TraceStage::MATCH_START));
+  ASSERT_TRUE(trace.reached(TraceStage::PUBLISH));
+  const auto& ticks = trace.ticks;
+  EXPECT_LE(ticks[static_cast<std::size_t>(TraceStage::MATCH_START)], ticks[static_cast<std::size_t>(TraceStage::MATCH_END)]);
+  EXPECT_LE(ticks[static_cast<std::size_t>(TraceStage::MATCH_END)], ticks[static_cast<std::size_t>(TraceStage::PUBLISH)]);
+
+  // no publisher: no publish stage
+  auto plain = make_engine();
+  trace_t unpublished;
+  cmd.trace = &unpublished;
+  plain->add_order(cmd);
+  EXPECT_TRUE(unpublished.reached(TraceStage::MATCH_END));
+  EXPECT_FALSE(unpublished.reached(TraceStage::PUBLISH));
+}
+
+TEST(Trace, AsyncEngineStampsRingStages) {
+  AsyncEngine eng({}, 1u << 4);
+  TraceRecorder recorder;
+  eng.start();
+  for (int i = 0; i < 100; ++i) {
+    traced_submit(eng, test::limit(i % 2 == 0 ? Side::BUY : Side::SELL, 1000, 1), recorder);
+  }
+  eng.drain();
+  eng.stop();
+
+  const auto stats = recorder.stats();
+  EXPECT_EQ(stats.traced, 100u);
+  EXPECT_EQ(stats.total.count(), 100u);
+  EXPECT_EQ(stats.stage[static_cast<std::size_t>(TraceStage::INGRESS)].count(), 0u);
+  for (auto stage : {TraceStage::ENQUEUE, TraceStage::DEQUEUE, TraceStage::MATCH_START, TraceStage::MATCH_END}) {
+    EXPECT_EQ(stats.stage[static_cast<std::size_t>(stage)].count(), 100u) << TraceRecorder::stage_name(stage);
+  }
+  EXPECT_EQ(stats.stage[static_cast<std::size_t>(TraceStage::PUBLISH)].count(), 0u);
+}
+
+TEST(Trace, ReplicaDoesNotTouchCallerStamps) {
+  ReplicatedEngine eng;
+  eng.start();
+  trace_t trace;
+  auto cmd = test::limit(Side::SELL, 1010, 3);
+  cmd.trace = &trace;
+  eng.add_order(cmd);
+  const auto match_end = trace.ticks[static_cast<std::size_t>(TraceStage::MATCH_END)];
+  eng.sync();
+  EXPECT_EQ(trace.ticks[static_cast<std::size_t>(TraceStage::MATCH_END)], match_end);
+  eng.stop();
+}
+
+TEST(Trace, RecorderSamplesRawDump) {
+  const std::string path = ::testing::TempDir() + "scopex_trace_test.bin";
+  {
+    TraceRecorder recorder(path, 10);
+    ASSERT_TRUE(recorder.is_open());
+    auto eng = make_engine();
+    for (int i = 0; i < 35; ++i) {
+      trace_t trace;
+      trace.stamp(TraceStage::INGRESS);
+      auto cmd = test::limit(Side::BUY, 1000 - i, 1);
+      cmd.trace = &trace;
+      const auto result = eng->add_order(cmd);
+      recorder.record(trace, result.order_id, result.status, 7);
+    }
+    recorder.record(trace_t{}, 0, OrderStatus::OK); // nothing stamped: ignored
+    const auto stats = recorder.stats();
+    EXPECT_EQ(stats.traced, 35u);
+    EXPECT_EQ(stats.dumped, 3u);
+    EXPECT_EQ(stats.stage[static_cast<std::size_t>(TraceStage::MATCH_START)].count(), 35u);
+  }
+
+  std::ifstream in(path, std::ios::binary);
+  trace_file_header_t header{};
+  in.read(reinterpret_cast<char*>(&header), sizeof(header));
+  EXPECT_EQ(std::string(header.magic, 4), "SXTR");
+  EXPECT_EQ(header.record_size, sizeof(trace_record_t));
+  EXPECT_EQ(header.sample_every, 10u);
+  std::vector<trace_record_t> records(4);
+  in.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(trace_record_t)));
+  ASSERT_EQ(in.gcount(), static_cast<std::streamsize>(3 * sizeof(trace_record_t)));
+  EXPECT_EQ(records[0].order_id, 1009u); // the 10th add
+  EXPECT_EQ(records[0].source, 7u);
+  EXPECT_NE(records[0].stage_ns[static_cast<std::size_t>(TraceStage::INGRESS)], 0u);
+  EXPECT_EQ(records[0].stage_ns[static_cast<std::size_t>(TraceStage::DEQUEUE)], 0u);
+  EXPECT_LE(records[0].stage_ns[static_cast<std::size_t>(TraceStage::INGRESS)], records[0].stage_ns[static_cast<std::size_t>(TraceStage::MATCH_END)]);
+  std::remove(path.c_str());
+}
+
+TEST(Trace, StatsMerge) {
+  TraceRecorder first;
+  TraceRecorder second;
+  trace_t trace;
+  trace.stamp(TraceStage::ENQUEUE);
+  trace.stamp(TraceStage::DEQUEUE);
+  first.record(trace, 1, OrderStatus::OK);
+  second.record(trace, 2, OrderStatus::OK);
+  second.record(trace, 3, OrderStatus::OK);
+  auto stats = first.stats();
+  stats += second.stats();
+  EXPECT_EQ(stats.traced, 3u);
+  EXPECT_EQ(stats.stage[static_cast<std::size_t>(TraceStage::DEQUEUE)].count(), 3u);
+  EXPECT_EQ(stats.total.count(), 3u);
+}